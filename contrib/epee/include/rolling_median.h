@@ -38,6 +38,8 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <string>
 
 namespace epee
 {
@@ -176,6 +178,7 @@ public:
     minCt = 0;
     maxCt = 0;
     sz = 0;
+    memset(data, 0, N * sizeof(Item)); //so the unused slots get_state saves are deterministic
     int nItems = N;
     while (nItems--)  //set up initial heap fill pattern: median,max,min,max,...
     {
@@ -234,6 +237,56 @@ public:
     }
   }
 
+  //returns the full state, to be restored later with set_state
+  std::string get_state() const
+  {
+    const int header[5] = {N, idx, minCt, maxCt, sz};
+    std::string state((const char*)header, sizeof(header));
+    state.append((const char*)data, N * (sizeof(Item) + sizeof(int) * 2));
+    return state;
+  }
+
+  //restores a state returned by get_state for the same window size
+  //returns false, leaving this object unchanged, if the state is not consistent
+  bool set_state(const std::string &state)
+  {
+    int header[5];
+    if (state.size() != sizeof(header) + N * (sizeof(Item) + sizeof(int) * 2))
+      return false;
+    memcpy(header, state.data(), sizeof(header));
+    if (header[0] != N || header[1] < 0 || header[1] >= N || header[4] < 0 || header[4] > N)
+      return false;
+    if (header[2] < 0 || header[2] > (N - 1) / 2 || header[3] < 0 || header[3] > N / 2)
+      return false;
+    if (header[4] != (header[4] ? header[2] + header[3] + 1 : 0))
+      return false;
+
+    rolling_median_t restored(N);
+    memcpy(restored.data, state.data() + sizeof(header), N * (sizeof(Item) + sizeof(int) * 2));
+    restored.idx = header[1];
+    restored.minCt = header[2];
+    restored.maxCt = header[3];
+    restored.sz = header[4];
+
+    //pos and heap must be inverse permutations within the heap storage
+    for (int i = 0; i < N; ++i)
+    {
+      const int p = restored.pos[i];
+      if (p < -(N / 2) || p > N - N / 2 - 1 || restored.heap[p] != i)
+        return false;
+    }
+    //and the min and max heaps must be ordered around the median
+    for (int i = 1; i <= restored.minCt; ++i)
+      if (restored.mmless(i, i / 2))
+        return false;
+    for (int i = -1; i >= -restored.maxCt; --i)
+      if (restored.mmless(i / 2, i))
+        return false;
+
+    *this = std::move(restored);
+    return true;
+  }
+
   //returns median item (or average of 2 when item count is even)
   Item median() const
   {
@@ -0,0 +1,184 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <memory>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+#endif
+
+#include "blockchain_db.h"
+#include "blob_compression.h"
+
+#undef MEVACOIN_DEFAULT_LOG_CATEGORY
+#define MEVACOIN_DEFAULT_LOG_CATEGORY "blockchain.db"
+
+// No block or transaction comes anywhere near this, a larger frame is corrupt
+#define MAX_DECOMPRESSED_BLOB_SIZE (1ull << 30)
+
+namespace cryptonote
+{
+
+#ifdef HAVE_ZSTD
+namespace
+{
+  struct cctx_deleter { void operator()(ZSTD_CCtx *cctx) const { ZSTD_freeCCtx(cctx); } };
+  struct dctx_deleter { void operator()(ZSTD_DCtx *dctx) const { ZSTD_freeDCtx(dctx); } };
+
+  // contexts are not thread safe, but cheap to keep one of each per thread
+  ZSTD_CCtx *get_cctx()
+  {
+    static thread_local std::unique_ptr<ZSTD_CCtx, cctx_deleter> cctx(ZSTD_createCCtx());
+    if (!cctx)
+      throw DB_ERROR("Failed to create zstd compression context");
+    return cctx.get();
+  }
+
+  ZSTD_DCtx *get_dctx()
+  {
+    static thread_local std::unique_ptr<ZSTD_DCtx, dctx_deleter> dctx(ZSTD_createDCtx());
+    if (!dctx)
+      throw DB_ERROR("Failed to create zstd decompression context");
+    return dctx.get();
+  }
+}
+#endif
+
+bool blob_compressor::available()
+{
+#ifdef HAVE_ZSTD
+  return true;
+#else
+  return false;
+#endif
+}
+
+blob_compressor::blob_compressor(): m_init(false), m_level(0), m_cdict(nullptr), m_ddict(nullptr)
+{
+}
+
+blob_compressor::~blob_compressor()
+{
+  deinit();
+}
+
+void blob_compressor::init(const std::string &dictionary, int level)
+{
+  deinit();
+#ifdef HAVE_ZSTD
+  if (!dictionary.empty())
+  {
+    m_cdict = ZSTD_createCDict(dictionary.data(), dictionary.size(), level);
+    m_ddict = ZSTD_createDDict(dictionary.data(), dictionary.size());
+    if (!m_cdict || !m_ddict)
+    {
+      deinit();
+      throw DB_ERROR("Failed to load blob compression dictionary");
+    }
+  }
+  m_level = level;
+  m_init = true;
+#else
+  throw DB_ERROR("This build has no zstd support, blobs cannot be compressed");
+#endif
+}
+
+void blob_compressor::deinit()
+{
+#ifdef HAVE_ZSTD
+  ZSTD_freeCDict(static_cast<ZSTD_CDict*>(m_cdict));
+  ZSTD_freeDDict(static_cast<ZSTD_DDict*>(m_ddict));
+#endif
+  m_cdict = nullptr;
+  m_ddict = nullptr;
+  m_init = false;
+}
+
+void blob_compressor::compress(const blobdata_ref &blob, std::string &out) const
+{
+  if (!m_init)
+    throw DB_ERROR("Blob compressor is not initialized");
+#ifdef HAVE_ZSTD
+  out.resize(ZSTD_compressBound(blob.size()));
+  const size_t size = m_cdict ?
+      ZSTD_compress_usingCDict(get_cctx(), &out[0], out.size(), blob.data(), blob.size(), static_cast<const ZSTD_CDict*>(m_cdict)) :
+      ZSTD_compressCCtx(get_cctx(), &out[0], out.size(), blob.data(), blob.size(), m_level);
+  if (ZSTD_isError(size))
+    throw DB_ERROR((std::string("Failed to compress blob: ") + ZSTD_getErrorName(size)).c_str());
+  out.resize(size);
+#endif
+}
+
+void blob_compressor::decompress(const blobdata_ref &blob, blobdata &out) const
+{
+  if (!m_init)
+    throw DB_ERROR("Blob compressor is not initialized");
+#ifdef HAVE_ZSTD
+  const unsigned long long content_size = ZSTD_getFrameContentSize(blob.data(), blob.size());
+  if (content_size == ZSTD_CONTENTSIZE_ERROR || content_size == ZSTD_CONTENTSIZE_UNKNOWN || content_size > MAX_DECOMPRESSED_BLOB_SIZE)
+    throw DB_ERROR("Invalid compressed blob");
+  out.resize(content_size);
+  if (content_size == 0)
+    return;
+  const size_t size = m_ddict ?
+      ZSTD_decompress_usingDDict(get_dctx(), &out[0], out.size(), blob.data(), blob.size(), static_cast<const ZSTD_DDict*>(m_ddict)) :
+      ZSTD_decompressDCtx(get_dctx(), &out[0], out.size(), blob.data(), blob.size());
+  if (ZSTD_isError(size))
+    throw DB_ERROR((std::string("Failed to decompress blob: ") + ZSTD_getErrorName(size)).c_str());
+  if (size != content_size)
+    throw DB_ERROR("Compressed blob has the wrong size");
+#endif
+}
+
+std::string blob_compressor::train_dictionary(const std::vector<blobdata> &samples, size_t max_size)
+{
+#ifdef HAVE_ZSTD
+  std::string buffer;
+  std::vector<size_t> sizes;
+  sizes.reserve(samples.size());
+  for (const auto &sample: samples)
+  {
+    buffer += sample;
+    sizes.push_back(sample.size());
+  }
+  std::string dictionary(max_size, '\0');
+  const size_t size = ZDICT_trainFromBuffer(&dictionary[0], dictionary.size(), buffer.data(), sizes.data(), sizes.size());
+  if (ZDICT_isError(size))
+  {
+    MWARNING("Failed to train blob compression dictionary, none will be used: " << ZDICT_getErrorName(size));
+    return std::string();
+  }
+  dictionary.resize(size);
+  return dictionary;
+#else
+  throw DB_ERROR("This build has no zstd support, blobs cannot be compressed");
+#endif
+}
+
+}  // namespace cryptonote
@@ -0,0 +1,84 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+
+#include "cryptonote_basic/blobdatatype.h"
+
+namespace cryptonote
+{
+
+/**
+ * @brief zstd compression for the blobs in the block and transaction tables
+ *
+ * A dictionary trained on the database's own blobs is used when there is one,
+ * which is what makes small records like pruned transactions worth compressing.
+ * Compression and decompression are thread safe.
+ */
+class blob_compressor
+{
+public:
+  //! whether this build can read and write compressed blobs
+  static bool available();
+
+  blob_compressor();
+  ~blob_compressor();
+
+  /**
+   * @brief sets up the compressor, throwing if this build has no zstd support
+   *
+   * @param dictionary a dictionary made by train_dictionary, or empty for none
+   * @param level the zstd compression level
+   */
+  void init(const std::string &dictionary, int level);
+  void deinit();
+  bool is_init() const { return m_init; }
+  int level() const { return m_level; }
+
+  void compress(const blobdata_ref &blob, std::string &out) const;
+  void decompress(const blobdata_ref &blob, blobdata &out) const;
+
+  /**
+   * @brief trains a dictionary on sample blobs
+   *
+   * @return the dictionary, or an empty string if there were too few samples
+   */
+  static std::string train_dictionary(const std::vector<blobdata> &samples, size_t max_size);
+
+private:
+  bool m_init;
+  int m_level;
+  void *m_cdict;
+  void *m_ddict;
+};
+
+}  // namespace cryptonote
@@ -160,6 +160,46 @@ const command_line::arg_descriptor<bool> arg_db_salvage  = {
 , "Try to salvage a blockchain database if it seems corrupted"
 , false
 };
+const command_line::arg_descriptor<std::string> arg_db_cold_dir = {
+  "db-cold-dir"
+, "Move old block blobs and prunable transaction data to a database in this folder, eg on a slower, cheaper disk"
+, ""
+};
+
+namespace
+{
+  thread_local unsigned read_timing_enabled = 0;
+  thread_local unsigned read_depth = 0;
+  thread_local uint64_t read_time_ns = 0;
+}
+
+db_read_timer::db_read_timer(): m_start(0), m_timed(read_timing_enabled > 0)
+{
+  if (m_timed && read_depth++ == 0)
+    m_start = epee::misc_utils::get_ns_count();
+}
+
+db_read_timer::~db_read_timer()
+{
+  if (!m_timed)
+    return;
+  --read_depth;
+  if (m_start)
+    read_time_ns += epee::misc_utils::get_ns_count() - m_start;
+}
+
+void db_read_timer::enable(bool enable)
+{
+  if (enable)
+    ++read_timing_enabled;
+  else if (read_timing_enabled > 0)
+    --read_timing_enabled;
+}
+
+uint64_t db_read_timer::total_ns()
+{
+  return read_time_ns;
+}
 
 BlockchainDB *new_db()
 {
@@ -170,6 +210,7 @@ void BlockchainDB::init_options(boost::program_options::options_description& des
 {
   command_line::add_arg(desc, arg_db_sync_mode);
   command_line::add_arg(desc, arg_db_salvage);
+  command_line::add_arg(desc, arg_db_cold_dir);
 }
 
 void BlockchainDB::pop_block()
@@ -391,6 +432,15 @@ bool BlockchainDB::get_pruned_tx(const crypto::hash& h, cryptonote::transaction
   return true;
 }
 
+std::vector<uint64_t> BlockchainDB::get_block_cumulative_rct_outputs_range(uint64_t start_height, size_t count) const
+{
+  std::vector<uint64_t> heights;
+  heights.reserve(count);
+  for (uint64_t h = start_height; h < start_height + count; ++h)
+    heights.push_back(h);
+  return get_block_cumulative_rct_outputs(heights);
+}
+
 transaction BlockchainDB::get_tx(const crypto::hash& h) const
 {
   transaction tx;
@@ -418,6 +468,68 @@ std::vector<bool> BlockchainDB::has_key_images(const epee::span<const crypto::ke
   return spent;
 }
 
+void BlockchainDB::get_output_keys_batch(const std::vector<std::pair<uint64_t, uint64_t>> &amount_indices, std::vector<output_data_t> &outputs, std::vector<bool> &found) const
+{
+  outputs.clear();
+  found.clear();
+  if (amount_indices.empty())
+    return;
+
+  // callers building a lookup table usually hand us sorted unique pairs already
+  const bool sorted_unique = std::adjacent_find(amount_indices.begin(), amount_indices.end(),
+      [](const std::pair<uint64_t, uint64_t> &a, const std::pair<uint64_t, uint64_t> &b) { return !(a < b); }) == amount_indices.end();
+  if (sorted_unique)
+  {
+    get_output_keys_sorted(amount_indices, outputs, found);
+    return;
+  }
+
+  std::vector<std::pair<uint64_t, uint64_t>> sorted = amount_indices;
+  std::sort(sorted.begin(), sorted.end());
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+  std::vector<output_data_t> sorted_outputs;
+  std::vector<bool> sorted_found;
+  get_output_keys_sorted(sorted, sorted_outputs, sorted_found);
+
+  outputs.resize(amount_indices.size());
+  found.resize(amount_indices.size(), false);
+  for (size_t i = 0; i < amount_indices.size(); ++i)
+  {
+    const size_t pos = std::lower_bound(sorted.begin(), sorted.end(), amount_indices[i]) - sorted.begin();
+    outputs[i] = sorted_outputs[pos];
+    found[i] = sorted_found[pos];
+  }
+}
+
+void BlockchainDB::get_output_keys_sorted(const std::vector<std::pair<uint64_t, uint64_t>> &amount_indices, std::vector<output_data_t> &outputs, std::vector<bool> &found) const
+{
+  outputs.clear();
+  outputs.resize(amount_indices.size());
+  found.clear();
+  found.resize(amount_indices.size(), false);
+
+  std::vector<uint64_t> offsets;
+  std::vector<output_data_t> amount_outputs;
+  for (size_t start = 0; start < amount_indices.size(); )
+  {
+    const uint64_t amount = amount_indices[start].first;
+    size_t end = start;
+    offsets.clear();
+    while (end < amount_indices.size() && amount_indices[end].first == amount)
+      offsets.push_back(amount_indices[end++].second);
+
+    // partial results are a prefix, since outputs of an amount are indexed contiguously
+    get_output_key(epee::span<const uint64_t>(&amount, 1), offsets, amount_outputs, true);
+    for (size_t i = 0; i < amount_outputs.size() && start + i < end; ++i)
+    {
+      outputs[start + i] = amount_outputs[i];
+      found[start + i] = true;
+    }
+    start = end;
+  }
+}
+
 void BlockchainDB::reset_stats()
 {
   num_calls = 0;
@@ -105,6 +105,7 @@ typedef std::pair<crypto::hash, uint64_t> tx_out_index;
 
 extern const command_line::arg_descriptor<std::string> arg_db_sync_mode;
 extern const command_line::arg_descriptor<bool, false> arg_db_salvage;
+extern const command_line::arg_descriptor<std::string> arg_db_cold_dir;
 
 enum class relay_category : uint8_t
 {
@@ -139,6 +140,18 @@ struct tx_data_t
 };
 #pragma pack(pop)
 
+/**
+ * @brief a struct containing statistics about the growth of the database's storage
+ */
+struct db_storage_stats
+{
+  uint64_t reserved;          //!< bytes of storage reserved for the database
+  uint64_t used;              //!< bytes of the reservation in use
+  uint64_t resizes;           //!< number of times the reservation had to grow
+  uint64_t stall_time_us;     //!< time database access was held up by growing it
+  uint64_t max_stall_time_us; //!< longest single hold up
+};
+
 struct alt_block_data_t
 {
   uint64_t height;
@@ -578,6 +591,19 @@ protected:
    */
   void add_transaction(const crypto::hash& blk_hash, const transaction& tx, epee::span<const std::uint8_t> blob, const crypto::hash* tx_hash_ptr = NULL, const crypto::hash* tx_prunable_hash_ptr = NULL);
 
+  /**
+   * @brief helper function for get_output_keys_batch, to fetch sorted outputs
+   *
+   * The (amount, index) pairs given are sorted and unique. The default
+   * implementation calls get_output_key once per amount, a subclass may
+   * override it to walk its output table in one pass.
+   *
+   * @param amount_indices a sorted list of unique (amount, index) pairs
+   * @param outputs return-by-reference a list of outputs' metadata
+   * @param found return-by-reference whether each output was found
+   */
+  virtual void get_output_keys_sorted(const std::vector<std::pair<uint64_t, uint64_t>> &amount_indices, std::vector<output_data_t> &outputs, std::vector<bool> &found) const;
+
   mutable uint64_t time_tx_exists = 0;  //!< a performance metric
   uint64_t time_commit1 = 0;  //!< a performance metric
   bool m_auto_remove_logs = true;  //!< whether or not to automatically remove old logs
@@ -794,6 +820,30 @@ public:
    */
   virtual void set_batch_transactions(bool) = 0;
 
+  /**
+   * @brief sets where to keep rarely read data, apart from the rest of the database
+   *
+   * Block blobs and prunable transaction data move there once they are
+   * deep enough in the chain, see move_to_cold_storage. This must be called
+   * before open, and with the same folder every time once data was moved.
+   *
+   * @param folder the folder for the cold storage, empty for none
+   */
+  virtual void set_cold_storage(const std::string& folder) = 0;
+
+  /**
+   * @brief moves old block blobs and prunable transaction data to cold storage
+   *
+   * Carries on from the previous call, a bounded number of blocks at a time.
+   *
+   * @param min_depth only move blocks at least this far below the top of the chain
+   * @param max_blocks move at most this many blocks
+   * @param moved_bytes return-by-reference the number of bytes moved
+   *
+   * @return true iff there is nothing left to move, or no cold storage is set
+   */
+  virtual bool move_to_cold_storage(uint64_t min_depth, uint64_t max_blocks, uint64_t &moved_bytes) = 0;
+
   virtual void block_wtxn_start() = 0;
   virtual void block_wtxn_stop() = 0;
   virtual void block_wtxn_abort() = 0;
@@ -950,6 +1000,22 @@ public:
    */
   virtual std::vector<uint64_t> get_block_cumulative_rct_outputs(const std::vector<uint64_t> &heights) const = 0;
 
+  /**
+   * @brief fetch the cumulative number of rct outputs for a range of blocks
+   *
+   * The default implementation looks each height up through
+   * get_block_cumulative_rct_outputs; subclasses may serve the range
+   * more directly.
+   *
+   * If a block does not exist, the subclass should throw BLOCK_DNE
+   *
+   * @param start_height the height of the first block
+   * @param count the number of blocks requested
+   *
+   * @return the cumulative numbers of rct outputs, one per block
+   */
+  virtual std::vector<uint64_t> get_block_cumulative_rct_outputs_range(uint64_t start_height, size_t count) const;
+
   /**
    * @brief fetch the top block's timestamp
    *
@@ -1483,6 +1549,23 @@ public:
    */
   virtual bool can_thread_bulk_indices() const = 0;
 
+  /**
+   * @brief gets outputs' data for a batch of (amount, index) pairs
+   *
+   * The pairs may come from many transactions (eg, all the ring members of a
+   * block or a span of blocks) and need be neither sorted nor unique: they are
+   * sorted and deduplicated so the outputs are looked up in key order, then
+   * the results are scattered back so outputs[i] and found[i] correspond to
+   * amount_indices[i].
+   *
+   * Outputs which do not exist are not an error: their found flag is false.
+   *
+   * @param amount_indices a list of (amount, amount-specific index) pairs
+   * @param outputs return-by-reference a list of outputs' metadata
+   * @param found return-by-reference whether each output was found
+   */
+  void get_output_keys_batch(const std::vector<std::pair<uint64_t, uint64_t>> &amount_indices, std::vector<output_data_t> &outputs, std::vector<bool> &found) const;
+
   /**
    * @brief gets output indices (amount-specific) for a transaction's outputs
    *
@@ -1622,6 +1705,32 @@ public:
    */
   virtual bool check_pruning() = 0;
 
+  /**
+   * @brief prunes part of the blockchain, carrying on from the previous call
+   *
+   * This lets a live node be pruned a little at a time. The pruning seed is
+   * set by the first call, and progress is kept in the database so pruning
+   * resumes after a restart.
+   *
+   * @param pruning_seed the seed to use on the first call, 0 for default (highly recommended)
+   * @param max_bytes stop once about this many bytes of prunable data were removed
+   * @param max_txes stop once this many transactions were looked at
+   * @param pruned_bytes return-by-reference the number of bytes removed
+   *
+   * @return true iff the whole blockchain is pruned
+   */
+  virtual bool prune_blockchain_step(uint32_t pruning_seed, uint64_t max_bytes, uint64_t max_txes, uint64_t &pruned_bytes) = 0;
+
+  /**
+   * @brief gets how far step by step pruning got
+   *
+   * @param done return-by-reference the number of transactions looked at
+   * @param total return-by-reference the number of transactions to look at
+   *
+   * @return true iff step by step pruning was started and is not finished
+   */
+  virtual bool get_pruning_progress(uint64_t &done, uint64_t &total) const = 0;
+
   /**
    * @brief add a new alternative block
    *
@@ -1798,6 +1907,35 @@ public:
    */
   virtual void drop_hard_fork_info() = 0;
 
+
+  //
+  // Derived state storage
+  //
+
+  /**
+   * @brief stores the state of a cache derived from the blockchain
+   *
+   * Such state can be rebuilt from the chain, but doing so is slow, so it is
+   * saved along with the hash of the top block it was computed for and
+   * checked against the chain when it is loaded again.
+   *
+   * @param name the name of the cache
+   * @param top_hash the hash of the top block the state was computed for
+   * @param state the serialized state
+   */
+  virtual void set_derived_state(const std::string &name, const crypto::hash &top_hash, const std::string &state) = 0;
+
+  /**
+   * @brief gets the state of a cache derived from the blockchain
+   *
+   * @param name the name of the cache
+   * @param top_hash return-by-reference the hash of the top block the state was computed for
+   * @param state return-by-reference the serialized state
+   *
+   * @return true if state was found for the given name, false otherwise
+   */
+  virtual bool get_derived_state(const std::string &name, crypto::hash &top_hash, std::string &state) const = 0;
+
   /**
    * @brief return a histogram of outputs on the blockchain
    *
@@ -1826,6 +1964,21 @@ public:
    */
   virtual uint64_t get_database_size() const = 0;
 
+  /**
+   * @brief grows the storage reserved for the database if it is running low
+   *
+   * Growing may have to wait for all reads and writes to finish, so it is
+   * better done ahead of need, while nothing else is going on.
+   */
+  virtual void reserve_storage() = 0;
+
+  /**
+   * @brief get statistics about the growth of the database's storage
+   *
+   * @return the statistics
+   */
+  virtual db_storage_stats get_storage_stats() const = 0;
+
   // TODO: this should perhaps be (or call) a series of functions which
   // progressively update through version updates
   /**
@@ -1893,9 +2046,43 @@ private:
   bool active;
 };
 
+/**
+ * @brief a read txn pinned for as long as the guard lives
+ *
+ * While it lives, every read made on this thread uses the same read txn and
+ * cursors: the reads see one state of the blockchain even if blocks are added
+ * or popped meanwhile, and no txn is renewed per read.
+ *
+ * Growing the database map waits for pinned read txns, and blocks are added
+ * with the blockchain and pool locks held. So a guard must not be held while
+ * taking those locks, including through Blockchain or core calls which do: read
+ * through the BlockchainDB directly instead.
+ */
 class db_rtxn_guard: public db_txn_guard { public: db_rtxn_guard(BlockchainDB *db): db_txn_guard(db, true) {} };
 class db_wtxn_guard: public db_txn_guard { public: db_wtxn_guard(BlockchainDB *db): db_txn_guard(db, false) {} };
 
+/**
+ * @brief adds up the time this thread spends in db reads, while timing is enabled
+ *
+ * An instance lives for the duration of each read; reads made from within
+ * another read are counted once.
+ */
+class db_read_timer
+{
+public:
+  db_read_timer();
+  ~db_read_timer();
+
+  //! starts (or stops) timing the reads made on this thread, calls nest
+  static void enable(bool enable);
+  //! time spent in timed reads on this thread, in nanoseconds
+  static uint64_t total_ns();
+
+private:
+  uint64_t m_start;
+  bool m_timed;
+};
+
 BlockchainDB *new_db();
 
 }  // namespace cryptonote
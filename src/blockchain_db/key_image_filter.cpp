@@ -0,0 +1,168 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstring>
+
+#include "int-util.h"
+#include "key_image_filter.h"
+
+// 16 bits per key image with 8 bits set gives about a 0.3% false positive rate
+#define KEY_IMAGE_FILTER_BITS_PER_KEY 16
+#define KEY_IMAGE_FILTER_MIN_CAPACITY (1 << 20)
+#define KEY_IMAGE_FILTER_VERSION 1
+
+namespace
+{
+  // key images are curve points, not hashes, so mix their words before using them as one
+  inline uint64_t mix(uint64_t x)
+  {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+  }
+
+  inline uint64_t read_word(const crypto::key_image &ki, size_t n)
+  {
+    uint64_t w;
+    memcpy(&w, reinterpret_cast<const unsigned char*>(&ki) + n * sizeof(w), sizeof(w));
+    return SWAP64LE(w);
+  }
+}
+
+namespace cryptonote
+{
+
+key_image_filter::key_image_filter(): m_num_blocks(0), m_capacity(0), m_count(0)
+{
+}
+
+uint64_t key_image_filter::capacity_for(uint64_t count)
+{
+  return std::max<uint64_t>(count + count / 2, KEY_IMAGE_FILTER_MIN_CAPACITY);
+}
+
+void key_image_filter::reset(uint64_t capacity)
+{
+  m_capacity = capacity;
+  m_num_blocks = (capacity * KEY_IMAGE_FILTER_BITS_PER_KEY + 511) / 512;
+  m_words.reset(new std::atomic<uint64_t>[m_num_blocks * WORDS_PER_BLOCK]);
+  for (uint64_t i = 0; i < m_num_blocks * WORDS_PER_BLOCK; ++i)
+    m_words[i].store(0, std::memory_order_relaxed);
+  m_count.store(0, std::memory_order_relaxed);
+}
+
+void key_image_filter::clear()
+{
+  for (uint64_t i = 0; i < m_num_blocks * WORDS_PER_BLOCK; ++i)
+    m_words[i].store(0, std::memory_order_release);
+  m_count.store(0, std::memory_order_relaxed);
+}
+
+size_t key_image_filter::get_block(const crypto::key_image &ki, uint64_t &bits) const
+{
+  const uint64_t h = mix(read_word(ki, 0) ^ read_word(ki, 2));
+  bits = mix(read_word(ki, 1) ^ read_word(ki, 3));
+  uint64_t hi;
+  mul128(h, m_num_blocks, &hi);
+  return hi * WORDS_PER_BLOCK;
+}
+
+void key_image_filter::insert(const crypto::key_image &ki)
+{
+  if (m_num_blocks == 0)
+    return;
+  uint64_t bits;
+  const size_t block = get_block(ki, bits);
+  for (size_t i = 0; i < WORDS_PER_BLOCK; ++i, bits >>= 6)
+    m_words[block + i].fetch_or(1ull << (bits & 63), std::memory_order_release);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool key_image_filter::may_contain(const crypto::key_image &ki) const
+{
+  if (m_num_blocks == 0)
+    return true;
+  uint64_t bits;
+  const size_t block = get_block(ki, bits);
+  for (size_t i = 0; i < WORDS_PER_BLOCK; ++i, bits >>= 6)
+    if (!(m_words[block + i].load(std::memory_order_acquire) & (1ull << (bits & 63))))
+      return false;
+  return true;
+}
+
+std::string key_image_filter::save() const
+{
+  std::string data;
+  const uint64_t header[4] = {SWAP64LE((uint64_t)KEY_IMAGE_FILTER_VERSION), SWAP64LE(m_capacity), SWAP64LE(m_num_blocks), SWAP64LE(count())};
+  data.reserve(sizeof(header) + m_num_blocks * WORDS_PER_BLOCK * sizeof(uint64_t));
+  data.append(reinterpret_cast<const char*>(header), sizeof(header));
+  for (uint64_t i = 0; i < m_num_blocks * WORDS_PER_BLOCK; ++i)
+  {
+    const uint64_t w = SWAP64LE(m_words[i].load(std::memory_order_relaxed));
+    data.append(reinterpret_cast<const char*>(&w), sizeof(w));
+  }
+  return data;
+}
+
+bool key_image_filter::load(const std::string &data)
+{
+  m_words.reset();
+  m_num_blocks = m_capacity = 0;
+  m_count.store(0, std::memory_order_relaxed);
+
+  uint64_t header[4];
+  if (data.size() < sizeof(header))
+    return false;
+  memcpy(header, data.data(), sizeof(header));
+  for (uint64_t &h: header)
+    h = SWAP64LE(h);
+  if (header[0] != KEY_IMAGE_FILTER_VERSION)
+    return false;
+  const uint64_t capacity = header[1], num_blocks = header[2];
+  if (num_blocks == 0 || num_blocks != (capacity * KEY_IMAGE_FILTER_BITS_PER_KEY + 511) / 512)
+    return false;
+  if ((data.size() - sizeof(header)) / (WORDS_PER_BLOCK * sizeof(uint64_t)) != num_blocks || (data.size() - sizeof(header)) % (WORDS_PER_BLOCK * sizeof(uint64_t)))
+    return false;
+
+  reset(capacity);
+  const char *p = data.data() + sizeof(header);
+  for (uint64_t i = 0; i < m_num_blocks * WORDS_PER_BLOCK; ++i, p += sizeof(uint64_t))
+  {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    m_words[i].store(SWAP64LE(w), std::memory_order_relaxed);
+  }
+  m_count.store(header[3], std::memory_order_relaxed);
+  return true;
+}
+
+}  // namespace cryptonote
@@ -0,0 +1,101 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "crypto/crypto.h"
+
+namespace cryptonote
+{
+
+/**
+ * @brief a split block Bloom filter over spent key images
+ *
+ * Each key image sets one bit in each of the eight 64 bit words of a single
+ * 64 byte block, so a lookup touches one cache line. Answers are either
+ * "definitely not present" or "maybe present"; the latter must be confirmed
+ * against the database.
+ *
+ * Inserts and lookups may run concurrently. Key images cannot be removed, so
+ * a popped key image stays a (harmless) false positive until the filter is
+ * rebuilt.
+ */
+class key_image_filter
+{
+public:
+  key_image_filter();
+
+  /**
+   * @brief clears the filter and sizes it for the given number of key images
+   *
+   * Not thread safe, the filter must not be in use.
+   */
+  void reset(uint64_t capacity);
+
+  /**
+   * @brief empties the filter, keeping its size
+   *
+   * The words are cleared in place, so readers may still be inside may_contain.
+   */
+  void clear();
+
+  void insert(const crypto::key_image &ki);
+  bool may_contain(const crypto::key_image &ki) const;
+
+  uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+  uint64_t capacity() const { return m_capacity; }
+  bool empty() const { return m_num_blocks == 0; }
+
+  /**
+   * @brief serializes the filter, or loads it back
+   *
+   * load fails (and leaves the filter empty) if the data is not a valid
+   * snapshot of this format. Neither may run concurrently with insert.
+   */
+  std::string save() const;
+  bool load(const std::string &data);
+
+  //! capacity for a filter expected to hold the given number of key images, with room to grow
+  static uint64_t capacity_for(uint64_t count);
+
+private:
+  static constexpr size_t WORDS_PER_BLOCK = 8;
+
+  size_t get_block(const crypto::key_image &ki, uint64_t &bits) const;
+
+  std::unique_ptr<std::atomic<uint64_t>[]> m_words;
+  uint64_t m_num_blocks;
+  uint64_t m_capacity;
+  std::atomic<uint64_t> m_count;
+};
+
+}  // namespace cryptonote
@@ -41,6 +41,7 @@
 #include "string_tools.h"
 #include "common/util.h"
 #include "common/pruning.h"
+#include "common/threadpool.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "crypto/crypto.h"
 #include "profile_tools.h"
@@ -60,6 +61,33 @@ using namespace crypto;
 // Increase when the DB structure changes
 #define VERSION 5
 
+// Largest gap between sorted output indices that a batched lookup crosses by
+// stepping the cursor rather than with a fresh tree search
+#define OUTPUT_KEYS_MAX_CURSOR_STEP 8
+
+// Name of the spent key image filter snapshot in the derived state table
+#define KEY_IMAGE_FILTER_STATE_NAME "key_image_filter"
+
+// RingCT output column file in the database folder, and its derived state entry
+#define RCT_OUTPUT_COLUMN_FILENAME "rct_outputs.dat"
+#define RCT_OUTPUT_COLUMN_STATE_NAME "rct_output_column"
+
+// Blob compression state and dictionary keys in m_properties
+#define BLOB_COMPRESSION_KEY "blob_compression"
+#define BLOB_DICTIONARY_KEY "blob_dictionary"
+#define BLOB_COMPRESSION_VERSION 1
+// a table end meaning every record, including those yet to be added, is compressed
+#define BLOB_COMPRESSION_ALL std::numeric_limits<uint64_t>::max()
+// records compressed per txn, and blobs of each kind the dictionary is trained on
+#define BLOB_COMPRESSION_CHUNK 1000
+#define BLOB_DICTIONARY_SAMPLES 4096
+
+// Step by step pruning progress key in m_properties, present until it is done
+#define PRUNING_PROGRESS_KEY "pruning_progress"
+
+// Cold storage key in m_properties, records below its ends live in the cold environment
+#define COLD_STORAGE_KEY "cold_storage"
+
 namespace
 {
 
@@ -71,6 +99,26 @@ struct pre_rct_output_data_t
   uint64_t           unlock_time;  //!< the output's unlock time (or height)
   uint64_t           height;       //!< the height of the block which created the output
 };
+
+struct blob_compression_state
+{
+  uint32_t version;
+  int32_t level;
+  uint64_t blocks_end;
+  uint64_t txs_end;
+};
+
+struct pruning_progress
+{
+  crypto::hash next; // tx_indices is walked in hash order, this is the next tx to look at
+  uint64_t done;
+};
+
+struct cold_storage_state
+{
+  uint64_t blocks_end;
+  uint64_t txs_end;
+};
 #pragma pack(pop)
 
 template <typename T>
@@ -242,6 +290,8 @@ const char* const LMDB_HF_VERSIONS = "hf_versions";
 
 const char* const LMDB_PROPERTIES = "properties";
 
+const char* const LMDB_DERIVED_STATE = "derived_state";
+
 const char zerokey[8] = {0};
 const MDB_val zerokval = { sizeof(zerokey), (void *)zerokey };
 
@@ -358,6 +408,19 @@ typedef struct outtx {
 std::atomic<uint64_t> mdb_txn_safe::num_active_txns{0};
 std::atomic_flag mdb_txn_safe::creation_gate = ATOMIC_FLAG_INIT;
 
+// map resizes hold up every txn in the process, keep track of how long for
+static std::atomic<uint64_t> map_resizes{0};
+static std::atomic<uint64_t> map_stall_time_us{0};
+static std::atomic<uint64_t> map_max_stall_time_us{0};
+
+static void record_map_stall(uint64_t us)
+{
+  ++map_resizes;
+  map_stall_time_us += us;
+  uint64_t max_us = map_max_stall_time_us;
+  while (us > max_us && !map_max_stall_time_us.compare_exchange_weak(max_us, us));
+}
+
 mdb_threadinfo::~mdb_threadinfo()
 {
   MDB_cursor **cur = &m_ti_rcursors.m_txc_blocks;
@@ -480,13 +543,18 @@ void mdb_txn_safe::increment_txns(int i)
       throw0(DB_ERROR(lmdb_error(std::string("Failed to create a transaction for the db in ")+__FUNCTION__+": ", mdb_res).c_str())); \
   } \
 
+// a read made while this thread's read txn is pinned is already counted as
+// active, so it must not wait for new txns to be allowed: a resize waiting
+// for the pinned txn would never see it end
 #define TXN_PREFIX_RDONLY() \
+  db_read_timer read_timer; \
   MDB_txn *m_txn; \
   mdb_txn_cursors *m_cursors; \
-  mdb_txn_safe auto_txn; \
+  const bool rtxn_pinned = block_rtxn_pinned(); \
+  mdb_txn_safe auto_txn(!rtxn_pinned); \
   bool my_rtxn = block_rtxn_start(&m_txn, &m_cursors); \
   if (my_rtxn) auto_txn.m_tinfo = m_tinfo.get(); \
-  else auto_txn.uncheck()
+  else if (!rtxn_pinned) auto_txn.uncheck()
 #define TXN_POSTFIX_RDONLY()
 
 #define TXN_POSTFIX_SUCCESS() \
@@ -498,6 +566,7 @@ void mdb_txn_safe::increment_txns(int i)
 void lmdb_resized(MDB_env *env, int isactive)
 {
   mdb_txn_safe::prevent_new_txns();
+  const uint64_t stall_start = epee::misc_utils::get_ns_count();
 
   MGINFO("LMDB map resize detected.");
 
@@ -522,6 +591,7 @@ void lmdb_resized(MDB_env *env, int isactive)
   MGINFO("LMDB Mapsize increased." << "  Old: " << old / (1024 * 1024) << "MiB" << ", New: " << new_mapsize / (1024 * 1024) << "MiB");
 
   mdb_txn_safe::allow_new_txns();
+  record_map_stall((epee::misc_utils::get_ns_count() - stall_start) / 1000);
 }
 
 inline int lmdb_txn_begin(MDB_env *env, MDB_txn *parent, unsigned int flags, MDB_txn **txn)
@@ -591,9 +661,14 @@ void BlockchainLMDB::do_resize(uint64_t increase_size)
   if (increase_size > 0)
     new_mapsize = mei.me_mapsize + increase_size;
 
+  // if the map is sized from disk capacity, grow it to the next reservation
+  if (m_map_reserved)
+    new_mapsize = std::max(new_mapsize, get_map_reservation(mst.ms_psize * mei.me_last_pgno));
+
   new_mapsize += (new_mapsize % mst.ms_psize);
 
   mdb_txn_safe::prevent_new_txns();
+  const uint64_t stall_start = epee::misc_utils::get_ns_count();
 
   if (m_write_txn != nullptr)
   {
@@ -613,9 +688,34 @@ void BlockchainLMDB::do_resize(uint64_t increase_size)
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to set new mapsize: ", result).c_str()));
 
-  MGINFO("LMDB Mapsize increased." << "  Old: " << mei.me_mapsize / (1024 * 1024) << "MiB" << ", New: " << new_mapsize / (1024 * 1024) << "MiB");
-
   mdb_txn_safe::allow_new_txns();
+  const uint64_t stall_us = (epee::misc_utils::get_ns_count() - stall_start) / 1000;
+  record_map_stall(stall_us);
+
+  MGINFO("LMDB Mapsize increased." << "  Old: " << mei.me_mapsize / (1024 * 1024) << "MiB" << ", New: " << new_mapsize / (1024 * 1024) << "MiB"
+      << ", txns held up for " << stall_us / 1000 << " ms");
+}
+
+uint64_t BlockchainLMDB::get_map_reservation(uint64_t size_used) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  // The map is only address space until pages get written, so reserve enough
+  // for the database to fill the disk, or to double in size, whichever is more.
+  // Growing the map has to wait for every txn to finish, so this makes it rare.
+  if (sizeof(size_t) < 8)
+    return 0;
+  uint64_t available = 0;
+  try
+  {
+    available = boost::filesystem::space(boost::filesystem::path(m_folder)).available;
+  }
+  catch(...)
+  {
+    MWARNING("Unable to query free disk space.");
+  }
+  const uint64_t granularity = 1ull << 30;
+  const uint64_t reservation = std::max(size_used + available, size_used * 2);
+  return (reservation + granularity - 1) / granularity * granularity;
 }
 
 // threshold_size is used for batch transactions
@@ -810,7 +910,8 @@ void BlockchainLMDB::add_block(const block& blk, size_t block_weight, uint64_t l
 
   // this call to mdb_cursor_put will change height()
   cryptonote::blobdata block_blob(block_to_blob(blk));
-  MDB_val_sized(blob, block_blob);
+  std::string compressed_blob;
+  MDB_val blob = stored_blob(block_blob_compressed(m_height), block_blob, compressed_blob);
   result = mdb_cursor_put(m_cur_blocks, &key, &blob, MDB_APPEND);
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to add block blob to db transaction: ", result).c_str()));
@@ -840,6 +941,17 @@ void BlockchainLMDB::add_block(const block& blk, size_t block_weight, uint64_t l
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to add block info to db transaction: ", result).c_str()));
 
+  if (m_rct_distribution_ready)
+  {
+    if (m_rct_distribution.pending_size() == m_height)
+    {
+      m_rct_distribution.push_back(bi.bi_cum_rct);
+      m_rct_distribution_state.changed(*m_write_txn);
+    }
+    else
+      m_rct_distribution_state.behind = true;
+  }
+
   result = mdb_cursor_put(m_cur_block_heights, (MDB_val *)&zerokval, &val_h, 0);
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to add block height by hash to db transaction: ", result).c_str()));
@@ -880,11 +992,23 @@ void BlockchainLMDB::remove_block()
   if ((result = mdb_cursor_del(m_cur_block_heights, 0)))
       throw1(DB_ERROR(lmdb_error("Failed to add removal of block height by hash to db transaction: ", result).c_str()));
 
-  if ((result = mdb_cursor_del(m_cur_blocks, 0)))
+  // a blob in cold storage stays there until the block there is moved again, and overwrites it
+  uint64_t cold_blocks_end, cold_txs_end;
+  get_cold_storage_ends(*m_write_txn, cold_blocks_end, cold_txs_end);
+  const bool cold = m_height - 1 < cold_blocks_end;
+  if (!cold && (result = mdb_cursor_del(m_cur_blocks, 0)))
       throw1(DB_ERROR(lmdb_error("Failed to add removal of block to db transaction: ", result).c_str()));
 
   if ((result = mdb_cursor_del(m_cur_block_info, 0)))
       throw1(DB_ERROR(lmdb_error("Failed to add removal of block info to db transaction: ", result).c_str()));
+  if (m_rct_distribution_ready)
+  {
+    m_rct_distribution.truncate(m_height - 1);
+    m_rct_distribution_state.truncated(*m_write_txn, m_height - 1);
+  }
+
+  if (cold)
+    set_cold_storage_ends(*m_write_txn, m_height - 1, cold_txs_end);
 }
 
 uint64_t BlockchainLMDB::add_transaction_data(const crypto::hash& blk_hash, const transaction& tx, const epee::span<const std::uint8_t> blob, const crypto::hash& tx_hash, const crypto::hash& tx_prunable_hash)
@@ -940,12 +1064,14 @@ uint64_t BlockchainLMDB::add_transaction_data(const crypto::hash& blk_hash, cons
   if (unprunable_size > blob.size())
     throw0(DB_ERROR("pruned tx size is larger than tx size"));
 
-  MDB_val pruned_blob = {unprunable_size, (void*)blob.data()};
+  const bool compressed = tx_blob_compressed(tx_id);
+  std::string compressed_blob;
+  MDB_val pruned_blob = stored_blob(compressed, {(const char*)blob.data(), unprunable_size}, compressed_blob);
   result = mdb_cursor_put(m_cur_txs_pruned, &val_tx_id, &pruned_blob, MDB_APPEND);
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to add pruned tx blob to db transaction: ", result).c_str()));
 
-  MDB_val prunable_blob = {blob.size() - unprunable_size, (void*)(blob.data() + unprunable_size)};
+  MDB_val prunable_blob = stored_blob(compressed, {(const char*)blob.data() + unprunable_size, blob.size() - unprunable_size}, compressed_blob);
   result = mdb_cursor_put(m_cur_txs_prunable, &val_tx_id, &prunable_blob, MDB_APPEND);
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to add prunable tx blob to db transaction: ", result).c_str()));
@@ -999,7 +1125,13 @@ void BlockchainLMDB::remove_transaction_data(const crypto::hash& tx_hash, const
   if (result)
       throw1(DB_ERROR(lmdb_error("Failed to add removal of pruned tx to db transaction: ", result).c_str()));
 
-  result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, NULL, MDB_SET);
+  // prunable data in cold storage stays there until the tx there is moved again, and overwrites it
+  uint64_t cold_blocks_end, cold_txs_end;
+  get_cold_storage_ends(*m_write_txn, cold_blocks_end, cold_txs_end);
+  const uint64_t tx_id = tip->data.tx_id;
+  const bool cold = tx_id < cold_txs_end;
+
+  result = cold ? MDB_NOTFOUND : mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, NULL, MDB_SET);
   if (result == 0)
   {
       result = mdb_cursor_del(m_cur_txs_prunable, 0);
@@ -1019,7 +1151,7 @@ void BlockchainLMDB::remove_transaction_data(const crypto::hash& tx_hash, const
         throw1(DB_ERROR(lmdb_error("Error adding removal of tx id to db transaction", result).c_str()));
   }
 
-  if (tx.version > 1)
+  if (tx.version > 1 && !cold)
   {
     if ((result = mdb_cursor_get(m_cur_txs_prunable_hash, &val_tx_id, NULL, MDB_SET)))
         throw1(DB_ERROR(lmdb_error("Failed to locate prunable hash tx for removal: ", result).c_str()));
@@ -1045,6 +1177,9 @@ void BlockchainLMDB::remove_transaction_data(const crypto::hash& tx_hash, const
   // Don't delete the tx_indices entry until the end, after we're done with val_tx_id
   if (mdb_cursor_del(m_cur_tx_indices, 0))
       throw1(DB_ERROR("Failed to add removal of tx index to db transaction"));
+
+  if (cold)
+    set_cold_storage_ends(*m_write_txn, cold_blocks_end, tx_id);
 }
 
 uint64_t BlockchainLMDB::add_output(const crypto::hash& tx_hash,
@@ -1111,6 +1246,17 @@ uint64_t BlockchainLMDB::add_output(const crypto::hash& tx_hash,
   if ((result = mdb_cursor_put(m_cur_output_amounts, &val_amount, &data, MDB_APPENDDUP)))
       throw0(DB_ERROR(lmdb_error("Failed to add output pubkey to db transaction: ", result).c_str()));
 
+  if (tx_output.amount == 0 && m_rct_column.is_open())
+  {
+    if (ok.amount_index == m_rct_column_pending)
+    {
+      m_rct_column.write(m_rct_column_pending++, ok.data);
+      m_rct_column_state.changed(*m_write_txn);
+    }
+    else
+      m_rct_column_state.behind = true;
+  }
+
   return ok.amount_index;
 }
 
@@ -1196,6 +1342,13 @@ void BlockchainLMDB::remove_output(const uint64_t amount, const uint64_t& out_in
   result = mdb_cursor_del(m_cur_output_amounts, 0);
   if (result)
     throw0(DB_ERROR(lmdb_error(std::string("Error deleting amount for output index ").append(boost::lexical_cast<std::string>(out_index).append(": ")).c_str(), result).c_str()));
+
+  if (amount == 0 && m_rct_column.is_open())
+  {
+    m_rct_column.truncate(out_index);
+    m_rct_column_pending = std::min(m_rct_column_pending, out_index);
+    m_rct_column_state.truncated(*m_write_txn, out_index);
+  }
 }
 
 void BlockchainLMDB::prune_outputs(uint64_t amount)
@@ -1267,6 +1420,14 @@ void BlockchainLMDB::add_spent_key(const crypto::key_image& k_image)
     else
       throw1(DB_ERROR(lmdb_error("Error adding spent key image to db transaction: ", result).c_str()));
   }
+
+  // if the txn is aborted, this only leaves a false positive behind
+  if (m_key_image_filter_ready.load(std::memory_order_acquire))
+  {
+    m_key_image_filter.insert(k_image);
+    if (m_key_image_filter.count() == m_key_image_filter.capacity() + 1)
+      MWARNING("Spent key image filter is over capacity, it will be resized on the next start");
+  }
 }
 
 void BlockchainLMDB::remove_spent_key(const crypto::key_image& k_image)
@@ -1316,6 +1477,14 @@ BlockchainLMDB::BlockchainLMDB(bool batch_transactions): BlockchainDB()
   m_batch_active = false;
   m_cum_size = 0;
   m_cum_count = 0;
+  m_has_derived_state = false;
+  m_key_image_filter_ready = false;
+  m_rct_column_pending = 0;
+  m_rct_distribution_ready = false;
+  m_compressed_blocks_end = 0;
+  m_compressed_txs_end = 0;
+  m_map_reserved = false;
+  m_cold_env = nullptr;
 
   // reset may also need changing when initialize things here
 
@@ -1434,7 +1603,7 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
     (result = mdb_env_set_maxreaders(m_env, threads+16)))
     throw0(DB_ERROR(lmdb_error("Failed to set max number of readers: ", result).c_str()));
 
-  size_t mapsize = DEFAULT_MAPSIZE;
+  uint64_t mapsize = DEFAULT_MAPSIZE;
 
   if (db_flags & DBF_FAST)
     mdb_flags |= MDB_NOSYNC;
@@ -1452,6 +1621,17 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
   mdb_env_info(m_env, &mei);
   uint64_t cur_mapsize = (uint64_t)mei.me_mapsize;
 
+#if defined(ENABLE_AUTO_RESIZE)
+  // with MDB_WRITEMAP the file is extended to the map size, so only reserve without it
+  m_map_reserved = !(mdb_flags & (MDB_RDONLY | MDB_WRITEMAP));
+  if (m_map_reserved)
+  {
+    MDB_stat mst;
+    mdb_env_stat(m_env, &mst);
+    mapsize = std::max(mapsize, get_map_reservation(mst.ms_psize * mei.me_last_pgno));
+  }
+#endif
+
   if (cur_mapsize < mapsize)
   {
     if (auto result = mdb_env_set_mapsize(m_env, mapsize))
@@ -1513,6 +1693,15 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
 
   lmdb_db_open(txn, LMDB_PROPERTIES, MDB_CREATE, m_properties, "Failed to open db handle for m_properties");
 
+  // derived state is only a cache, a read-only db without it just has none to offer
+  if (!(mdb_flags & MDB_RDONLY))
+  {
+    lmdb_db_open(txn, LMDB_DERIVED_STATE, MDB_CREATE, m_derived_state, "Failed to open db handle for m_derived_state");
+    m_has_derived_state = true;
+  }
+  else
+    m_has_derived_state = mdb_dbi_open(txn, LMDB_DERIVED_STATE, 0, &m_derived_state) == 0;
+
   mdb_set_dupsort(txn, m_spent_keys, compare_hash32);
   mdb_set_dupsort(txn, m_block_heights, compare_hash32);
   mdb_set_dupsort(txn, m_tx_indices, compare_hash32);
@@ -1538,8 +1727,8 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
 
   // get and keep current height
   MDB_stat db_stats;
-  if ((result = mdb_stat(txn, m_blocks, &db_stats)))
-    throw0(DB_ERROR(lmdb_error("Failed to query m_blocks: ", result).c_str()));
+  if ((result = mdb_stat(txn, m_block_info, &db_stats)))
+    throw0(DB_ERROR(lmdb_error("Failed to query m_block_info: ", result).c_str()));
   LOG_PRINT_L2("Setting m_height to: " << db_stats.ms_entries);
   uint64_t m_height = db_stats.ms_entries;
 
@@ -1597,6 +1786,9 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
     return;
   }
 
+  load_blob_compression(txn);
+  open_cold_storage(txn, mdb_flags);
+
   if (!(mdb_flags & MDB_RDONLY))
   {
     // only write version on an empty DB
@@ -1621,6 +1813,19 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
 
   m_open = true;
   // from here, init should be finished
+
+  // read-only users (mostly tools) do not pay for building a filter they would not keep
+  if (!(mdb_flags & MDB_RDONLY))
+  {
+    m_rct_column_state.reset();
+    m_rct_distribution_state.reset();
+    try { load_key_image_filter(); }
+    catch (const std::exception &e) { MERROR("Failed to set up the spent key image filter, it will not be used: " << e.what()); }
+    try { open_rct_column(); }
+    catch (const std::exception &e) { MERROR("Failed to set up the RingCT output column, it will not be used: " << e.what()); m_rct_column.close(); }
+    m_rct_distribution_ready = true;
+    sync_rct_distribution();
+  }
 }
 
 void BlockchainLMDB::close()
@@ -1631,11 +1836,24 @@ void BlockchainLMDB::close()
     LOG_PRINT_L3("close() first calling batch_abort() due to active batch transaction");
     BlockchainLMDB::batch_abort();
   }
+  try { save_key_image_filter(); }
+  catch (const std::exception &e) { MERROR("Failed to save the spent key image filter: " << e.what()); }
+  try { close_rct_column(); }
+  catch (const std::exception &e) { MERROR("Failed to save the RingCT output column state: " << e.what()); }
+  m_rct_column.close();
+  m_rct_distribution_ready = false;
+  m_rct_distribution.truncate(0);
+  m_key_image_filter_ready = false;
   BlockchainLMDB::sync();
   m_tinfo.reset();
 
   // FIXME: not yet thread safe!!!  Use with care.
   mdb_env_close(m_env);
+  if (m_cold_env)
+  {
+    mdb_env_close(m_cold_env);
+    m_cold_env = nullptr;
+  }
   m_open = false;
 }
 
@@ -1653,6 +1871,9 @@ void BlockchainLMDB::sync()
   {
     throw0(DB_ERROR(lmdb_error("Failed to sync database: ", result).c_str()));
   }
+  if (m_cold_env)
+    if (auto result = mdb_env_sync(m_cold_env, true))
+      throw0(DB_ERROR(lmdb_error("Failed to sync cold storage: ", result).c_str()));
 }
 
 void BlockchainLMDB::safesyncmode(const bool onoff)
@@ -1666,6 +1887,10 @@ void BlockchainLMDB::reset()
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   check_open();
 
+  // the filter is not consulted until m_spent_keys is committed empty; if that fails,
+  // it stays off, as the filter left behind is still a superset of the spent keys
+  const bool key_image_filter_was_ready = m_key_image_filter_ready.exchange(false);
+
   mdb_txn_safe txn;
   if (auto result = lmdb_txn_begin(m_env, NULL, 0, txn))
     throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
@@ -1694,11 +1919,24 @@ void BlockchainLMDB::reset()
     throw0(DB_ERROR(lmdb_error("Failed to drop m_output_amounts: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_spent_keys, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_spent_keys: ", result).c_str()));
+  m_rct_column.truncate(0);
+  m_rct_column_pending = 0;
+  m_rct_column_state.truncated(txn, 0);
+  m_rct_column_state.committed();
+  m_rct_distribution.truncate(0);
+  m_rct_distribution_state.truncated(txn, 0);
+  m_rct_distribution_state.committed();
+  m_blob_compressor.deinit();
+  m_compressed_blocks_end = 0;
+  m_compressed_txs_end = 0;
   (void)mdb_drop(txn, m_hf_starting_heights, 0); // this one is dropped in new code
   if (auto result = mdb_drop(txn, m_hf_versions, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_hf_versions: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_properties, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_properties: ", result).c_str()));
+  if (m_has_derived_state)
+    if (auto result = mdb_drop(txn, m_derived_state, 0))
+      throw0(DB_ERROR(lmdb_error("Failed to drop m_derived_state: ", result).c_str()));
 
   // init with current version
   MDB_val_str(k, "version");
@@ -1709,6 +1947,30 @@ void BlockchainLMDB::reset()
   txn.commit();
   m_cum_size = 0;
   m_cum_count = 0;
+
+  if (key_image_filter_was_ready)
+  {
+    m_key_image_filter.clear();
+    m_key_image_filter_ready = true;
+  }
+
+  // the cold ends went with m_properties, reclaim the space too
+  if (m_cold_env)
+  {
+    MDB_txn *cold_txn;
+    if (auto result = mdb_txn_begin(m_cold_env, NULL, 0, &cold_txn))
+      throw0(DB_ERROR(lmdb_error("Failed to create a transaction for cold storage: ", result).c_str()));
+    for (MDB_dbi dbi: {m_cold_blocks, m_cold_txs_prunable, m_cold_txs_prunable_hash})
+    {
+      if (auto result = mdb_drop(cold_txn, dbi, 0))
+      {
+        mdb_txn_abort(cold_txn);
+        throw0(DB_ERROR(lmdb_error("Failed to drop cold storage table: ", result).c_str()));
+      }
+    }
+    if (auto result = mdb_txn_commit(cold_txn))
+      throw0(DB_ERROR(lmdb_error("Failed to commit to cold storage: ", result).c_str()));
+  }
 }
 
 std::vector<std::string> BlockchainLMDB::get_filenames() const
@@ -1723,6 +1985,8 @@ std::vector<std::string> BlockchainLMDB::get_filenames() const
 
   filenames.push_back(datafile.string());
   filenames.push_back(lockfile.string());
+  if (m_rct_column.is_open())
+    filenames.push_back((boost::filesystem::path(m_folder) / RCT_OUTPUT_COLUMN_FILENAME).string());
 
   return filenames;
 }
@@ -2015,7 +2279,7 @@ uint32_t BlockchainLMDB::get_blockchain_pruning_seed() const
   return pruning_seed;
 }
 
-static bool is_v1_tx(MDB_cursor *c_txs_pruned, MDB_val *tx_id)
+static bool is_v1_tx(MDB_cursor *c_txs_pruned, MDB_val *tx_id, const cryptonote::blob_compressor *compressor)
 {
   MDB_val v;
   int ret = mdb_cursor_get(c_txs_pruned, tx_id, &v, MDB_SET);
@@ -2023,6 +2287,12 @@ static bool is_v1_tx(MDB_cursor *c_txs_pruned, MDB_val *tx_id)
     throw0(DB_ERROR(lmdb_error("Failed to find transaction pruned data: ", ret).c_str()));
   if (v.mv_size == 0)
     throw0(DB_ERROR("Invalid transaction pruned data"));
+  if (compressor)
+  {
+    cryptonote::blobdata bd;
+    compressor->decompress(cryptonote::blobdata_ref{(const char*)v.mv_data, v.mv_size}, bd);
+    return cryptonote::is_v1_tx(bd);
+  }
   return cryptonote::is_v1_tx(cryptonote::blobdata_ref{(const char*)v.mv_data, v.mv_size});
 }
 
@@ -2038,6 +2308,8 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
   if (pruning_seed > (1ul << CRYPTONOTE_PRUNING_LOG_STRIPES))
     throw0(DB_ERROR("Pruning seed not in range"));
   check_open();
+  if (mode == prune_mode_prune && m_cold_env)
+    throw0(DB_ERROR("Cannot prune a blockchain using cold storage"));
 
   TIME_MEASURE_START(t);
 
@@ -2132,7 +2404,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
       if (block_height + CRYPTONOTE_PRUNING_TIP_BLOCKS < blockchain_height)
       {
         ++n_total_records;
-        if (!tools::has_unpruned_block(block_height, blockchain_height, pruning_seed) && !is_v1_tx(c_txs_pruned, &k))
+        if (!tools::has_unpruned_block(block_height, blockchain_height, pruning_seed) && !is_v1_tx(c_txs_pruned, &k, tx_blob_compressor(*(const uint64_t*)k.mv_data)))
         {
           ++n_prunable_records;
           result = mdb_cursor_get(c_txs_prunable, &k, &v, MDB_SET);
@@ -2218,7 +2490,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
         }
       }
       MDB_val_set(kp, ti.data.tx_id);
-      if (!tools::has_unpruned_block(block_height, blockchain_height, pruning_seed) && !is_v1_tx(c_txs_pruned, &kp))
+      if (!tools::has_unpruned_block(block_height, blockchain_height, pruning_seed) && !is_v1_tx(c_txs_pruned, &kp, tx_blob_compressor(ti.data.tx_id)))
       {
         result = mdb_cursor_get(c_txs_prunable, &kp, &v, MDB_SET);
         if (result && result != MDB_NOTFOUND)
@@ -2326,6 +2598,190 @@ bool BlockchainLMDB::check_pruning()
   return prune_worker(prune_mode_check, 0);
 }
 
+bool BlockchainLMDB::prune_blockchain_step(uint32_t pruning_seed, uint64_t max_bytes, uint64_t max_txes, uint64_t &pruned_bytes)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  pruned_bytes = 0;
+  const uint32_t log_stripes = tools::get_pruning_log_stripes(pruning_seed);
+  if (log_stripes && log_stripes != CRYPTONOTE_PRUNING_LOG_STRIPES)
+    throw0(DB_ERROR("Pruning seed not in range"));
+  pruning_seed = tools::get_pruning_stripe(pruning_seed);
+  if (pruning_seed > (1ul << CRYPTONOTE_PRUNING_LOG_STRIPES))
+    throw0(DB_ERROR("Pruning seed not in range"));
+  check_open();
+  if (m_write_txn)
+    throw0(DB_ERROR("Cannot prune while a write txn is active"));
+  if (m_cold_env)
+    throw0(DB_ERROR("Cannot prune a blockchain using cold storage"));
+
+  if (need_resize())
+  {
+    LOG_PRINT_L0("LMDB memory map needs to be resized, doing that now.");
+    do_resize();
+  }
+
+  mdb_txn_safe txn;
+  auto result = mdb_txn_begin(m_env, NULL, 0, txn);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+
+  MDB_val_str(k, "pruning_seed");
+  MDB_val_str(pk, PRUNING_PROGRESS_KEY);
+  MDB_val v;
+  pruning_progress progress;
+  result = mdb_get(txn, m_properties, &k, &v);
+  if (result == MDB_NOTFOUND)
+  {
+    // not pruned yet, existing txes are looked at from the first on, new ones go to the tip table
+    if (pruning_seed == 0)
+      pruning_seed = tools::get_random_stripe();
+    pruning_seed = tools::make_pruning_seed(pruning_seed, CRYPTONOTE_PRUNING_LOG_STRIPES);
+    v.mv_data = &pruning_seed;
+    v.mv_size = sizeof(pruning_seed);
+    result = mdb_put(txn, m_properties, &k, &v, 0);
+    if (result)
+      throw0(DB_ERROR("Failed to save pruning seed"));
+    progress.next = crypto::null_hash;
+    progress.done = 0;
+    MINFO("Pruning blockchain step by step, with seed " << epee::string_tools::to_string_hex(pruning_seed));
+  }
+  else if (result == 0)
+  {
+    if (v.mv_size != sizeof(uint32_t))
+      throw0(DB_ERROR("Failed to retrieve or create pruning seed: unexpected value size"));
+    const uint32_t data = *(const uint32_t*)v.mv_data;
+    if (pruning_seed != 0 && tools::get_pruning_stripe(data) != pruning_seed)
+      throw0(DB_ERROR("Blockchain already pruned with different seed"));
+    if (tools::get_pruning_log_stripes(data) != CRYPTONOTE_PRUNING_LOG_STRIPES)
+      throw0(DB_ERROR("Blockchain already pruned with different base"));
+    pruning_seed = data;
+    result = mdb_get(txn, m_properties, &pk, &v);
+    if (result == MDB_NOTFOUND)
+      return true; // done, or pruned in one go
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to retrieve pruning progress: ", result).c_str()));
+    if (v.mv_size != sizeof(progress))
+      throw0(DB_ERROR("Failed to retrieve pruning progress: unexpected value size"));
+    memcpy(&progress, v.mv_data, sizeof(progress));
+  }
+  else
+  {
+    throw0(DB_ERROR(lmdb_error("Failed to retrieve or create pruning seed: ", result).c_str()));
+  }
+
+  MDB_cursor *c_txs_pruned, *c_txs_prunable, *c_txs_prunable_tip, *c_tx_indices;
+  result = mdb_cursor_open(txn, m_txs_pruned, &c_txs_pruned);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_pruned: ", result).c_str()));
+  result = mdb_cursor_open(txn, m_txs_prunable, &c_txs_prunable);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_prunable: ", result).c_str()));
+  result = mdb_cursor_open(txn, m_txs_prunable_tip, &c_txs_prunable_tip);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_prunable_tip: ", result).c_str()));
+  result = mdb_cursor_open(txn, m_tx_indices, &c_tx_indices);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to open a cursor for tx_indices: ", result).c_str()));
+  const uint64_t blockchain_height = height();
+
+  MDB_val ki;
+  MDB_val vi = {sizeof(progress.next), (void*)&progress.next};
+  int ret = progress.done == 0 ?
+      mdb_cursor_get(c_tx_indices, &ki, &vi, MDB_FIRST) :
+      mdb_cursor_get(c_tx_indices, (MDB_val*)&zerokval, &vi, MDB_GET_BOTH_RANGE);
+  uint64_t n_txes = 0;
+  while (ret == 0 && n_txes < max_txes && pruned_bytes < max_bytes)
+  {
+    txindex ti;
+    memcpy(&ti, vi.mv_data, sizeof(ti));
+    const uint64_t block_height = ti.data.block_id;
+    MDB_val_set(kp, ti.data.tx_id);
+    if (block_height + CRYPTONOTE_PRUNING_TIP_BLOCKS >= blockchain_height)
+    {
+      // update_pruning will prune it once it leaves the tip
+      MDB_val_set(vp, block_height);
+      result = mdb_cursor_put(c_txs_prunable_tip, &kp, &vp, 0);
+      if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to add transaction to the prunable tip table: ", result).c_str()));
+    }
+    else if (!tools::has_unpruned_block(block_height, blockchain_height, pruning_seed) && !is_v1_tx(c_txs_pruned, &kp, tx_blob_compressor(ti.data.tx_id)))
+    {
+      result = mdb_cursor_get(c_txs_prunable, &kp, &v, MDB_SET);
+      if (result == 0)
+      {
+        pruned_bytes += kp.mv_size + v.mv_size;
+        result = mdb_cursor_del(c_txs_prunable, 0);
+        if (result)
+          throw0(DB_ERROR(lmdb_error("Failed to delete transaction prunable data: ", result).c_str()));
+      }
+      else if (result != MDB_NOTFOUND)
+        throw0(DB_ERROR(lmdb_error("Error looking for transaction prunable data: ", result).c_str()));
+    }
+    ++n_txes;
+    ret = mdb_cursor_get(c_tx_indices, &ki, &vi, MDB_NEXT);
+  }
+  if (ret && ret != MDB_NOTFOUND)
+    throw0(DB_ERROR(lmdb_error("Failed to enumerate transactions: ", ret).c_str()));
+
+  const bool done = ret == MDB_NOTFOUND;
+  if (done)
+  {
+    result = mdb_del(txn, m_properties, &pk, NULL);
+    if (result && result != MDB_NOTFOUND)
+      throw0(DB_ERROR(lmdb_error("Failed to delete pruning progress: ", result).c_str()));
+  }
+  else
+  {
+    memcpy(&progress.next, vi.mv_data, sizeof(progress.next));
+    progress.done += n_txes;
+    MDB_val_set(pv, progress);
+    result = mdb_put(txn, m_properties, &pk, &pv, 0);
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to save pruning progress: ", result).c_str()));
+  }
+
+  mdb_cursor_close(c_tx_indices);
+  mdb_cursor_close(c_txs_prunable_tip);
+  mdb_cursor_close(c_txs_prunable);
+  mdb_cursor_close(c_txs_pruned);
+  txn.commit();
+
+  MDEBUG("Pruning step looked at " << n_txes << " txes and pruned " << pruned_bytes << " bytes");
+  if (done)
+    MINFO("Step by step pruning is done");
+  return done;
+}
+
+bool BlockchainLMDB::get_pruning_progress(uint64_t &done, uint64_t &total) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+
+  MDB_val_str(k, PRUNING_PROGRESS_KEY);
+  MDB_val v;
+  int result = mdb_get(m_txn, m_properties, &k, &v);
+  if (result == MDB_NOTFOUND)
+    return false;
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to retrieve pruning progress: ", result).c_str()));
+  if (v.mv_size != sizeof(pruning_progress))
+    throw0(DB_ERROR("Failed to retrieve pruning progress: unexpected value size"));
+  pruning_progress progress;
+  memcpy(&progress, v.mv_data, sizeof(progress));
+
+  MDB_stat db_stats;
+  if ((result = mdb_stat(m_txn, m_tx_indices, &db_stats)))
+    throw0(DB_ERROR(lmdb_error("Failed to query m_tx_indices: ", result).c_str()));
+
+  TXN_POSTFIX_RDONLY();
+
+  total = db_stats.ms_entries;
+  done = std::min(progress.done, total);
+  return true;
+}
+
 bool BlockchainLMDB::for_all_txpool_txes(std::function<bool(const crypto::hash&, const txpool_tx_meta_t&, const cryptonote::blobdata_ref*)> f, bool include_blob, relay_category category) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -2495,6 +2951,16 @@ cryptonote::blobdata BlockchainLMDB::get_block_blob_from_height(const uint64_t&
   TXN_PREFIX_RDONLY();
   RCURSOR(blocks);
 
+  blobdata bd;
+  uint64_t cold_blocks_end, cold_txs_end;
+  get_cold_storage_ends(m_txn, cold_blocks_end, cold_txs_end);
+  if (height < cold_blocks_end)
+  {
+    if (!get_cold(m_cold_blocks, height, [&](const MDB_val &cv) { load_blob(block_blob_compressed(height), cv, bd); }))
+      throw0(DB_ERROR("Block missing from cold storage"));
+    return bd;
+  }
+
   MDB_val_copy<uint64_t> key(height);
   MDB_val result;
   auto get_result = mdb_cursor_get(m_cur_blocks, &key, &result, MDB_SET);
@@ -2505,8 +2971,7 @@ cryptonote::blobdata BlockchainLMDB::get_block_blob_from_height(const uint64_t&
   else if (get_result)
     throw0(DB_ERROR("Error attempting to retrieve a block from the db"));
 
-  blobdata bd;
-  bd.assign(reinterpret_cast<char*>(result.mv_data), result.mv_size);
+  load_blob(block_blob_compressed(height), result, bd);
 
   TXN_POSTFIX_RDONLY();
 
@@ -2551,8 +3016,8 @@ std::vector<uint64_t> BlockchainLMDB::get_block_cumulative_rct_outputs(const std
   RCURSOR(block_info);
 
   MDB_stat db_stats;
-  if ((result = mdb_stat(m_txn, m_blocks, &db_stats)))
-    throw0(DB_ERROR(lmdb_error("Failed to query m_blocks: ", result).c_str()));
+  if ((result = mdb_stat(m_txn, m_block_info, &db_stats)))
+    throw0(DB_ERROR(lmdb_error("Failed to query m_block_info: ", result).c_str()));
   for (size_t i = 0; i < heights.size(); ++i)
     if (heights[i] >= db_stats.ms_entries)
       throw0(BLOCK_DNE(std::string("Attempt to get rct distribution from height " + std::to_string(heights[i]) + " failed -- block size not in db").c_str()));
@@ -2916,8 +3381,8 @@ uint64_t BlockchainLMDB::height() const
 
   // get current height
   MDB_stat db_stats;
-  if ((result = mdb_stat(m_txn, m_blocks, &db_stats)))
-    throw0(DB_ERROR(lmdb_error("Failed to query m_blocks: ", result).c_str()));
+  if ((result = mdb_stat(m_txn, m_block_info, &db_stats)))
+    throw0(DB_ERROR(lmdb_error("Failed to query m_block_info: ", result).c_str()));
   return db_stats.ms_entries;
 }
 
@@ -3042,13 +3507,17 @@ bool BlockchainLMDB::get_tx_blob(const crypto::hash& h, cryptonote::blobdata &bd
 
   MDB_val_set(v, h);
   MDB_val result0, result1;
+  uint64_t tx_id = 0;
+  uint64_t cold_blocks_end, cold_txs_end;
+  get_cold_storage_ends(m_txn, cold_blocks_end, cold_txs_end);
   auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val *)&zerokval, &v, MDB_GET_BOTH);
   if (get_result == 0)
   {
     txindex *tip = (txindex *)v.mv_data;
-    MDB_val_set(val_tx_id, tip->data.tx_id);
+    tx_id = tip->data.tx_id;
+    MDB_val_set(val_tx_id, tx_id);
     get_result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result0, MDB_SET);
-    if (get_result == 0)
+    if (get_result == 0 && tx_id >= cold_txs_end)
     {
       get_result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, &result1, MDB_SET);
     }
@@ -3058,8 +3527,11 @@ bool BlockchainLMDB::get_tx_blob(const crypto::hash& h, cryptonote::blobdata &bd
   else if (get_result)
     throw0(DB_ERROR(lmdb_error("DB error attempting to fetch tx from hash", get_result).c_str()));
 
-  bd.assign(reinterpret_cast<char*>(result0.mv_data), result0.mv_size);
-  bd.append(reinterpret_cast<char*>(result1.mv_data), result1.mv_size);
+  const bool compressed = tx_blob_compressed(tx_id);
+  load_blob(compressed, result0, bd);
+  if (tx_id < cold_txs_end)
+    return get_cold(m_cold_txs_prunable, tx_id, [&](const MDB_val &cv) { load_blob(compressed, cv, bd, true); });
+  load_blob(compressed, result1, bd, true);
 
   TXN_POSTFIX_RDONLY();
 
@@ -3077,11 +3549,13 @@ bool BlockchainLMDB::get_pruned_tx_blob(const crypto::hash& h, cryptonote::blobd
 
   MDB_val_set(v, h);
   MDB_val result;
+  uint64_t tx_id = 0;
   auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val *)&zerokval, &v, MDB_GET_BOTH);
   if (get_result == 0)
   {
     txindex *tip = (txindex *)v.mv_data;
-    MDB_val_set(val_tx_id, tip->data.tx_id);
+    tx_id = tip->data.tx_id;
+    MDB_val_set(val_tx_id, tx_id);
     get_result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result, MDB_SET);
   }
   if (get_result == MDB_NOTFOUND)
@@ -3089,7 +3563,7 @@ bool BlockchainLMDB::get_pruned_tx_blob(const crypto::hash& h, cryptonote::blobd
   else if (get_result)
     throw0(DB_ERROR(lmdb_error("DB error attempting to fetch tx from hash", get_result).c_str()));
 
-  bd.assign(reinterpret_cast<char*>(result.mv_data), result.mv_size);
+  load_blob(tx_blob_compressed(tx_id), result, bd);
 
   TXN_POSTFIX_RDONLY();
 
@@ -3130,7 +3604,8 @@ bool BlockchainLMDB::get_pruned_tx_blobs_from(const crypto::hash& h, size_t coun
       return false;
     if (res)
       throw0(DB_ERROR(lmdb_error("DB error attempting to fetch tx blob", res).c_str()));
-    bd.emplace_back(reinterpret_cast<char*>(result.mv_data), result.mv_size);
+    bd.emplace_back();
+    load_blob(tx_blob_compressed(*(const uint64_t*)val_tx_id.mv_data), result, bd.back());
   }
 
   TXN_POSTFIX_RDONLY();
@@ -3206,25 +3681,56 @@ bool BlockchainLMDB::get_blocks_from(uint64_t start_height, size_t min_block_cou
 
   blocks.reserve(std::min<size_t>(max_block_count, 10000)); // guard against very large max count if only checking bytes
   const uint64_t blockchain_height = height();
+  uint64_t cold_blocks_end, cold_txs_end;
+  get_cold_storage_ends(m_txn, cold_blocks_end, cold_txs_end);
   uint64_t size = 0;
   size_t num_txes = 0;
-  MDB_val_copy<uint64_t> key(start_height);
+  uint64_t key_height = std::max(start_height, cold_blocks_end);
+  MDB_val key = {sizeof(key_height), (void*)&key_height};
   MDB_val v, val_tx_id;
   uint64_t tx_id = ~0;
+
+  // the cursors skip over what is in cold storage, and need setting again after it
+  bool prunable_positioned = false;
+  const auto get_prunable = [&](cryptonote::blobdata *tx_blob, bool compressed) {
+    const uint64_t id = *(const uint64_t*)val_tx_id.mv_data;
+    if (id < cold_txs_end)
+    {
+      if (tx_blob && !get_cold(m_cold_txs_prunable, id, [&](const MDB_val &cv) { load_blob(compressed, cv, *tx_blob, true); }))
+        throw0(DB_ERROR("Transaction data missing from cold storage"));
+      return;
+    }
+    int result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, &v, prunable_positioned ? MDB_NEXT : MDB_SET);
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Error attempting to retrieve transaction data from the db: ", result).c_str()));
+    prunable_positioned = true;
+    if (tx_blob)
+      load_blob(compressed, v, *tx_blob, true);
+  };
+
   for (uint64_t h = start_height; h < blockchain_height && blocks.size() < max_block_count && (size < max_size || blocks.size() < min_block_count); ++h)
   {
     MDB_cursor_op op = h == start_height ? MDB_SET : MDB_NEXT;
-    int result = mdb_cursor_get(m_cur_blocks, &key, &v, op);
-    if (result == MDB_NOTFOUND)
-      throw0(BLOCK_DNE(std::string("Attempt to get block from height ").append(boost::lexical_cast<std::string>(h)).append(" failed -- block not in db").c_str()));
-    else if (result)
-      throw0(DB_ERROR(lmdb_error("Error attempting to retrieve a block from the db", result).c_str()));
+    int result;
 
     blocks.resize(blocks.size() + 1);
     auto &current_block = blocks.back();
 
-    current_block.first.first.assign(reinterpret_cast<char*>(v.mv_data), v.mv_size);
-    size += v.mv_size;
+    if (h < cold_blocks_end)
+    {
+      if (!get_cold(m_cold_blocks, h, [&](const MDB_val &cv) { load_blob(block_blob_compressed(h), cv, current_block.first.first); }))
+        throw0(BLOCK_DNE(std::string("Attempt to get block from height ").append(boost::lexical_cast<std::string>(h)).append(" failed -- block not in cold storage").c_str()));
+    }
+    else
+    {
+      result = mdb_cursor_get(m_cur_blocks, &key, &v, h == key_height ? MDB_SET : MDB_NEXT);
+      if (result == MDB_NOTFOUND)
+        throw0(BLOCK_DNE(std::string("Attempt to get block from height ").append(boost::lexical_cast<std::string>(h)).append(" failed -- block not in db").c_str()));
+      else if (result)
+        throw0(DB_ERROR(lmdb_error("Error attempting to retrieve a block from the db", result).c_str()));
+      load_blob(block_blob_compressed(h), v, current_block.first.first);
+    }
+    size += current_block.first.first.size();
 
     cryptonote::block b;
     if (!parse_and_validate_block_from_blob(current_block.first.first, b))
@@ -3251,11 +3757,7 @@ bool BlockchainLMDB::get_blocks_from(uint64_t start_height, size_t min_block_cou
       if (result)
         throw0(DB_ERROR(lmdb_error("Error attempting to retrieve transaction data from the db: ", result).c_str()));
       if (!pruned)
-      {
-        result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, &v, op);
-        if (result)
-          throw0(DB_ERROR(lmdb_error("Error attempting to retrieve transaction data from the db: ", result).c_str()));
-      }
+        get_prunable(nullptr, false);
     }
 
     op = MDB_NEXT;
@@ -3269,15 +3771,11 @@ bool BlockchainLMDB::get_blocks_from(uint64_t start_height, size_t min_block_cou
       result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &v, op);
       if (result)
         throw0(DB_ERROR(lmdb_error("Error attempting to retrieve transaction data from the db: ", result).c_str()));
-      tx_blob.assign((const char*)v.mv_data, v.mv_size);
+      const bool compressed = tx_blob_compressed(*(const uint64_t*)val_tx_id.mv_data);
+      load_blob(compressed, v, tx_blob);
 
       if (!pruned)
-      {
-        result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, &v, op);
-        if (result)
-          throw0(DB_ERROR(lmdb_error("Error attempting to retrieve transaction data from the db: ", result).c_str()));
-        tx_blob.append(reinterpret_cast<const char*>(v.mv_data), v.mv_size);
-      }
+        get_prunable(&tx_blob, compressed);
       current_block.second.push_back(std::make_pair(tx_hash, std::move(tx_blob)));
       size += current_block.second.back().second.size();
     }
@@ -3302,11 +3800,17 @@ bool BlockchainLMDB::get_prunable_tx_blob(const crypto::hash& h, cryptonote::blo
 
   MDB_val_set(v, h);
   MDB_val result;
+  uint64_t tx_id = 0;
   auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val *)&zerokval, &v, MDB_GET_BOTH);
   if (get_result == 0)
   {
     const txindex *tip = (const txindex *)v.mv_data;
-    MDB_val_set(val_tx_id, tip->data.tx_id);
+    tx_id = tip->data.tx_id;
+    uint64_t cold_blocks_end, cold_txs_end;
+    get_cold_storage_ends(m_txn, cold_blocks_end, cold_txs_end);
+    if (tx_id < cold_txs_end)
+      return get_cold(m_cold_txs_prunable, tx_id, [&](const MDB_val &cv) { load_blob(tx_blob_compressed(tx_id), cv, bd); });
+    MDB_val_set(val_tx_id, tx_id);
     get_result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, &result, MDB_SET);
   }
   if (get_result == MDB_NOTFOUND)
@@ -3314,7 +3818,7 @@ bool BlockchainLMDB::get_prunable_tx_blob(const crypto::hash& h, cryptonote::blo
   else if (get_result)
     throw0(DB_ERROR(lmdb_error("DB error attempting to fetch tx from hash", get_result).c_str()));
 
-  bd.assign(reinterpret_cast<char*>(result.mv_data), result.mv_size);
+  load_blob(tx_blob_compressed(tx_id), result, bd);
 
   TXN_POSTFIX_RDONLY();
 
@@ -3336,6 +3840,10 @@ bool BlockchainLMDB::get_prunable_tx_hash(const crypto::hash& tx_hash, crypto::h
   if (get_result == 0)
   {
     txindex *tip = (txindex *)v.mv_data;
+    uint64_t cold_blocks_end, cold_txs_end;
+    get_cold_storage_ends(m_txn, cold_blocks_end, cold_txs_end);
+    if (tip->data.tx_id < cold_txs_end)
+      return get_cold(m_cold_txs_prunable_hash, tip->data.tx_id, [&](const MDB_val &cv) { prunable_hash = *(const crypto::hash*)cv.mv_data; });
     MDB_val_set(val_tx_id, tip->data.tx_id);
     get_result = mdb_cursor_get(m_cur_txs_prunable_hash, &val_tx_id, &result, MDB_SET);
   }
@@ -3435,6 +3943,20 @@ output_data_t BlockchainLMDB::get_output_key(const uint64_t& amount, const uint6
   check_open();
 
   TXN_PREFIX_RDONLY();
+
+  output_data_t ret;
+  if (amount == 0)
+  {
+    const bool from_column = m_rct_column.with_records([&](const output_data_t *records, uint64_t size) {
+      if (index >= size || index >= rct_column_readable(m_txn, size))
+        return false;
+      ret = records[index];
+      return true;
+    });
+    if (from_column)
+      return ret;
+  }
+
   RCURSOR(output_amounts);
 
   MDB_val_set(k, amount);
@@ -3446,7 +3968,6 @@ output_data_t BlockchainLMDB::get_output_key(const uint64_t& amount, const uint6
   else if (get_result)
     throw0(DB_ERROR("Error attempting to retrieve an output pubkey from the db"));
 
-  output_data_t ret;
   if (amount == 0)
   {
     const outkey *okp = (const outkey *)v.mv_data;
@@ -3547,6 +4068,9 @@ bool BlockchainLMDB::has_key_image(const crypto::key_image& img) const
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   check_open();
 
+  if (m_key_image_filter_ready.load(std::memory_order_acquire) && !m_key_image_filter.may_contain(img))
+    return false;
+
   bool ret;
 
   TXN_PREFIX_RDONLY();
@@ -3566,11 +4090,26 @@ std::vector<bool> BlockchainLMDB::has_key_images(const epee::span<const crypto::
 
   std::vector<bool> ret(img.size(), true);
 
+  bool any_maybe_spent = true;
+  if (m_key_image_filter_ready.load(std::memory_order_acquire))
+  {
+    any_maybe_spent = false;
+    for (std::size_t i = 0; i < img.size(); ++i)
+    {
+      ret[i] = m_key_image_filter.may_contain(img[i]);
+      any_maybe_spent |= ret[i];
+    }
+  }
+  if (!any_maybe_spent)
+    return ret;
+
   TXN_PREFIX_RDONLY();
   RCURSOR(spent_keys);
 
   for (std::size_t i = 0; i < img.size(); ++i)
   {
+    if (!ret[i])
+      continue;
     crypto::key_image ki = img[i];
     MDB_val k = {sizeof(ki), reinterpret_cast<void*>(&ki)};
     ret[i] = (mdb_cursor_get(m_cur_spent_keys, const_cast<MDB_val *>(&zerokval), &k, MDB_GET_BOTH) == 0);
@@ -3624,38 +4163,50 @@ bool BlockchainLMDB::for_blocks_range(const uint64_t& h1, const uint64_t& h2, st
   MDB_val k;
   MDB_val v;
   bool fret = true;
+  bool done = false;
 
-  MDB_cursor_op op;
-  if (h1)
-  {
-    k = MDB_val{sizeof(h1), (void*)&h1};
-    op = MDB_SET;
-  } else
-  {
-    op = MDB_FIRST;
-  }
-  while (1)
-  {
-    int ret = mdb_cursor_get(m_cur_blocks, &k, &v, op);
-    op = MDB_NEXT;
-    if (ret == MDB_NOTFOUND)
-      break;
-    if (ret)
-      throw0(DB_ERROR("Failed to enumerate blocks"));
-    uint64_t height = *(const uint64_t*)k.mv_data;
-    blobdata_ref bd{reinterpret_cast<char*>(v.mv_data), v.mv_size};
+  const auto process = [&](uint64_t height, const MDB_val &bv) {
+    blobdata bd;
+    load_blob(block_blob_compressed(height), bv, bd);
     block b;
     if (!parse_and_validate_block_from_blob(bd, b))
       throw0(DB_ERROR("Failed to parse block from blob retrieved from the db"));
     crypto::hash hash;
     if (!get_block_hash(b, hash))
         throw0(DB_ERROR("Failed to get block hash from blob retrieved from the db"));
-    if (!f(height, hash, b)) {
+    if (!f(height, hash, b))
       fret = false;
+    done = !fret || height >= h2;
+  };
+
+  // older blocks may be in cold storage
+  uint64_t cold_blocks_end, cold_txs_end;
+  get_cold_storage_ends(m_txn, cold_blocks_end, cold_txs_end);
+  uint64_t start = h1;
+  for (; start < cold_blocks_end && !done; ++start)
+  {
+    if (!get_cold(m_cold_blocks, start, [&](const MDB_val &cv) { process(start, cv); }))
+      throw0(DB_ERROR("Failed to enumerate blocks"));
+  }
+
+  MDB_cursor_op op;
+  if (start)
+  {
+    k = MDB_val{sizeof(start), (void*)&start};
+    op = MDB_SET;
+  } else
+  {
+    op = MDB_FIRST;
+  }
+  while (!done)
+  {
+    int ret = mdb_cursor_get(m_cur_blocks, &k, &v, op);
+    op = MDB_NEXT;
+    if (ret == MDB_NOTFOUND)
       break;
-    }
-    if (height >= h2)
-      break;
+    if (ret)
+      throw0(DB_ERROR("Failed to enumerate blocks"));
+    process(*(const uint64_t*)k.mv_data, v);
   }
 
   TXN_POSTFIX_RDONLY();
@@ -3676,6 +4227,8 @@ bool BlockchainLMDB::for_all_transactions(std::function<bool(const crypto::hash&
   MDB_val k;
   MDB_val v;
   bool fret = true;
+  uint64_t cold_blocks_end, cold_txs_end;
+  get_cold_storage_ends(m_txn, cold_blocks_end, cold_txs_end);
 
   MDB_cursor_op op = MDB_FIRST;
   while (1)
@@ -3698,20 +4251,30 @@ bool BlockchainLMDB::for_all_transactions(std::function<bool(const crypto::hash&
     if (ret)
       throw0(DB_ERROR(lmdb_error("Failed to enumerate transactions: ", ret).c_str()));
     transaction tx;
+    const bool compressed = tx_blob_compressed(ti->data.tx_id);
     if (pruned)
     {
-      blobdata_ref bd{reinterpret_cast<char*>(v.mv_data), v.mv_size};
+      blobdata bd;
+      load_blob(compressed, v, bd);
       if (!parse_and_validate_tx_base_from_blob(bd, tx))
         throw0(DB_ERROR("Failed to parse tx from blob retrieved from the db"));
     }
     else
     {
       blobdata bd;
-      bd.assign(reinterpret_cast<char*>(v.mv_data), v.mv_size);
-      ret = mdb_cursor_get(m_cur_txs_prunable, &k, &v, MDB_SET);
-      if (ret)
-        throw0(DB_ERROR(lmdb_error("Failed to get prunable tx data the db: ", ret).c_str()));
-      bd.append(reinterpret_cast<char*>(v.mv_data), v.mv_size);
+      load_blob(compressed, v, bd);
+      if (ti->data.tx_id < cold_txs_end)
+      {
+        if (!get_cold(m_cold_txs_prunable, ti->data.tx_id, [&](const MDB_val &cv) { load_blob(compressed, cv, bd, true); }))
+          throw0(DB_ERROR("Failed to get prunable tx data from cold storage"));
+      }
+      else
+      {
+        ret = mdb_cursor_get(m_cur_txs_prunable, &k, &v, MDB_SET);
+        if (ret)
+          throw0(DB_ERROR(lmdb_error("Failed to get prunable tx data the db: ", ret).c_str()));
+        load_blob(compressed, v, bd, true);
+      }
       if (!parse_and_validate_tx_from_blob(bd, tx))
         throw0(DB_ERROR("Failed to parse tx from blob retrieved from the db"));
     }
@@ -3870,6 +4433,8 @@ void BlockchainLMDB::batch_commit()
   delete m_write_batch_txn;
   m_write_batch_txn = nullptr;
   memset(&m_wcursors, 0, sizeof(m_wcursors));
+  end_rct_column_txn(true);
+  end_rct_distribution_txn(true);
 }
 
 void BlockchainLMDB::cleanup_batch()
@@ -3902,10 +4467,14 @@ void BlockchainLMDB::batch_stop()
     TIME_MEASURE_FINISH(time1);
     time_commit1 += time1;
     cleanup_batch();
+    end_rct_column_txn(true);
+    end_rct_distribution_txn(true);
   }
   catch (const std::exception &e)
   {
     cleanup_batch();
+    end_rct_column_txn(false);
+    end_rct_distribution_txn(false);
     throw;
   }
   LOG_PRINT_L3("batch transaction: end");
@@ -3931,6 +4500,8 @@ void BlockchainLMDB::batch_abort()
   m_write_batch_txn = nullptr;
   m_batch_active = false;
   memset(&m_wcursors, 0, sizeof(m_wcursors));
+  end_rct_column_txn(false);
+  end_rct_distribution_txn(false);
   LOG_PRINT_L3("batch transaction: aborted");
 }
 
@@ -3946,6 +4517,12 @@ void BlockchainLMDB::set_batch_transactions(bool batch_transactions)
 }
 
 // return true if we started the txn, false if already started
+bool BlockchainLMDB::block_rtxn_pinned() const
+{
+  const mdb_threadinfo *tinfo = m_tinfo.get();
+  return tinfo && tinfo->m_ti_rflags.m_rf_txn && mdb_txn_env(tinfo->m_ti_rtxn) == m_env;
+}
+
 bool BlockchainLMDB::block_rtxn_start(MDB_txn **mtxn, mdb_txn_cursors **mcur) const
 {
   bool ret = false;
@@ -4055,6 +4632,8 @@ void BlockchainLMDB::block_wtxn_stop()
       delete m_write_txn;
       m_write_txn = nullptr;
       memset(&m_wcursors, 0, sizeof(m_wcursors));
+      end_rct_column_txn(true);
+      end_rct_distribution_txn(true);
 	}
   }
 }
@@ -4072,6 +4651,8 @@ void BlockchainLMDB::block_wtxn_abort()
     delete m_write_txn;
     m_write_txn = nullptr;
     memset(&m_wcursors, 0, sizeof(m_wcursors));
+    end_rct_column_txn(false);
+    end_rct_distribution_txn(false);
   }
 }
 
@@ -4171,6 +4752,26 @@ void BlockchainLMDB::get_output_key(const epee::span<const uint64_t> &amounts, c
 
   TXN_PREFIX_RDONLY();
 
+  // a ring of RingCT outputs comes straight from the column if it has all of them
+  if (amounts.size() == 1 && amounts[0] == 0)
+  {
+    const bool from_column = m_rct_column.with_records([&](const output_data_t *records, uint64_t size) {
+      size = rct_column_readable(m_txn, size);
+      for (const uint64_t offset: offsets)
+        if (offset >= size)
+          return false;
+      for (const uint64_t offset: offsets)
+        outputs.push_back(records[offset]);
+      return true;
+    });
+    if (from_column)
+    {
+      TIME_MEASURE_FINISH(db3);
+      LOG_PRINT_L3("db3: " << db3);
+      return;
+    }
+  }
+
   RCURSOR(output_amounts);
 
   for (size_t i = 0; i < offsets.size(); ++i)
@@ -4213,6 +4814,94 @@ void BlockchainLMDB::get_output_key(const epee::span<const uint64_t> &amounts, c
   LOG_PRINT_L3("db3: " << db3);
 }
 
+void BlockchainLMDB::get_output_keys_sorted(const std::vector<std::pair<uint64_t, uint64_t>> &amount_indices, std::vector<output_data_t> &outputs, std::vector<bool> &found) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  TIME_MEASURE_START(db3);
+  check_open();
+  outputs.clear();
+  outputs.resize(amount_indices.size());
+  found.clear();
+  found.resize(amount_indices.size(), false);
+
+  TXN_PREFIX_RDONLY();
+
+  // RingCT outputs sort first, and are read from the column when it has them
+  size_t first = 0;
+  m_rct_column.with_records([&](const output_data_t *records, uint64_t size) {
+    size = rct_column_readable(m_txn, size);
+    for (; first < amount_indices.size() && amount_indices[first].first == 0 && amount_indices[first].second < size; ++first)
+    {
+      outputs[first] = records[amount_indices[first].second];
+      found[first] = true;
+    }
+  });
+
+  RCURSOR(output_amounts);
+
+  // the pairs are sorted, so a single cursor walks output_amounts in key order:
+  // nearby indices of the same amount are reached by stepping along the
+  // duplicates, which stay on pages we just touched, rather than descending
+  // the tree again for every ring member
+  bool positioned = false;
+  uint64_t cur_amount = 0, cur_index = 0;
+  for (size_t i = first; i < amount_indices.size(); ++i)
+  {
+    const uint64_t amount = amount_indices[i].first;
+    const uint64_t index = amount_indices[i].second;
+    MDB_val k, v;
+    int get_result;
+
+    if (positioned && amount == cur_amount && index > cur_index && index - cur_index <= OUTPUT_KEYS_MAX_CURSOR_STEP)
+    {
+      do
+      {
+        get_result = mdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_NEXT_DUP);
+      } while (get_result == 0 && ++cur_index < index);
+    }
+    else
+    {
+      MDB_val_set(kk, amount);
+      MDB_val_set(vv, index);
+      get_result = mdb_cursor_get(m_cur_output_amounts, &kk, &vv, MDB_GET_BOTH);
+      v = vv;
+    }
+
+    if (get_result == MDB_NOTFOUND)
+    {
+      positioned = false;
+      continue;
+    }
+    else if (get_result)
+      throw0(DB_ERROR(lmdb_error("Error attempting to retrieve an output pubkey from the db", get_result).c_str()));
+
+    // both outkey and pre_rct_outkey start with the amount index
+    if (*(const uint64_t*)v.mv_data != index)
+      throw0(DB_ERROR("Unexpected amount index while walking the output amounts table"));
+
+    if (amount == 0)
+    {
+      const outkey *okp = (const outkey *)v.mv_data;
+      outputs[i] = okp->data;
+    }
+    else
+    {
+      const pre_rct_outkey *okp = (const pre_rct_outkey *)v.mv_data;
+      memcpy(&outputs[i], &okp->data, sizeof(pre_rct_output_data_t));
+      outputs[i].commitment = rct::zeroCommit(amount);
+    }
+    found[i] = true;
+    positioned = true;
+    cur_amount = amount;
+    cur_index = index;
+  }
+
+  TXN_POSTFIX_RDONLY();
+
+  TIME_MEASURE_FINISH(db3);
+  LOG_PRINT_L3("db3: " << db3);
+}
+
 void BlockchainLMDB::get_output_tx_and_index(const uint64_t& amount, const std::vector<uint64_t> &offsets, std::vector<tx_out_index> &indices) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -4342,6 +5031,26 @@ std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> BlockchainLMDB::get
   return histogram;
 }
 
+std::vector<uint64_t> BlockchainLMDB::get_block_cumulative_rct_outputs_range(uint64_t start_height, size_t count) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+
+  std::vector<uint64_t> res;
+  const bool from_cache = m_rct_distribution.with_entries([&](const uint64_t *entries, uint64_t size) {
+    size = rct_distribution_readable(m_txn, size);
+    if (start_height > size || count > size - start_height)
+      return false;
+    res.assign(entries + start_height, entries + start_height + count);
+    return true;
+  });
+  if (from_cache)
+    return res;
+  return BlockchainDB::get_block_cumulative_rct_outputs_range(start_height, count);
+}
+
 bool BlockchainLMDB::get_output_distribution(uint64_t amount, uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &distribution, uint64_t &base) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -4360,7 +5069,38 @@ bool BlockchainLMDB::get_output_distribution(uint64_t amount, uint64_t from_heig
   MDB_val v;
   MDB_cursor_op op = MDB_SET;
   base = 0;
-  while (1)
+
+  // RingCT output heights grow with the amount index, so the column needs no tree walk
+  bool from_column = false;
+  if (amount == 0 && m_rct_column.size() > 0)
+  {
+    mdb_size_t num_elems = 0;
+    int ret = mdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_SET);
+    if (ret == 0)
+      ret = mdb_cursor_count(m_cur_output_amounts, &num_elems);
+    if (ret && ret != MDB_NOTFOUND)
+      throw0(DB_ERROR(lmdb_error("Failed to count outputs: ", ret).c_str()));
+    from_column = m_rct_column.with_records([&](const output_data_t *records, uint64_t size) {
+      size = std::min<uint64_t>(size, num_elems);
+      if (size < num_elems || rct_column_readable(m_txn, size) < size)
+        return false;
+      const output_data_t *first = std::lower_bound(records, records + size, from_height,
+          [](const output_data_t &o, uint64_t h) { return o.height < h; });
+      base = first - records;
+      for (const output_data_t *o = first; o < records + size; ++o)
+      {
+        // outputs committed after this read txn started are not part of its distribution
+        if (o->height >= db_height)
+          break;
+        distribution[o->height - from_height]++;
+        if (to_height > 0 && o->height > to_height)
+          break;
+      }
+      return true;
+    });
+  }
+
+  while (!from_column)
   {
     int ret = mdb_cursor_get(m_cur_output_amounts, &k, &v, op);
     op = MDB_NEXT_DUP;
@@ -4447,6 +5187,875 @@ uint8_t BlockchainLMDB::get_hard_fork_version(uint64_t height) const
   return ret;
 }
 
+void BlockchainLMDB::set_derived_state(const std::string &name, const crypto::hash &top_hash, const std::string &state)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  if (!m_has_derived_state)
+    throw0(DB_ERROR("Derived state table is not available"));
+
+  TXN_BLOCK_PREFIX(0);
+
+  MDB_val k = {name.size(), (void *)name.data()};
+  std::string value;
+  value.reserve(sizeof(top_hash) + state.size());
+  value.append((const char *)&top_hash, sizeof(top_hash));
+  value.append(state);
+  MDB_val v = {value.size(), (void *)value.data()};
+  if (auto result = mdb_put(*txn_ptr, m_derived_state, &k, &v, 0))
+    throw1(DB_ERROR(lmdb_error("Error adding derived state " + name + " to db transaction: ", result).c_str()));
+
+  TXN_BLOCK_POSTFIX_SUCCESS();
+}
+
+bool BlockchainLMDB::get_derived_state(const std::string &name, crypto::hash &top_hash, std::string &state) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  if (!m_has_derived_state)
+    return false;
+
+  TXN_PREFIX_RDONLY();
+
+  MDB_val k = {name.size(), (void *)name.data()};
+  MDB_val v;
+  auto result = mdb_get(m_txn, m_derived_state, &k, &v);
+  if (result == MDB_NOTFOUND)
+    return false;
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Error attempting to retrieve derived state " + name + " from the db: ", result).c_str()));
+  if (v.mv_size < sizeof(top_hash))
+    throw0(DB_ERROR("Record size is less than expected"));
+
+  memcpy(&top_hash, v.mv_data, sizeof(top_hash));
+  state.assign((const char *)v.mv_data + sizeof(top_hash), v.mv_size - sizeof(top_hash));
+
+  TXN_POSTFIX_RDONLY();
+  return true;
+}
+
+void BlockchainLMDB::load_key_image_filter()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  crypto::hash top_hash;
+  std::string state;
+  if (get_derived_state(KEY_IMAGE_FILTER_STATE_NAME, top_hash, state) && top_hash == top_block_hash())
+  {
+    if (m_key_image_filter.load(state) && m_key_image_filter.count() <= m_key_image_filter.capacity())
+    {
+      MINFO("Loaded spent key image filter (" << m_key_image_filter.count() << " key images)");
+      m_key_image_filter_ready = true;
+      return;
+    }
+  }
+  build_key_image_filter();
+}
+
+void BlockchainLMDB::build_key_image_filter()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  uint64_t num_key_images;
+  {
+    TXN_PREFIX_RDONLY();
+    MDB_stat db_stats;
+    if (auto result = mdb_stat(m_txn, m_spent_keys, &db_stats))
+      throw0(DB_ERROR(lmdb_error("Failed to query m_spent_keys: ", result).c_str()));
+    num_key_images = db_stats.ms_entries;
+    TXN_POSTFIX_RDONLY();
+  }
+
+  TIME_MEASURE_START(t);
+  m_key_image_filter.reset(key_image_filter::capacity_for(num_key_images));
+
+  // key images are sorted on their last 32 bit word (see compare_hash32), so split that range
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  const uint64_t threads = std::max<uint64_t>(1, tpool.get_max_concurrency());
+  const uint64_t range = ((uint64_t)1 << 32) / threads;
+  tools::threadpool::waiter waiter(tpool);
+  std::atomic<bool> failed(false);
+  for (uint64_t i = 0; i < threads; ++i)
+  {
+    const uint32_t begin = i * range;
+    const uint32_t end = i + 1 == threads ? 0 : (i + 1) * range; // 0: up to the last key image
+    tpool.submit(&waiter, [this, begin, end, &failed]() {
+      try { add_key_images_to_filter(begin, end); }
+      catch (const std::exception &e) { MERROR("Failed to read key images: " << e.what()); failed = true; }
+    });
+  }
+  if (!waiter.wait() || failed)
+    throw0(DB_ERROR("Failed to build the spent key image filter"));
+  TIME_MEASURE_FINISH(t);
+
+  MINFO("Built spent key image filter (" << m_key_image_filter.count() << " key images) in " << t << " ms");
+  m_key_image_filter_ready = true;
+}
+
+void BlockchainLMDB::add_key_images_to_filter(uint32_t begin, uint32_t end)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(spent_keys);
+
+  // compare_hash32 compares the words in host byte order
+  crypto::key_image start = crypto::key_image{};
+  memcpy(reinterpret_cast<unsigned char*>(&start) + sizeof(start) - sizeof(begin), &begin, sizeof(begin));
+
+  MDB_val k = zerokval;
+  MDB_val v = {sizeof(start), (void *)&start};
+  MDB_cursor_op op = MDB_GET_BOTH_RANGE;
+  while (1)
+  {
+    int ret = mdb_cursor_get(m_cur_spent_keys, &k, &v, op);
+    op = MDB_NEXT_DUP;
+    if (ret == MDB_NOTFOUND)
+      break;
+    if (ret)
+      throw0(DB_ERROR(lmdb_error("Failed to enumerate key images: ", ret).c_str()));
+    const crypto::key_image k_image = *(const crypto::key_image*)v.mv_data;
+    uint32_t last_word;
+    memcpy(&last_word, reinterpret_cast<const unsigned char*>(&k_image) + sizeof(k_image) - sizeof(last_word), sizeof(last_word));
+    if (end && last_word >= end)
+      break;
+    m_key_image_filter.insert(k_image);
+  }
+
+  TXN_POSTFIX_RDONLY();
+}
+
+void BlockchainLMDB::save_key_image_filter()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  if (!m_key_image_filter_ready || !m_has_derived_state || is_read_only())
+    return;
+  set_derived_state(KEY_IMAGE_FILTER_STATE_NAME, top_block_hash(), m_key_image_filter.save());
+}
+
+void mdb_cache_state::reset()
+{
+  behind = false;
+  pending_txnid = 0;
+  pending_truncated = std::numeric_limits<uint64_t>::max();
+  txnid = 0;
+  rewrite_txnid = 0;
+  rewritten_from = std::numeric_limits<uint64_t>::max();
+}
+
+void mdb_cache_state::truncated(MDB_txn *txn, uint64_t index)
+{
+  changed(txn);
+  pending_truncated = std::min(pending_truncated, index);
+}
+
+void mdb_cache_state::committed()
+{
+  // stored before the entries are published, so readers which see them also see these
+  if (pending_truncated != std::numeric_limits<uint64_t>::max())
+  {
+    rewritten_from = std::min<uint64_t>(rewritten_from, pending_truncated);
+    rewrite_txnid = pending_txnid;
+  }
+  if (pending_txnid)
+    txnid = pending_txnid;
+  pending_txnid = 0;
+  pending_truncated = std::numeric_limits<uint64_t>::max();
+}
+
+void mdb_cache_state::aborted()
+{
+  pending_txnid = 0;
+  pending_truncated = std::numeric_limits<uint64_t>::max();
+  behind = true;
+}
+
+void mdb_cache_state::synced(MDB_txn *txn)
+{
+  txnid = mdb_txn_id(txn);
+  behind = false;
+}
+
+void BlockchainLMDB::open_rct_column()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  // without somewhere to record a clean close, a crash could go unnoticed
+  if (!m_has_derived_state)
+    return;
+  const boost::filesystem::path filename = boost::filesystem::path(m_folder) / RCT_OUTPUT_COLUMN_FILENAME;
+  if (!m_rct_column.open(filename.string()))
+    return;
+
+  const uint64_t num_rct_outputs = get_num_outputs(0);
+  uint64_t trusted = 0;
+  crypto::hash top_hash;
+  std::string state;
+  if (get_derived_state(RCT_OUTPUT_COLUMN_STATE_NAME, top_hash, state) && top_hash == top_block_hash() && state.size() == sizeof(uint64_t))
+  {
+    uint64_t saved_size;
+    memcpy(&saved_size, state.data(), sizeof(saved_size));
+    if (saved_size == num_rct_outputs && saved_size <= m_rct_column.capacity())
+      trusted = saved_size;
+  }
+
+  // the file is written behind the database, so it is only trusted again after a clean close
+  set_derived_state(RCT_OUTPUT_COLUMN_STATE_NAME, crypto::null_hash, std::string());
+
+  m_rct_column.publish(trusted);
+  m_rct_column_pending = trusted;
+  m_rct_column_state.behind = trusted < num_rct_outputs;
+  if (m_rct_column_state.behind)
+  {
+    MINFO("Rebuilding RingCT output column from output " << trusted << " of " << num_rct_outputs);
+    sync_rct_column();
+  }
+}
+
+void BlockchainLMDB::close_rct_column()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  if (!m_rct_column.is_open() || m_rct_column_state.behind)
+    return;
+  const uint64_t size = m_rct_column.size();
+  if (size != get_num_outputs(0) || !m_rct_column.flush())
+    return;
+  set_derived_state(RCT_OUTPUT_COLUMN_STATE_NAME, top_block_hash(), std::string((const char*)&size, sizeof(size)));
+}
+
+void BlockchainLMDB::sync_rct_column()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  if (!m_rct_column.is_open())
+    return;
+
+  try
+  {
+    TXN_PREFIX_RDONLY();
+    RCURSOR(output_amounts);
+
+    const uint64_t amount = 0;
+    const uint64_t start = m_rct_column_pending;
+    MDB_val_set(k, amount);
+    MDB_val_set(v, start);
+    MDB_cursor_op op = MDB_GET_BOTH;
+    while (1)
+    {
+      int ret = mdb_cursor_get(m_cur_output_amounts, &k, &v, op);
+      op = MDB_NEXT_DUP;
+      if (ret == MDB_NOTFOUND)
+        break;
+      if (ret)
+        throw0(DB_ERROR(lmdb_error("Failed to enumerate RingCT outputs: ", ret).c_str()));
+      const outkey *ok = (const outkey *)v.mv_data;
+      if (ok->amount_index != m_rct_column_pending)
+        throw0(DB_ERROR("Unexpected amount index while filling the RingCT output column"));
+      m_rct_column.write(m_rct_column_pending++, ok->data);
+    }
+
+    TXN_POSTFIX_RDONLY();
+    m_rct_column_state.synced(m_txn);
+    m_rct_column.publish(m_rct_column_pending);
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Failed to fill the RingCT output column, it will not be used: " << e.what());
+    m_rct_column.close();
+  }
+}
+
+void BlockchainLMDB::end_rct_column_txn(bool committed)
+{
+  if (!m_rct_column.is_open())
+    return;
+  if (committed)
+  {
+    m_rct_column_state.committed();
+    m_rct_column.publish(m_rct_column_pending);
+  }
+  else
+  {
+    // outputs the aborted txn removed are back, and the records past size() may have been overwritten
+    m_rct_column_pending = m_rct_column.size();
+    m_rct_column_state.aborted();
+  }
+  if (m_rct_column_state.behind)
+    sync_rct_column();
+}
+
+uint64_t BlockchainLMDB::rct_column_readable(MDB_txn *txn, uint64_t size) const
+{
+  return m_rct_column_state.readable(txn, size, [this]() { return get_num_outputs(0); });
+}
+
+void BlockchainLMDB::sync_rct_distribution()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  if (!m_rct_distribution_ready)
+    return;
+
+  try
+  {
+    TXN_PREFIX_RDONLY();
+    RCURSOR(block_info);
+
+    uint64_t height = m_rct_distribution.pending_size();
+    MDB_val_set(v, height);
+    MDB_cursor_op op = MDB_GET_BOTH;
+    while (1)
+    {
+      int ret = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &v, op);
+      op = MDB_NEXT_DUP;
+      if (ret == MDB_NOTFOUND)
+        break;
+      if (ret)
+        throw0(DB_ERROR(lmdb_error("Failed to enumerate block info: ", ret).c_str()));
+      const mdb_block_info *bi = (const mdb_block_info *)v.mv_data;
+      if (bi->bi_height != m_rct_distribution.pending_size())
+        throw0(DB_ERROR("Unexpected height while filling the RingCT distribution"));
+      m_rct_distribution.push_back(bi->bi_cum_rct);
+    }
+
+    TXN_POSTFIX_RDONLY();
+    m_rct_distribution_state.synced(m_txn);
+    m_rct_distribution.publish(m_rct_distribution.pending_size());
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Failed to fill the RingCT distribution, it will not be used: " << e.what());
+    m_rct_distribution_ready = false;
+    m_rct_distribution.truncate(0);
+  }
+}
+
+void BlockchainLMDB::end_rct_distribution_txn(bool committed)
+{
+  if (!m_rct_distribution_ready)
+    return;
+  if (committed)
+  {
+    m_rct_distribution_state.committed();
+    m_rct_distribution.publish(m_rct_distribution.pending_size());
+  }
+  else
+  {
+    // blocks the aborted txn added are gone, and those it removed are back
+    m_rct_distribution.truncate(m_rct_distribution.size());
+    m_rct_distribution_state.aborted();
+  }
+  if (m_rct_distribution_state.behind)
+    sync_rct_distribution();
+}
+
+uint64_t BlockchainLMDB::rct_distribution_readable(MDB_txn *txn, uint64_t size) const
+{
+  return m_rct_distribution_state.readable(txn, size, [this]() { return height(); });
+}
+
+void BlockchainLMDB::load_blob_compression(MDB_txn *txn)
+{
+  m_blob_compressor.deinit();
+  m_compressed_blocks_end = 0;
+  m_compressed_txs_end = 0;
+
+  MDB_val_str(k, BLOB_COMPRESSION_KEY);
+  MDB_val v;
+  int result = mdb_get(txn, m_properties, &k, &v);
+  if (result == MDB_NOTFOUND)
+    return;
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to retrieve blob compression state: ", result).c_str()));
+  if (v.mv_size != sizeof(blob_compression_state))
+    throw0(DB_ERROR("Invalid blob compression state"));
+  blob_compression_state state;
+  memcpy(&state, v.mv_data, sizeof(state));
+  if (state.version != BLOB_COMPRESSION_VERSION)
+    throw0(DB_ERROR(("Unknown blob compression version " + std::to_string(state.version)).c_str()));
+  if (!blob_compressor::available())
+    throw0(DB_ERROR("The database is compressed, but this build has no zstd support"));
+
+  std::string dictionary;
+  MDB_val_str(dk, BLOB_DICTIONARY_KEY);
+  result = mdb_get(txn, m_properties, &dk, &v);
+  if (result == 0)
+    dictionary.assign((const char*)v.mv_data, v.mv_size);
+  else if (result != MDB_NOTFOUND)
+    throw0(DB_ERROR(lmdb_error("Failed to retrieve blob compression dictionary: ", result).c_str()));
+
+  m_blob_compressor.init(dictionary, state.level);
+  m_compressed_blocks_end = state.blocks_end;
+  m_compressed_txs_end = state.txs_end;
+  MINFO("Blobs are stored compressed, " << (dictionary.empty() ? "without a dictionary" : "with a dictionary"));
+}
+
+void BlockchainLMDB::load_blob(bool compressed, const MDB_val &v, cryptonote::blobdata &bd, bool append) const
+{
+  const cryptonote::blobdata_ref stored{(const char*)v.mv_data, v.mv_size};
+  if (!compressed)
+  {
+    if (append)
+      bd.append(stored.data(), stored.size());
+    else
+      bd.assign(stored.data(), stored.size());
+    return;
+  }
+  if (!append)
+  {
+    m_blob_compressor.decompress(stored, bd);
+    return;
+  }
+  cryptonote::blobdata blob;
+  m_blob_compressor.decompress(stored, blob);
+  bd.append(blob);
+}
+
+MDB_val BlockchainLMDB::stored_blob(bool compressed, const cryptonote::blobdata_ref &blob, std::string &buffer) const
+{
+  if (!compressed)
+    return MDB_val{blob.size(), (void*)blob.data()};
+  m_blob_compressor.compress(blob, buffer);
+  return MDB_val{buffer.size(), (void*)buffer.data()};
+}
+
+void BlockchainLMDB::compress_blobs(int level, size_t dictionary_size)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  if (m_write_txn)
+    throw0(DB_ERROR("Cannot compress blobs while a write txn is active"));
+  if (!blob_compressor::available())
+    throw0(DB_ERROR("This build has no zstd support, blobs cannot be compressed"));
+  {
+    uint64_t cold_blocks_end, cold_txs_end;
+    TXN_PREFIX_RDONLY();
+    get_cold_storage_ends(m_txn, cold_blocks_end, cold_txs_end);
+    TXN_POSTFIX_RDONLY();
+    if (cold_blocks_end || cold_txs_end)
+      throw0(DB_ERROR("Cannot compress blobs once data was moved to cold storage"));
+  }
+
+  int result;
+  blob_compression_state state;
+  state.version = BLOB_COMPRESSION_VERSION;
+  state.level = m_blob_compressor.is_init() ? m_blob_compressor.level() : level;
+  state.blocks_end = m_compressed_blocks_end;
+  state.txs_end = m_compressed_txs_end;
+
+  if (!m_blob_compressor.is_init())
+  {
+    // train on evenly spaced blocks and pruned txes; prunable data is mostly signatures and proofs,
+    // which no dictionary helps with
+    std::string dictionary;
+    if (dictionary_size > 0)
+    {
+      std::vector<cryptonote::blobdata> samples;
+      const uint64_t blockchain_height = height(), tx_count = get_tx_count();
+      for (uint64_t h = 0; h < blockchain_height; h += std::max<uint64_t>(1, blockchain_height / BLOB_DICTIONARY_SAMPLES))
+        samples.push_back(get_block_blob_from_height(h));
+      {
+        TXN_PREFIX_RDONLY();
+        RCURSOR(txs_pruned);
+        for (uint64_t tx_id = 0; tx_id < tx_count; tx_id += std::max<uint64_t>(1, tx_count / BLOB_DICTIONARY_SAMPLES))
+        {
+          MDB_val_set(k, tx_id);
+          MDB_val v;
+          result = mdb_cursor_get(m_cur_txs_pruned, &k, &v, MDB_SET);
+          if (result)
+            throw0(DB_ERROR(lmdb_error("Failed to retrieve pruned tx blob: ", result).c_str()));
+          samples.emplace_back((const char*)v.mv_data, v.mv_size);
+        }
+        TXN_POSTFIX_RDONLY();
+      }
+      MINFO("Training blob compression dictionary on " << samples.size() << " samples");
+      dictionary = blob_compressor::train_dictionary(samples, dictionary_size);
+    }
+
+    mdb_txn_safe txn;
+    if ((result = mdb_txn_begin(m_env, NULL, 0, txn)))
+      throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+    MDB_val_str(dk, BLOB_DICTIONARY_KEY);
+    MDB_val dv{dictionary.size(), (void*)dictionary.data()};
+    if (!dictionary.empty() && (result = mdb_put(txn, m_properties, &dk, &dv, 0)))
+      throw0(DB_ERROR(lmdb_error("Failed to save blob compression dictionary: ", result).c_str()));
+    MDB_val_str(k, BLOB_COMPRESSION_KEY);
+    MDB_val_set(v, state);
+    if ((result = mdb_put(txn, m_properties, &k, &v, 0)))
+      throw0(DB_ERROR(lmdb_error("Failed to save blob compression state: ", result).c_str()));
+    txn.commit();
+    m_blob_compressor.init(dictionary, state.level);
+  }
+
+  // rewrites the records of one table from begin on, a chunk per txn, and returns the new end
+  const auto compress_table = [&](const char *name, uint64_t begin, uint64_t end, uint64_t &state_end, std::initializer_list<MDB_dbi> dbis)
+  {
+    uint64_t key = begin;
+    while (key < end)
+    {
+      if (need_resize())
+      {
+        LOG_PRINT_L0("LMDB memory map needs to be resized, doing that now.");
+        do_resize();
+      }
+      mdb_txn_safe txn;
+      if ((result = mdb_txn_begin(m_env, NULL, 0, txn)))
+        throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+      const uint64_t chunk_end = std::min<uint64_t>(end, key + BLOB_COMPRESSION_CHUNK);
+      std::string buffer;
+      for (MDB_dbi dbi: dbis)
+      {
+        MDB_cursor *cursor;
+        if ((result = mdb_cursor_open(txn, dbi, &cursor)))
+          throw0(DB_ERROR(lmdb_error("Failed to open a cursor: ", result).c_str()));
+        for (uint64_t i = key; i < chunk_end; ++i)
+        {
+          MDB_val_set(k, i);
+          MDB_val v;
+          result = mdb_cursor_get(cursor, &k, &v, MDB_SET);
+          if (result == MDB_NOTFOUND)
+            continue; // pruned
+          if (result)
+            throw0(DB_ERROR(lmdb_error(std::string("Failed to retrieve ") + name + " blob: ", result).c_str()));
+          MDB_val stored = stored_blob(true, {(const char*)v.mv_data, v.mv_size}, buffer);
+          if ((result = mdb_cursor_put(cursor, &k, &stored, MDB_CURRENT)))
+            throw0(DB_ERROR(lmdb_error(std::string("Failed to store compressed ") + name + " blob: ", result).c_str()));
+        }
+        mdb_cursor_close(cursor);
+      }
+      state_end = chunk_end == end ? BLOB_COMPRESSION_ALL : chunk_end;
+      MDB_val_str(k, BLOB_COMPRESSION_KEY);
+      MDB_val_set(v, state);
+      if ((result = mdb_put(txn, m_properties, &k, &v, 0)))
+        throw0(DB_ERROR(lmdb_error("Failed to save blob compression state: ", result).c_str()));
+      txn.commit();
+      key = chunk_end;
+      if ((key / BLOB_COMPRESSION_CHUNK) % 100 == 0 || key == end)
+        MGINFO("Compressed " << name << " blobs: " << key << " / " << end);
+    }
+    // nothing left to do, make new records compressed from now on
+    if (state_end != BLOB_COMPRESSION_ALL)
+    {
+      mdb_txn_safe txn;
+      if ((result = mdb_txn_begin(m_env, NULL, 0, txn)))
+        throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+      state_end = BLOB_COMPRESSION_ALL;
+      MDB_val_str(k, BLOB_COMPRESSION_KEY);
+      MDB_val_set(v, state);
+      if ((result = mdb_put(txn, m_properties, &k, &v, 0)))
+        throw0(DB_ERROR(lmdb_error("Failed to save blob compression state: ", result).c_str()));
+      txn.commit();
+    }
+  };
+
+  MGINFO("Compressing block blobs");
+  compress_table("block", m_compressed_blocks_end, height(), state.blocks_end, {m_blocks});
+  m_compressed_blocks_end = state.blocks_end;
+  MGINFO("Compressing transaction blobs");
+  compress_table("transaction", m_compressed_txs_end, get_tx_count(), state.txs_end, {m_txs_pruned, m_txs_prunable});
+  m_compressed_txs_end = state.txs_end;
+  MGINFO("All blobs are compressed");
+}
+
+bool BlockchainLMDB::blobs_compressed() const
+{
+  return m_compressed_blocks_end == BLOB_COMPRESSION_ALL && m_compressed_txs_end == BLOB_COMPRESSION_ALL;
+}
+
+uint64_t BlockchainLMDB::get_blob_tables_size() const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+  uint64_t size = 0;
+  for (MDB_dbi dbi: {m_blocks, m_txs_pruned, m_txs_prunable})
+  {
+    MDB_stat db_stats;
+    if (int result = mdb_stat(m_txn, dbi, &db_stats))
+      throw0(DB_ERROR(lmdb_error("Failed to query blob table: ", result).c_str()));
+    size += (db_stats.ms_branch_pages + db_stats.ms_leaf_pages + db_stats.ms_overflow_pages) * (uint64_t)db_stats.ms_psize;
+  }
+  TXN_POSTFIX_RDONLY();
+  return size;
+}
+
+void BlockchainLMDB::set_cold_storage(const std::string& folder)
+{
+  if (m_open)
+    throw0(DB_ERROR("Cold storage must be set before the database is opened"));
+  m_cold_folder = folder;
+}
+
+void BlockchainLMDB::open_cold_storage(MDB_txn *txn, int mdb_flags)
+{
+  uint64_t blocks_end = 0, txs_end = 0;
+  MDB_val_str(k, COLD_STORAGE_KEY);
+  MDB_val v;
+  int result = mdb_get(txn, m_properties, &k, &v);
+  if (result == 0)
+  {
+    if (v.mv_size != sizeof(cold_storage_state))
+      throw0(DB_ERROR("Invalid cold storage state"));
+    const cold_storage_state *state = (const cold_storage_state*)v.mv_data;
+    blocks_end = state->blocks_end;
+    txs_end = state->txs_end;
+  }
+  else if (result != MDB_NOTFOUND)
+    throw0(DB_ERROR(lmdb_error("Failed to retrieve cold storage state: ", result).c_str()));
+
+  if (m_cold_folder.empty())
+  {
+    if (blocks_end || txs_end)
+      throw0(DB_ERROR("Part of the database was moved to cold storage, the cold storage folder must be given"));
+    return;
+  }
+
+  // pruning deletes prunable data without looking in cold storage
+  MDB_val_str(pk, "pruning_seed");
+  result = mdb_get(txn, m_properties, &pk, &v);
+  if (result == 0)
+    throw0(DB_ERROR("Cold storage is not supported on a pruned database"));
+  else if (result != MDB_NOTFOUND)
+    throw0(DB_ERROR(lmdb_error("Failed to retrieve pruning seed: ", result).c_str()));
+
+  boost::filesystem::path direc(m_cold_folder);
+  if (!boost::filesystem::exists(direc) && !boost::filesystem::create_directories(direc))
+    throw0(DB_ERROR(std::string("Failed to create directory ").append(m_cold_folder).c_str()));
+
+  if ((result = mdb_env_create(&m_cold_env)))
+    throw0(DB_ERROR(lmdb_error("Failed to create lmdb environment for cold storage: ", result).c_str()));
+  if ((result = mdb_env_set_maxdbs(m_cold_env, 4)))
+    throw0(DB_ERROR(lmdb_error("Failed to set max number of dbs for cold storage: ", result).c_str()));
+  // each cold read has a short lived txn of its own, which may nest in a hot one
+  const int cold_flags = (mdb_flags & ~(MDB_WRITEMAP | MDB_MAPASYNC)) | MDB_NOTLS;
+  if ((result = mdb_env_open(m_cold_env, m_cold_folder.c_str(), cold_flags, 0644)))
+    throw0(DB_ERROR(lmdb_error("Failed to open lmdb environment for cold storage: ", result).c_str()));
+
+  // cold readers are not counted by mdb_txn_safe, so the map is never resized
+  // while running: reserve enough for the cold disk to fill up instead
+  if (!(mdb_flags & MDB_RDONLY))
+  {
+    MDB_envinfo mei;
+    mdb_env_info(m_cold_env, &mei);
+    MDB_stat mst;
+    mdb_env_stat(m_cold_env, &mst);
+    const uint64_t size_used = mst.ms_psize * mei.me_last_pgno;
+    uint64_t available = 0;
+    try { available = boost::filesystem::space(direc).available; }
+    catch (...) { MWARNING("Unable to query free disk space for cold storage."); }
+    const uint64_t mapsize = std::max<uint64_t>(std::max(size_used + available, 2 * size_used), DEFAULT_MAPSIZE);
+    if (mapsize > mei.me_mapsize && (result = mdb_env_set_mapsize(m_cold_env, mapsize)))
+      throw0(DB_ERROR(lmdb_error("Failed to set cold storage map size: ", result).c_str()));
+  }
+
+  MDB_txn *cold_txn;
+  if ((result = mdb_txn_begin(m_cold_env, NULL, mdb_flags & MDB_RDONLY, &cold_txn)))
+    throw0(DB_ERROR(lmdb_error("Failed to create a transaction for cold storage: ", result).c_str()));
+  const int create = (mdb_flags & MDB_RDONLY) ? 0 : MDB_CREATE;
+  lmdb_db_open(cold_txn, LMDB_BLOCKS, MDB_INTEGERKEY | create, m_cold_blocks, "Failed to open db handle for cold m_blocks");
+  lmdb_db_open(cold_txn, LMDB_TXS_PRUNABLE, MDB_INTEGERKEY | create, m_cold_txs_prunable, "Failed to open db handle for cold m_txs_prunable");
+  lmdb_db_open(cold_txn, LMDB_TXS_PRUNABLE_HASH, MDB_INTEGERKEY | create, m_cold_txs_prunable_hash, "Failed to open db handle for cold m_txs_prunable_hash");
+  mdb_set_compare(cold_txn, m_cold_blocks, compare_uint64);
+  mdb_set_compare(cold_txn, m_cold_txs_prunable, compare_uint64);
+  mdb_set_compare(cold_txn, m_cold_txs_prunable_hash, compare_uint64);
+  if ((result = mdb_txn_commit(cold_txn)))
+    throw0(DB_ERROR(lmdb_error("Failed to commit cold storage tables: ", result).c_str()));
+  MINFO("Cold storage in " << m_cold_folder << " holds blocks below " << blocks_end << " and transactions below " << txs_end);
+}
+
+void BlockchainLMDB::get_cold_storage_ends(MDB_txn *txn, uint64_t &blocks_end, uint64_t &txs_end) const
+{
+  blocks_end = 0;
+  txs_end = 0;
+  if (!m_cold_env)
+    return;
+
+  // read within the caller's txn, so the ends always match what the hot tables hold
+  MDB_val_str(k, COLD_STORAGE_KEY);
+  MDB_val v;
+  int result = mdb_get(txn, m_properties, &k, &v);
+  if (result == MDB_NOTFOUND)
+    return;
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to retrieve cold storage state: ", result).c_str()));
+  if (v.mv_size != sizeof(cold_storage_state))
+    throw0(DB_ERROR("Invalid cold storage state"));
+  const cold_storage_state *state = (const cold_storage_state*)v.mv_data;
+  blocks_end = state->blocks_end;
+  txs_end = state->txs_end;
+}
+
+void BlockchainLMDB::set_cold_storage_ends(MDB_txn *txn, uint64_t blocks_end, uint64_t txs_end)
+{
+  cold_storage_state state;
+  state.blocks_end = blocks_end;
+  state.txs_end = txs_end;
+  MDB_val_str(k, COLD_STORAGE_KEY);
+  MDB_val_set(v, state);
+  if (int result = mdb_put(txn, m_properties, &k, &v, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to save cold storage state: ", result).c_str()));
+}
+
+bool BlockchainLMDB::get_cold(MDB_dbi dbi, uint64_t id, const std::function<void(const MDB_val&)> &f) const
+{
+  // cold data is rarely read, so it does not get a per thread txn like the hot tables
+  MDB_txn *txn;
+  int result = mdb_txn_begin(m_cold_env, NULL, MDB_RDONLY, &txn);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to create a transaction for cold storage: ", result).c_str()));
+  epee::misc_utils::auto_scope_leave_caller txn_dtor = epee::misc_utils::create_scope_leave_handler([&](){ mdb_txn_abort(txn); });
+
+  MDB_val_set(k, id);
+  MDB_val v;
+  result = mdb_get(txn, dbi, &k, &v);
+  if (result == MDB_NOTFOUND)
+    return false;
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to read from cold storage: ", result).c_str()));
+  f(v);
+  return true;
+}
+
+bool BlockchainLMDB::move_to_cold_storage(uint64_t min_depth, uint64_t max_blocks, uint64_t &moved_bytes)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  moved_bytes = 0;
+  if (!m_cold_env)
+    return true;
+  if (m_write_txn)
+    throw0(DB_ERROR("Cannot move to cold storage while a write txn is active"));
+
+  if (need_resize())
+  {
+    LOG_PRINT_L0("LMDB memory map needs to be resized, doing that now.");
+    do_resize();
+  }
+
+  mdb_txn_safe txn;
+  int result = mdb_txn_begin(m_env, NULL, 0, txn);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+
+  uint64_t blocks_end, txs_end;
+  get_cold_storage_ends(txn, blocks_end, txs_end);
+  MDB_stat db_stats;
+  if ((result = mdb_stat(txn, m_block_info, &db_stats)))
+    throw0(DB_ERROR(lmdb_error("Failed to query m_block_info: ", result).c_str()));
+  const uint64_t blockchain_height = db_stats.ms_entries;
+  if (blockchain_height <= min_depth || blocks_end >= blockchain_height - min_depth)
+    return true;
+  const uint64_t new_blocks_end = std::min(blockchain_height - min_depth, blocks_end + max_blocks);
+
+  MDB_cursor *c_blocks, *c_txs_prunable, *c_txs_prunable_hash;
+  if ((result = mdb_cursor_open(txn, m_blocks, &c_blocks)))
+    throw0(DB_ERROR(lmdb_error("Failed to open a cursor for blocks: ", result).c_str()));
+  if ((result = mdb_cursor_open(txn, m_txs_prunable, &c_txs_prunable)))
+    throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_prunable: ", result).c_str()));
+  if ((result = mdb_cursor_open(txn, m_txs_prunable_hash, &c_txs_prunable_hash)))
+    throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_prunable_hash: ", result).c_str()));
+
+  // transactions move up to the first one of the block the blocks stop at
+  uint64_t new_txs_end;
+  if (new_blocks_end == blockchain_height)
+  {
+    if ((result = mdb_stat(txn, m_txs_pruned, &db_stats)))
+      throw0(DB_ERROR(lmdb_error("Failed to query m_txs_pruned: ", result).c_str()));
+    new_txs_end = db_stats.ms_entries;
+  }
+  else
+  {
+    MDB_val_set(k, new_blocks_end);
+    MDB_val v;
+    if ((result = mdb_cursor_get(c_blocks, &k, &v, MDB_SET)))
+      throw0(DB_ERROR(lmdb_error("Failed to retrieve block: ", result).c_str()));
+    cryptonote::blobdata bd;
+    load_blob(block_blob_compressed(new_blocks_end), v, bd);
+    cryptonote::block b;
+    if (!parse_and_validate_block_from_blob(bd, b))
+      throw0(DB_ERROR("Failed to parse block from blob retrieved from the db"));
+    crypto::hash miner_tx_hash = cryptonote::get_transaction_hash(b.miner_tx);
+    MDB_val_set(vh, miner_tx_hash);
+    MDB_cursor *c_tx_indices;
+    if ((result = mdb_cursor_open(txn, m_tx_indices, &c_tx_indices)))
+      throw0(DB_ERROR(lmdb_error("Failed to open a cursor for tx_indices: ", result).c_str()));
+    result = mdb_cursor_get(c_tx_indices, (MDB_val*)&zerokval, &vh, MDB_GET_BOTH);
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to retrieve block coinbase transaction: ", result).c_str()));
+    new_txs_end = ((const txindex*)vh.mv_data)->data.tx_id;
+    mdb_cursor_close(c_tx_indices);
+  }
+
+  // copy to the cold environment first: should we crash before the hot txn
+  // commits, the copies are only overwritten next time
+  MDB_txn *cold_txn;
+  if ((result = mdb_txn_begin(m_cold_env, NULL, 0, &cold_txn)))
+    throw0(DB_ERROR(lmdb_error("Failed to create a transaction for cold storage: ", result).c_str()));
+  epee::misc_utils::auto_scope_leave_caller cold_txn_dtor = epee::misc_utils::create_scope_leave_handler([&](){ if (cold_txn) mdb_txn_abort(cold_txn); });
+
+  const auto copy = [&](MDB_cursor *c, MDB_dbi cold_dbi, uint64_t begin, uint64_t end, bool required) {
+    for (uint64_t id = begin; id < end; ++id)
+    {
+      MDB_val_set(k, id);
+      MDB_val v;
+      result = mdb_cursor_get(c, &k, &v, MDB_SET);
+      if (result == MDB_NOTFOUND && !required)
+      {
+        // pre-RingCT txs have no prunable hash, drop any left from a popped tx with this id
+        result = mdb_del(cold_txn, cold_dbi, &k, NULL);
+        if (result && result != MDB_NOTFOUND)
+          throw0(DB_ERROR(lmdb_error("Failed to delete from cold storage: ", result).c_str()));
+        continue;
+      }
+      if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to retrieve record to move to cold storage: ", result).c_str()));
+      if ((result = mdb_put(cold_txn, cold_dbi, &k, &v, 0)))
+        throw0(DB_ERROR(lmdb_error("Failed to add record to cold storage: ", result).c_str()));
+      moved_bytes += v.mv_size;
+    }
+  };
+  copy(c_blocks, m_cold_blocks, blocks_end, new_blocks_end, true);
+  copy(c_txs_prunable, m_cold_txs_prunable, txs_end, new_txs_end, true);
+  copy(c_txs_prunable_hash, m_cold_txs_prunable_hash, txs_end, new_txs_end, false);
+
+  result = mdb_txn_commit(cold_txn);
+  cold_txn = nullptr;
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to commit to cold storage: ", result).c_str()));
+  // the hot deletions must not reach the disk before the cold copies do
+  if ((result = mdb_env_sync(m_cold_env, 1)))
+    throw0(DB_ERROR(lmdb_error("Failed to sync cold storage: ", result).c_str()));
+
+  const auto remove = [&](MDB_cursor *c, uint64_t begin, uint64_t end) {
+    for (uint64_t id = begin; id < end; ++id)
+    {
+      MDB_val_set(k, id);
+      result = mdb_cursor_get(c, &k, NULL, MDB_SET);
+      if (result == MDB_NOTFOUND)
+        continue;
+      if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to retrieve record moved to cold storage: ", result).c_str()));
+      if ((result = mdb_cursor_del(c, 0)))
+        throw0(DB_ERROR(lmdb_error("Failed to delete record moved to cold storage: ", result).c_str()));
+    }
+  };
+  remove(c_blocks, blocks_end, new_blocks_end);
+  remove(c_txs_prunable, txs_end, new_txs_end);
+  remove(c_txs_prunable_hash, txs_end, new_txs_end);
+  set_cold_storage_ends(txn, new_blocks_end, new_txs_end);
+
+  mdb_cursor_close(c_txs_prunable_hash);
+  mdb_cursor_close(c_txs_prunable);
+  mdb_cursor_close(c_blocks);
+  txn.commit();
+
+  MDEBUG("Moved blocks " << blocks_end << "-" << new_blocks_end << " and transactions " << txs_end << "-" << new_txs_end << " to cold storage, " << moved_bytes << " bytes");
+  return new_blocks_end == blockchain_height - min_depth;
+}
+
 void BlockchainLMDB::add_alt_block(const crypto::hash &blkid, const cryptonote::alt_block_data_t &data, const cryptonote::blobdata_ref &blob)
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -4563,6 +6172,48 @@ bool BlockchainLMDB::is_read_only() const
   return false;
 }
 
+void BlockchainLMDB::reserve_storage()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  if (!m_map_reserved || m_write_txn)
+    return;
+
+  MDB_envinfo mei;
+  mdb_env_info(m_env, &mei);
+  MDB_stat mst;
+  mdb_env_stat(m_env, &mst);
+  const uint64_t size_used = mst.ms_psize * mei.me_last_pgno;
+
+  // grow well before need_resize would, so writers do not find the map full mid sync
+  if (size_used < mei.me_mapsize * RESERVE_PERCENT)
+    return;
+  const uint64_t reservation = get_map_reservation(size_used);
+  if (reservation <= mei.me_mapsize)
+    return;
+  MINFO("LMDB map " << 100 * size_used / mei.me_mapsize << "% used, growing it ahead of need");
+  do_resize(reservation - mei.me_mapsize);
+}
+
+db_storage_stats BlockchainLMDB::get_storage_stats() const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  MDB_envinfo mei;
+  mdb_env_info(m_env, &mei);
+  MDB_stat mst;
+  mdb_env_stat(m_env, &mst);
+
+  db_storage_stats stats;
+  stats.reserved = mei.me_mapsize;
+  stats.used = mst.ms_psize * mei.me_last_pgno;
+  stats.resizes = map_resizes;
+  stats.stall_time_us = map_stall_time_us;
+  stats.max_stall_time_us = map_max_stall_time_us;
+  return stats;
+}
+
 uint64_t BlockchainLMDB::get_database_size() const
 {
   boost::filesystem::path datafile(m_folder);
@@ -28,7 +28,11 @@
 
 #include <atomic>
 
+#include "blockchain_db/blob_compression.h"
 #include "blockchain_db/blockchain_db.h"
+#include "blockchain_db/key_image_filter.h"
+#include "blockchain_db/rct_distribution.h"
+#include "blockchain_db/rct_output_column.h"
 #include "cryptonote_basic/blobdatatype.h" // for type blobdata
 #include "ringct/rctTypes.h"
 #include <boost/thread/tss.hpp>
@@ -180,6 +184,53 @@ struct mdb_txn_safe
 // A regular network sync without batch writes is expected to open a new read
 // transaction, as those lookups are part of the validation done prior to the
 // write for block and tx data, so no write transaction is open at the time.
+
+/**
+ * @brief which snapshots may read an in-memory copy kept behind some tables
+ *
+ * The RingCT output column and distribution are changed by the write txn as
+ * it goes, published once it commits, and resynced from a read txn when it
+ * aborts or when they fell behind. A reader whose snapshot is older than what
+ * was published must not see entries its snapshot lacks, nor entries which a
+ * later truncation replaced, so the txn ids involved are kept here.
+ */
+struct mdb_cache_state
+{
+  bool behind; // the tables have entries the copy was not given
+  uint64_t pending_txnid; // write txn which changed the copy, not yet published
+  uint64_t pending_truncated; // lowest index that txn truncated from
+  std::atomic<uint64_t> txnid; // snapshot the published entries come from
+  std::atomic<uint64_t> rewrite_txnid; // last committed txn which truncated the copy
+  std::atomic<uint64_t> rewritten_from; // lowest index ever truncated by such txns
+
+  mdb_cache_state() { reset(); }
+  void reset();
+
+  // the write txn changed the copy, or truncated it from index on
+  void changed(MDB_txn *txn) { pending_txnid = mdb_txn_id(txn); }
+  void truncated(MDB_txn *txn, uint64_t index);
+  // before the write txn's entries are published
+  void committed();
+  // the copy must be resynced
+  void aborted();
+  // before entries copied from this read txn are published
+  void synced(MDB_txn *txn);
+
+  // how many of the size published entries a reader on txn may use; snapshot_size gives
+  // the number of entries its own snapshot has, and is only called for older snapshots
+  template<typename F>
+  uint64_t readable(MDB_txn *txn, uint64_t size, F snapshot_size) const
+  {
+    const uint64_t id = mdb_txn_id(txn);
+    if (id >= txnid.load(std::memory_order_acquire))
+      return size;
+    size = std::min<uint64_t>(size, snapshot_size());
+    if (id < rewrite_txnid.load(std::memory_order_acquire))
+      size = std::min<uint64_t>(size, rewritten_from.load(std::memory_order_acquire));
+    return size;
+  }
+};
+
 class BlockchainLMDB final: public BlockchainDB
 {
 public:
@@ -214,6 +265,8 @@ public:
 
   std::vector<uint64_t> get_block_cumulative_rct_outputs(const std::vector<uint64_t> &heights) const override;
 
+  std::vector<uint64_t> get_block_cumulative_rct_outputs_range(uint64_t start_height, size_t count) const override;
+
   uint64_t get_block_timestamp(const uint64_t& height) const override;
 
   uint64_t get_top_block_timestamp() const override;
@@ -296,6 +349,25 @@ public:
   bool prune_blockchain(uint32_t pruning_seed = 0) override;
   bool update_pruning() override;
   bool check_pruning() override;
+  bool prune_blockchain_step(uint32_t pruning_seed, uint64_t max_bytes, uint64_t max_txes, uint64_t &pruned_bytes) override;
+  bool get_pruning_progress(uint64_t &done, uint64_t &total) const override;
+
+  /**
+   * @brief compresses the block and transaction blobs, resuming any earlier interrupted run
+   *
+   * Nothing else may use the database while this runs. The compression level
+   * and dictionary are only chosen on the first run.
+   *
+   * @param level the zstd compression level
+   * @param dictionary_size the maximum size of the dictionary to train, 0 for none
+   */
+  void compress_blobs(int level, size_t dictionary_size);
+
+  //! whether every block and transaction blob is compressed
+  bool blobs_compressed() const;
+
+  //! bytes used by the block and transaction blob tables, without free pages
+  uint64_t get_blob_tables_size() const;
 
   void add_alt_block(const crypto::hash &blkid, const cryptonote::alt_block_data_t &data, const cryptonote::blobdata_ref &blob) override;
   bool get_alt_block(const crypto::hash &blkid, alt_block_data_t *data, cryptonote::blobdata *blob) override;
@@ -321,6 +393,8 @@ public:
                             ) override;
 
   void set_batch_transactions(bool batch_transactions) override;
+  void set_cold_storage(const std::string& folder) override;
+  bool move_to_cold_storage(uint64_t min_depth, uint64_t max_blocks, uint64_t &moved_bytes) override;
   bool batch_start(uint64_t batch_num_blocks=0, uint64_t batch_bytes=0) override;
   void batch_commit();
   void batch_stop() override;
@@ -334,6 +408,8 @@ public:
   void block_rtxn_abort() const override;
 
   bool block_rtxn_start(MDB_txn **mtxn, mdb_txn_cursors **mcur) const;
+  // whether this thread already has its read txn started
+  bool block_rtxn_pinned() const;
 
   void pop_block(block& blk, std::vector<transaction>& txs) override;
 
@@ -362,6 +438,7 @@ private:
   void do_resize(uint64_t size_increase=0);
 
   bool need_resize(uint64_t threshold_size=0) const;
+  uint64_t get_map_reservation(uint64_t size_used) const;
   void check_and_resize_for_batch(uint64_t batch_num_blocks, uint64_t batch_bytes);
   uint64_t get_estimated_batch_size(uint64_t batch_num_blocks, uint64_t batch_bytes) const;
 
@@ -397,6 +474,8 @@ private:
 
   void prune_outputs(uint64_t amount) override;
 
+  void get_output_keys_sorted(const std::vector<std::pair<uint64_t, uint64_t>> &amount_indices, std::vector<output_data_t> &outputs, std::vector<bool> &found) const override;
+
   void add_spent_key(const crypto::key_image& k_image) override;
 
   void remove_spent_key(const crypto::key_image& k_image) override;
@@ -409,6 +488,9 @@ private:
   void check_hard_fork_info() override;
   void drop_hard_fork_info() override;
 
+  void set_derived_state(const std::string &name, const crypto::hash &top_hash, const std::string &state) override;
+  bool get_derived_state(const std::string &name, crypto::hash &top_hash, std::string &state) const override;
+
   inline void check_open() const;
 
   bool prune_worker(int mode, uint32_t pruning_seed);
@@ -417,6 +499,10 @@ private:
 
   uint64_t get_database_size() const override;
 
+  void reserve_storage() override;
+
+  db_storage_stats get_storage_stats() const override;
+
   std::vector<uint64_t> get_block_info_64bit_fields(uint64_t start_height, size_t count, off_t offset) const;
 
   // fix up anything that may be wrong due to past bugs
@@ -442,6 +528,38 @@ private:
 
   void cleanup_batch();
 
+  // the spent key image filter is loaded from its snapshot, or rebuilt if that is stale
+  void load_key_image_filter();
+  void build_key_image_filter();
+  void add_key_images_to_filter(uint32_t begin, uint32_t end);
+  void save_key_image_filter();
+
+  // the RingCT output column is trusted only after a clean close, and otherwise rebuilt
+  void open_rct_column();
+  void close_rct_column();
+  void sync_rct_column();
+  void end_rct_column_txn(bool committed);
+  uint64_t rct_column_readable(MDB_txn *txn, uint64_t size) const;
+
+  // the RingCT distribution is rebuilt from m_block_info on open, then follows the blocks
+  void sync_rct_distribution();
+  void end_rct_distribution_txn(bool committed);
+  uint64_t rct_distribution_readable(MDB_txn *txn, uint64_t size) const;
+
+  // blobs are stored compressed below the ends recorded in m_properties, so a
+  // conversion can be interrupted and resumed
+  void load_blob_compression(MDB_txn *txn);
+  bool block_blob_compressed(uint64_t height) const { return height < m_compressed_blocks_end; }
+  bool tx_blob_compressed(uint64_t tx_id) const { return tx_id < m_compressed_txs_end; }
+  const blob_compressor *tx_blob_compressor(uint64_t tx_id) const { return tx_blob_compressed(tx_id) ? &m_blob_compressor : nullptr; }
+  void load_blob(bool compressed, const MDB_val &v, cryptonote::blobdata &bd, bool append = false) const;
+  MDB_val stored_blob(bool compressed, const cryptonote::blobdata_ref &blob, std::string &buffer) const;
+
+  void open_cold_storage(MDB_txn *txn, int mdb_flags);
+  void get_cold_storage_ends(MDB_txn *txn, uint64_t &blocks_end, uint64_t &txs_end) const;
+  void set_cold_storage_ends(MDB_txn *txn, uint64_t blocks_end, uint64_t txs_end);
+  bool get_cold(MDB_dbi dbi, uint64_t id, const std::function<void(const MDB_val&)> &f) const;
+
 private:
   MDB_env* m_env;
 
@@ -472,6 +590,9 @@ private:
 
   MDB_dbi m_properties;
 
+  MDB_dbi m_derived_state;
+  bool m_has_derived_state; // not created when the db is opened read-only
+
   mutable uint64_t m_cum_size;	// used in batch size estimation
   mutable unsigned int m_cum_count;
   std::string m_folder;
@@ -482,6 +603,33 @@ private:
   bool m_batch_transactions; // support for batch transactions
   bool m_batch_active; // whether batch transaction is in progress
 
+  // answers "not spent" for most key images without a lookup in m_spent_keys
+  key_image_filter m_key_image_filter;
+  std::atomic<bool> m_key_image_filter_ready;
+
+  // RingCT outputs by amount index, for reads without a dupsort seek
+  rct_output_column m_rct_column;
+  uint64_t m_rct_column_pending; // records written by the current write txn end here
+  mdb_cache_state m_rct_column_state;
+
+  // bi_cum_rct by height, for output distribution ranges without a lookup per height
+  rct_distribution m_rct_distribution;
+  bool m_rct_distribution_ready;
+  mdb_cache_state m_rct_distribution_state;
+
+  blob_compressor m_blob_compressor;
+  uint64_t m_compressed_blocks_end; // blocks below this height are stored compressed
+  uint64_t m_compressed_txs_end; // transactions below this id are stored compressed
+
+  bool m_map_reserved; // the map was sized from disk capacity, and grows geometrically
+
+  // block blobs and prunable tx data deep in the chain, kept apart from the hot tables
+  std::string m_cold_folder;
+  MDB_env* m_cold_env;
+  MDB_dbi m_cold_blocks;
+  MDB_dbi m_cold_txs_prunable;
+  MDB_dbi m_cold_txs_prunable_hash;
+
   mdb_txn_cursors m_wcursors;
   mutable boost::thread_specific_ptr<mdb_threadinfo> m_tinfo;
 
@@ -497,6 +645,7 @@ private:
 #endif
 
   constexpr static float RESIZE_PERCENT = 0.9f;
+  constexpr static float RESERVE_PERCENT = 0.6f;
 };
 
 }  // namespace cryptonote
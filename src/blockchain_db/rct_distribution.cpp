@@ -0,0 +1,59 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <algorithm>
+#include <boost/thread/locks.hpp>
+
+#include "rct_distribution.h"
+
+namespace cryptonote
+{
+
+void rct_distribution::push_back(uint64_t cumulative_rct_outputs)
+{
+  // readers only look at published entries, but a reallocation moves them all
+  boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+  m_entries.push_back(cumulative_rct_outputs);
+}
+
+void rct_distribution::publish(uint64_t size)
+{
+  m_size.store(std::min<uint64_t>(size, m_entries.size()), std::memory_order_release);
+}
+
+void rct_distribution::truncate(uint64_t height)
+{
+  boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+  if (height < size())
+    m_size.store(height, std::memory_order_release);
+  if (height < m_entries.size())
+    m_entries.resize(height);
+}
+
+}  // namespace cryptonote
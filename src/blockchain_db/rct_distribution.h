@@ -0,0 +1,86 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
+namespace cryptonote
+{
+
+/**
+ * @brief bi_cum_rct of every block, by height, in one vector
+ *
+ * Entry h is the number of RingCT outputs up to and including block h, so
+ * the RingCT output distribution over a range of heights is a copy of a
+ * slice instead of a block_info lookup per height. Nothing is stored on
+ * disk: the vector is refilled from block_info when the database is opened.
+ *
+ * Entries past size() belong to the block writer's uncommitted txn. Growing
+ * the vector may move it, so push_back and truncate take the lock readers
+ * hold in with_entries.
+ */
+class rct_distribution
+{
+public:
+  rct_distribution(): m_size(0) {}
+
+  //! number of entries readers may use
+  uint64_t size() const { return m_size.load(std::memory_order_acquire); }
+  //! number of entries the writer has given, published or not
+  uint64_t pending_size() const { return m_entries.size(); }
+
+  //! adds the entry for the next height, past size()
+  void push_back(uint64_t cumulative_rct_outputs);
+  //! makes the first size entries visible to readers
+  void publish(uint64_t size);
+  //! drops every entry from height on, waiting for readers still using them
+  void truncate(uint64_t height);
+
+  /**
+   * @brief calls f(entries, size) with the published entries, which stay valid until f returns
+   */
+  template<typename F>
+  auto with_entries(F f) const -> decltype(f((const uint64_t*)nullptr, (uint64_t)0))
+  {
+    boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+    return f(m_entries.data(), size());
+  }
+
+private:
+  std::vector<uint64_t> m_entries;
+  std::atomic<uint64_t> m_size;
+  mutable boost::shared_mutex m_mutex; // exclusive to change m_entries under readers
+};
+
+}  // namespace cryptonote
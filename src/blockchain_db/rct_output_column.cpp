@@ -0,0 +1,183 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstring>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "misc_log_ex.h"
+#include "rct_output_column.h"
+
+#undef MEVACOIN_DEFAULT_LOG_CATEGORY
+#define MEVACOIN_DEFAULT_LOG_CATEGORY "blockchain.db"
+
+// The file grows in steps of this many records (80 MB), so remapping is rare
+#define RCT_OUTPUT_COLUMN_GROW_RECORDS (1 << 20)
+
+namespace cryptonote
+{
+
+rct_output_column::rct_output_column(): m_fd(-1), m_records(nullptr), m_capacity(0), m_size(0)
+{
+}
+
+rct_output_column::~rct_output_column()
+{
+  close();
+}
+
+bool rct_output_column::open(const std::string &filename)
+{
+  close();
+#ifdef _WIN32
+  MINFO("RingCT output column is not supported on this platform");
+  return false;
+#else
+  m_fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+  if (m_fd < 0)
+  {
+    MERROR("Failed to open " << filename << ": " << strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(m_fd, &st) < 0)
+  {
+    MERROR("Failed to stat " << filename << ": " << strerror(errno));
+    close();
+    return false;
+  }
+  try
+  {
+    if (st.st_size > 0)
+      map(st.st_size / sizeof(output_data_t));
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Failed to map " << filename << ": " << e.what());
+    close();
+    return false;
+  }
+  return true;
+#endif
+}
+
+void rct_output_column::close()
+{
+  if (m_fd < 0)
+    return;
+  boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+  m_size.store(0, std::memory_order_release);
+  unmap();
+#ifndef _WIN32
+  ::close(m_fd);
+#endif
+  m_fd = -1;
+}
+
+void rct_output_column::map(uint64_t capacity)
+{
+#ifndef _WIN32
+  unmap();
+  if (capacity == 0)
+    return;
+  void *p = mmap(nullptr, capacity * sizeof(output_data_t), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if (p == MAP_FAILED)
+    throw DB_ERROR((std::string("Failed to map RingCT output column: ") + strerror(errno)).c_str());
+  m_records = static_cast<output_data_t*>(p);
+  m_capacity = capacity;
+#endif
+}
+
+void rct_output_column::unmap()
+{
+#ifndef _WIN32
+  if (m_records)
+    munmap(m_records, m_capacity * sizeof(output_data_t));
+#endif
+  m_records = nullptr;
+  m_capacity = 0;
+}
+
+void rct_output_column::write(uint64_t index, const output_data_t &data)
+{
+  if (m_fd < 0)
+    return;
+  CHECK_AND_ASSERT_THROW_MES(index >= size(), "Overwriting a published RingCT output column record");
+#ifndef _WIN32
+  if (index >= m_capacity)
+  {
+    const uint64_t capacity = (index / RCT_OUTPUT_COLUMN_GROW_RECORDS + 1) * RCT_OUTPUT_COLUMN_GROW_RECORDS;
+    boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+    if (ftruncate(m_fd, capacity * sizeof(output_data_t)) < 0)
+      throw DB_ERROR((std::string("Failed to grow RingCT output column: ") + strerror(errno)).c_str());
+    map(capacity);
+  }
+#endif
+  memcpy(&m_records[index], &data, sizeof(data));
+}
+
+void rct_output_column::publish(uint64_t size)
+{
+  CHECK_AND_ASSERT_THROW_MES(size <= m_capacity, "Publishing RingCT output column records past its end");
+  m_size.store(size, std::memory_order_release);
+}
+
+void rct_output_column::truncate(uint64_t index)
+{
+  if (index >= size())
+    return;
+  boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+  m_size.store(index, std::memory_order_release);
+}
+
+bool rct_output_column::flush()
+{
+#ifndef _WIN32
+  if (m_records && msync(m_records, m_capacity * sizeof(output_data_t), MS_SYNC) < 0)
+  {
+    MERROR("Failed to flush RingCT output column: " << strerror(errno));
+    return false;
+  }
+#endif
+  return true;
+}
+
+bool rct_output_column::get(uint64_t index, output_data_t &data) const
+{
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+  if (index >= size())
+    return false;
+  memcpy(&data, &m_records[index], sizeof(data));
+  return true;
+}
+
+}  // namespace cryptonote
@@ -0,0 +1,99 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <boost/thread/shared_mutex.hpp>
+
+#include "blockchain_db/blockchain_db.h"
+
+namespace cryptonote
+{
+
+/**
+ * @brief a memory mapped, fixed stride copy of the RingCT outputs
+ *
+ * Record n is the output_data_t of the RingCT output with amount index n, so
+ * reading a ring member is pointer arithmetic instead of a dupsort seek in
+ * output_amounts. The database stays authoritative: the file is written
+ * behind it and only its first size() records, as published by the writer
+ * once they are committed, may be read.
+ *
+ * A single writer calls write, publish and truncate; any number of readers
+ * may call get and with_records concurrently with it.
+ */
+class rct_output_column
+{
+public:
+  rct_output_column();
+  ~rct_output_column();
+
+  //! maps the file, creating it if needed; returns false if the column can't be used
+  bool open(const std::string &filename);
+  void close();
+  bool is_open() const { return m_fd >= 0; }
+
+  //! number of records readers may use
+  uint64_t size() const { return m_size.load(std::memory_order_acquire); }
+  //! number of records the file holds, valid or not
+  uint64_t capacity() const { return m_capacity; }
+
+  //! writes a record past size(), growing the file as needed
+  void write(uint64_t index, const output_data_t &data);
+  //! makes the first size records visible to readers
+  void publish(uint64_t size);
+  //! hides every record from index on, waiting for readers still using them
+  void truncate(uint64_t index);
+  bool flush();
+
+  bool get(uint64_t index, output_data_t &data) const;
+
+  /**
+   * @brief calls f(records, size) with the published records, which stay valid until f returns
+   */
+  template<typename F>
+  auto with_records(F f) const -> decltype(f((const output_data_t*)nullptr, (uint64_t)0))
+  {
+    boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+    return f(m_records, size());
+  }
+
+private:
+  void map(uint64_t capacity);
+  void unmap();
+
+  int m_fd;
+  output_data_t *m_records;
+  uint64_t m_capacity;
+  std::atomic<uint64_t> m_size;
+  mutable boost::shared_mutex m_mutex; // exclusive to remap or to truncate under readers
+};
+
+}  // namespace cryptonote
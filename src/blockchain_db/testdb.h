@@ -56,6 +56,8 @@ public:
   virtual void batch_stop() override {}
   virtual void batch_abort() override {}
   virtual void set_batch_transactions(bool) override {}
+  virtual void set_cold_storage(const std::string& folder) override {}
+  virtual bool move_to_cold_storage(uint64_t min_depth, uint64_t max_blocks, uint64_t &moved_bytes) override { moved_bytes = 0; return true; }
   virtual void block_wtxn_start() override {}
   virtual void block_wtxn_stop() override {}
   virtual void block_wtxn_abort() override {}
@@ -136,6 +138,8 @@ public:
   virtual bool get_txpool_tx_meta(const crypto::hash& txid, cryptonote::txpool_tx_meta_t &meta) const override { return false; }
   virtual bool get_txpool_tx_blob(const crypto::hash& txid, cryptonote::blobdata &bd, relay_category tx_category) const override { return false; }
   virtual uint64_t get_database_size() const override { return 0; }
+  virtual void reserve_storage() override {}
+  virtual cryptonote::db_storage_stats get_storage_stats() const override { return {}; }
   virtual cryptonote::blobdata get_txpool_tx_blob(const crypto::hash& txid, relay_category tx_category) const override { return ""; }
   virtual bool for_all_txpool_txes(std::function<bool(const crypto::hash&, const cryptonote::txpool_tx_meta_t&, const cryptonote::blobdata_ref*)>, bool include_blob = false, relay_category category = relay_category::broadcasted) const override { return false; }
 
@@ -151,9 +155,13 @@ public:
   virtual void set_hard_fork_version(uint64_t height, uint8_t version) override {}
   virtual uint8_t get_hard_fork_version(uint64_t height) const override { return 0; }
   virtual void check_hard_fork_info() override {}
+  virtual void set_derived_state(const std::string &name, const crypto::hash &top_hash, const std::string &state) override {}
+  virtual bool get_derived_state(const std::string &name, crypto::hash &top_hash, std::string &state) const override { return false; }
 
   virtual uint32_t get_blockchain_pruning_seed() const override { return 0; }
   virtual bool prune_blockchain(uint32_t pruning_seed = 0) override { return true; }
+  virtual bool prune_blockchain_step(uint32_t pruning_seed, uint64_t max_bytes, uint64_t max_txes, uint64_t &pruned_bytes) override { pruned_bytes = 0; return true; }
+  virtual bool get_pruning_progress(uint64_t &done, uint64_t &total) const override { return false; }
   virtual bool update_pruning() override { return true; }
   virtual bool check_pruning() override { return true; }
   virtual void prune_outputs(uint64_t amount) override {}
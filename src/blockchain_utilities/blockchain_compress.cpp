@@ -0,0 +1,211 @@
+// Copyright (c) 2014-2024, The Mevacoin Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <chrono>
+#include <random>
+#include <boost/filesystem/path.hpp>
+#include "common/command_line.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "blockchain_db/lmdb/db_lmdb.h"
+#include "version.h"
+
+#undef MEVACOIN_DEFAULT_LOG_CATEGORY
+#define MEVACOIN_DEFAULT_LOG_CATEGORY "bcutil"
+
+namespace po = boost::program_options;
+using namespace epee;
+using namespace cryptonote;
+
+// Times reads of random blocks and their transactions, the same ones on every run
+static void benchmark(const BlockchainLMDB &db, size_t samples)
+{
+  typedef std::chrono::steady_clock clock;
+  const uint64_t blockchain_height = db.height();
+  if (blockchain_height == 0)
+    return;
+
+  std::mt19937_64 rng(0);
+  std::uniform_int_distribution<uint64_t> dist(0, blockchain_height - 1);
+  std::vector<crypto::hash> txids;
+  clock::duration block_time{0}, pruned_time{0}, prunable_time{0};
+  uint64_t block_bytes = 0, pruned_bytes = 0, prunable_bytes = 0;
+  for (size_t i = 0; i < samples; ++i)
+  {
+    const auto start = clock::now();
+    const cryptonote::blobdata bd = db.get_block_blob_from_height(dist(rng));
+    block_time += clock::now() - start;
+    block_bytes += bd.size();
+    cryptonote::block b;
+    if (!cryptonote::parse_and_validate_block_from_blob(bd, b))
+      throw std::runtime_error("Bad block from db");
+    txids.push_back(cryptonote::get_transaction_hash(b.miner_tx));
+    txids.insert(txids.end(), b.tx_hashes.begin(), b.tx_hashes.end());
+  }
+  size_t prunable_txes = 0;
+  for (const crypto::hash &txid: txids)
+  {
+    cryptonote::blobdata bd;
+    auto start = clock::now();
+    if (!db.get_pruned_tx_blob(txid, bd))
+      throw std::runtime_error("Tx not found in db");
+    pruned_time += clock::now() - start;
+    pruned_bytes += bd.size();
+    start = clock::now();
+    if (db.get_prunable_tx_blob(txid, bd))
+    {
+      prunable_time += clock::now() - start;
+      prunable_bytes += bd.size();
+      ++prunable_txes;
+    }
+  }
+
+  const auto per_read = [](clock::duration d, size_t n) {
+    return n ? std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() / 1000.0 / n : 0.0;
+  };
+  MINFO("  blob tables: " << db.get_blob_tables_size() / 1048576 << " MB in use");
+  MINFO("  " << samples << " blocks (" << block_bytes / samples << " bytes avg): " << per_read(block_time, samples) << " us/read");
+  MINFO("  " << txids.size() << " pruned txes (" << pruned_bytes / std::max<size_t>(txids.size(), 1) << " bytes avg): " << per_read(pruned_time, txids.size()) << " us/read");
+  MINFO("  " << prunable_txes << " prunable txes (" << prunable_bytes / std::max<size_t>(prunable_txes, 1) << " bytes avg): " << per_read(prunable_time, prunable_txes) << " us/read");
+}
+
+int main(int argc, char* argv[])
+{
+  TRY_ENTRY();
+
+  epee::string_tools::set_module_name_and_folder(argv[0]);
+
+  uint32_t log_level = 0;
+
+  tools::on_startup();
+
+  po::options_description desc_cmd_only("Command line options");
+  po::options_description desc_cmd_sett("Command line options and settings options");
+  const command_line::arg_descriptor<std::string> arg_log_level  = {"log-level",  "0-4 or categories", ""};
+  const command_line::arg_descriptor<int> arg_compression_level  = {"compression-level", "zstd compression level, only used on the first run", 3};
+  const command_line::arg_descriptor<size_t> arg_dictionary_size  = {"dictionary-size", "Size of the trained compression dictionary, 0 for none, only used on the first run", 112640};
+  const command_line::arg_descriptor<bool> arg_benchmark  = {"benchmark", "Time blob reads before and after compressing", false};
+  const command_line::arg_descriptor<size_t> arg_benchmark_blocks  = {"benchmark-blocks", "Number of random blocks to read in the benchmark", 10000};
+
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_testnet_on);
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_stagenet_on);
+  command_line::add_arg(desc_cmd_sett, arg_log_level);
+  command_line::add_arg(desc_cmd_sett, arg_compression_level);
+  command_line::add_arg(desc_cmd_sett, arg_dictionary_size);
+  command_line::add_arg(desc_cmd_sett, arg_benchmark);
+  command_line::add_arg(desc_cmd_sett, arg_benchmark_blocks);
+  command_line::add_arg(desc_cmd_only, command_line::arg_help);
+
+  po::options_description desc_options("Allowed options");
+  desc_options.add(desc_cmd_only).add(desc_cmd_sett);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_options, [&]()
+  {
+    auto parser = po::command_line_parser(argc, argv).options(desc_options);
+    po::store(parser.run(), vm);
+    po::notify(vm);
+    return true;
+  });
+  if (! r)
+    return 1;
+
+  if (command_line::get_arg(vm, command_line::arg_help))
+  {
+    std::cout << "MevaCoin '" << MEVACOIN_RELEASE_NAME << "' (v" << MEVACOIN_VERSION_FULL << ")" << ENDL << ENDL;
+    std::cout << desc_options << std::endl;
+    return 1;
+  }
+
+  mlog_configure(mlog_get_default_log_path("mevacoin-blockchain-compress.log"), true);
+  if (!command_line::is_arg_defaulted(vm, arg_log_level))
+    mlog_set_log(command_line::get_arg(vm, arg_log_level).c_str());
+  else
+    mlog_set_log(std::string(std::to_string(log_level) + ",bcutil:INFO").c_str());
+
+  if (!blob_compressor::available())
+  {
+    LOG_ERROR("This build has no zstd support");
+    return 1;
+  }
+
+  LOG_PRINT_L0("Starting...");
+
+  std::string opt_data_dir = command_line::get_arg(vm, cryptonote::arg_data_dir);
+  const int opt_compression_level = command_line::get_arg(vm, arg_compression_level);
+  const size_t opt_dictionary_size = command_line::get_arg(vm, arg_dictionary_size);
+  const bool opt_benchmark = command_line::get_arg(vm, arg_benchmark);
+  const size_t opt_benchmark_blocks = command_line::get_arg(vm, arg_benchmark_blocks);
+
+  // The database is rewritten in place, so nothing else, including the daemon, may have it open
+  std::unique_ptr<BlockchainLMDB> db(new BlockchainLMDB());
+  const std::string filename = (boost::filesystem::path(opt_data_dir) / db->get_db_name()).string();
+  LOG_PRINT_L0("Loading blockchain from folder " << filename << " ...");
+
+  try
+  {
+    db->open(filename, 0);
+  }
+  catch (const std::exception& e)
+  {
+    LOG_PRINT_L0("Error opening database: " << e.what());
+    return 1;
+  }
+
+  try
+  {
+    if (opt_benchmark)
+    {
+      MINFO("Before compression:");
+      benchmark(*db, opt_benchmark_blocks);
+    }
+    if (db->blobs_compressed())
+      MINFO("Blobs are already compressed");
+    else
+      db->compress_blobs(opt_compression_level, opt_dictionary_size);
+    if (opt_benchmark)
+    {
+      MINFO("After compression:");
+      benchmark(*db, opt_benchmark_blocks);
+    }
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("Error compressing blobs: " << e.what());
+    db->close();
+    return 1;
+  }
+
+  db->close();
+  // LMDB reuses the freed pages for new data, but does not give them back to the filesystem
+  MINFO("Done, data.mdb keeps its size until the freed pages are reused");
+  return 0;
+
+  CATCH_ENTRY("Compression error", 1);
+}
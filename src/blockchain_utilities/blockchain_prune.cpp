@@ -200,6 +200,28 @@ static uint32_t get_blockchain_db_version(MDB_env *env)
   return db_version;
 }
 
+static bool has_property(MDB_env *env, const std::string &key)
+{
+  MDB_dbi properties_dbi;
+  MDB_txn *txn;
+  int rc;
+
+  rc = mdb_txn_begin(env, NULL, MDB_RDONLY, &txn);
+  if (rc) throw std::runtime_error("Failed to create LMDB transaction: " + std::string(mdb_strerror(rc)));
+  const epee::misc_utils::auto_scope_leave_caller txn_dtor = epee::misc_utils::create_scope_leave_handler([&](){
+    mdb_txn_abort(txn);
+  });
+  rc = mdb_dbi_open(txn, "properties", /*flags=*/0, &properties_dbi);
+  if (rc) throw std::runtime_error("Failed to open LMDB properties dbi: " + std::string(mdb_strerror(rc)));
+
+  MDB_val k = {key.size() + 1, (void*)key.c_str()}; // the null terminator is part of the key
+  MDB_val v;
+  rc = mdb_get(txn, properties_dbi, &k, &v);
+  if (rc && rc != MDB_NOTFOUND)
+    throw std::runtime_error("Failed to get " + key + " from properties table: " + std::string(mdb_strerror(rc)));
+  return rc == 0;
+}
+
 static void copy_table(MDB_env *env0, MDB_env *env1, const char *table, unsigned int flags, unsigned int putflags, int (*cmp)(const MDB_val*, const MDB_val*)=0, void (*f)(const MDB_val&, const MDB_val&) = 0)
 {
   MDB_dbi dbi0, dbi1;
@@ -687,6 +709,20 @@ int main(int argc, char* argv[])
     close(env0);
     return 1;
   }
+  // pruned tx blobs must be read to find v1 txes, which this tool can't do if they are compressed
+  if (has_property(env0, "blob_compression"))
+  {
+    MERROR("Source database has compressed blobs, prune it with mevacoind --prune-blockchain instead");
+    close(env0);
+    return 1;
+  }
+  // the prunable data this tool would copy is partly in another environment
+  if (has_property(env0, "cold_storage"))
+  {
+    MERROR("Source database keeps data in cold storage, and cannot be pruned");
+    close(env0);
+    return 1;
+  }
 
   MINFO("Opening target database...");
   open(env1, paths[1], db_flags, false);
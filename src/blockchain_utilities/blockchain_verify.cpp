@@ -0,0 +1,444 @@
+// Copyright (c) 2014-2024, The Mevacoin Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <atomic>
+#include <chrono>
+#include <boost/filesystem/path.hpp>
+#include "common/command_line.h"
+#include "common/pruning.h"
+#include "common/threadpool.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "blockchain_db/lmdb/db_lmdb.h"
+#include "version.h"
+
+#undef MEVACOIN_DEFAULT_LOG_CATEGORY
+#define MEVACOIN_DEFAULT_LOG_CATEGORY "bcutil"
+
+#define MAX_ERRORS_PER_RANGE 20
+
+namespace po = boost::program_options;
+using namespace epee;
+using namespace cryptonote;
+
+struct range_result
+{
+  uint64_t blocks = 0;
+  uint64_t txes = 0;
+  uint64_t outputs = 0;
+  uint64_t key_images = 0;
+  uint64_t bytes = 0;
+  uint64_t first_tx_id = 0;
+  uint64_t last_tx_id = 0;
+  uint64_t prunable_pending = 0;
+  std::map<uint64_t, uint64_t> pre_rct_outputs;
+  uint64_t n_errors = 0;
+  std::vector<std::string> errors;
+
+  void error(uint64_t height, const std::string &msg)
+  {
+    if (n_errors++ < MAX_ERRORS_PER_RANGE)
+      errors.push_back("height " + std::to_string(height) + ": " + msg);
+  }
+};
+
+// Checks a tx against the txs, tx_indices, txs_prunable and output tables
+static void verify_tx(const BlockchainDB &db, uint64_t height, uint64_t blockchain_height, uint32_t pruning_seed,
+    const crypto::hash &txid, bool miner_tx, uint64_t &rct_outputs, range_result &res)
+{
+  uint64_t tx_id;
+  if (!db.tx_exists(txid, tx_id))
+  {
+    res.error(height, "tx " + string_tools::pod_to_hex(txid) + " not in tx_indices");
+    return;
+  }
+  if (res.txes > 0 && tx_id != res.last_tx_id + 1)
+    res.error(height, "tx " + string_tools::pod_to_hex(txid) + " has tx_id " + std::to_string(tx_id) + ", expected " + std::to_string(res.last_tx_id + 1));
+  if (res.txes == 0)
+    res.first_tx_id = tx_id;
+  res.last_tx_id = tx_id;
+  ++res.txes;
+
+  if (db.get_tx_block_height(txid) != height)
+    res.error(height, "tx " + string_tools::pod_to_hex(txid) + " has block height " + std::to_string(db.get_tx_block_height(txid)));
+
+  cryptonote::blobdata pruned, prunable;
+  if (!db.get_pruned_tx_blob(txid, pruned))
+  {
+    res.error(height, "tx " + string_tools::pod_to_hex(txid) + " not in txs");
+    return;
+  }
+  res.bytes += pruned.size();
+  cryptonote::transaction tx;
+  if (!cryptonote::parse_and_validate_tx_base_from_blob(pruned, tx))
+  {
+    res.error(height, "tx " + string_tools::pod_to_hex(txid) + " does not parse");
+    return;
+  }
+  if (miner_tx != (tx.vin.size() == 1 && tx.vin[0].type() == typeid(txin_gen)))
+    res.error(height, "tx " + string_tools::pod_to_hex(txid) + (miner_tx ? " is not" : " is") + " a miner tx");
+
+  // v1 txes are never pruned, the others keep their prunable data in the tip and in their stripe
+  const bool want_prunable = pruning_seed == 0 || tx.version == 1 || tools::has_unpruned_block(height, blockchain_height, pruning_seed);
+  if (db.get_prunable_tx_blob(txid, prunable))
+  {
+    res.bytes += prunable.size();
+    if (!want_prunable)
+      ++res.prunable_pending;
+    cryptonote::transaction full_tx;
+    crypto::hash hash;
+    if (!cryptonote::parse_and_validate_tx_from_blob(pruned + prunable, full_tx, hash) || hash != txid)
+      res.error(height, "tx " + string_tools::pod_to_hex(txid) + " does not hash to its txid");
+    crypto::hash prunable_hash;
+    if (tx.version > 1 && (!db.get_prunable_tx_hash(txid, prunable_hash) || prunable_hash != cryptonote::get_blob_hash(prunable)))
+      res.error(height, "tx " + string_tools::pod_to_hex(txid) + " has a bad prunable hash");
+  }
+  else if (want_prunable)
+  {
+    res.error(height, "tx " + string_tools::pod_to_hex(txid) + " is missing its prunable data");
+  }
+  else
+  {
+    crypto::hash prunable_hash;
+    if (!db.get_prunable_tx_hash(txid, prunable_hash) || cryptonote::get_pruned_transaction_hash(tx, prunable_hash) != txid)
+      res.error(height, "pruned tx " + string_tools::pod_to_hex(txid) + " does not hash to its txid");
+  }
+
+  // tx_outputs -> output_amounts -> output_txs must lead back to the same output
+  const std::vector<uint64_t> indices = db.get_tx_amount_output_indices(tx_id).front();
+  if (indices.size() != tx.vout.size())
+  {
+    res.error(height, "tx " + string_tools::pod_to_hex(txid) + " has " + std::to_string(indices.size()) + " output indices for " + std::to_string(tx.vout.size()) + " outputs");
+    return;
+  }
+  for (size_t i = 0; i < tx.vout.size(); ++i)
+  {
+    const uint64_t amount = tx.version > 1 ? 0 : tx.vout[i].amount;
+    crypto::public_key pkey;
+    const output_data_t od = db.get_output_key(amount, indices[i], false);
+    if (!cryptonote::get_output_public_key(tx.vout[i], pkey) || od.pubkey != pkey || od.height != height || od.unlock_time != tx.unlock_time)
+      res.error(height, "output " + std::to_string(i) + " of tx " + string_tools::pod_to_hex(txid) + " does not match output_amounts");
+    const tx_out_index toi = db.get_output_tx_and_index(amount, indices[i]);
+    if (toi.first != txid || toi.second != i)
+      res.error(height, "output " + std::to_string(i) + " of tx " + string_tools::pod_to_hex(txid) + " does not match output_txs");
+    if (amount)
+      ++res.pre_rct_outputs[amount];
+  }
+  res.outputs += tx.vout.size();
+  if (tx.version > 1)
+    rct_outputs += tx.vout.size();
+
+  for (const txin_v &in: tx.vin)
+  {
+    if (in.type() != typeid(txin_to_key))
+      continue;
+    if (!db.has_key_image(boost::get<txin_to_key>(in).k_image))
+      res.error(height, "key image " + string_tools::pod_to_hex(boost::get<txin_to_key>(in).k_image) + " of tx " + string_tools::pod_to_hex(txid) + " not in spent_keys");
+    ++res.key_images;
+  }
+}
+
+// Checks blocks [start, end) and their txes, all from one read txn
+static void verify_range(BlockchainDB &db, uint64_t start, uint64_t end, uint64_t blockchain_height, uint32_t pruning_seed, range_result &res)
+{
+  db_rtxn_guard snapshot(&db);
+
+  const uint64_t first = start ? start - 1 : 0;
+  std::vector<uint64_t> cumulative_rct_outputs;
+  try { cumulative_rct_outputs = db.get_block_cumulative_rct_outputs_range(first, end - first); }
+  catch (const std::exception &e) { res.error(start, std::string("failed to read cumulative rct outputs: ") + e.what()); return; }
+
+  for (uint64_t height = start; height < end; ++height)
+  {
+    try
+    {
+      const cryptonote::blobdata bd = db.get_block_blob_from_height(height);
+      res.bytes += bd.size();
+      cryptonote::block b;
+      crypto::hash block_hash;
+      if (!cryptonote::parse_and_validate_block_from_blob(bd, b, block_hash))
+      {
+        res.error(height, "block does not parse");
+        continue;
+      }
+      ++res.blocks;
+      if (db.get_block_hash_from_height(height) != block_hash)
+        res.error(height, "block hash does not match block_info");
+      if (db.get_block_height(block_hash) != height)
+        res.error(height, "block_heights does not match");
+      if (height > 0 && b.prev_id != db.get_block_hash_from_height(height - 1))
+        res.error(height, "prev_id does not match the previous block");
+      if (db.get_block_timestamp(height) != b.timestamp)
+        res.error(height, "timestamp does not match block_info");
+      if (height > 0 && db.get_block_cumulative_difficulty(height) <= db.get_block_cumulative_difficulty(height - 1))
+        res.error(height, "cumulative difficulty does not increase");
+      if (height > 0 && db.get_block_already_generated_coins(height) < db.get_block_already_generated_coins(height - 1))
+        res.error(height, "generated coins decrease");
+
+      uint64_t rct_outputs = 0;
+      verify_tx(db, height, blockchain_height, pruning_seed, cryptonote::get_transaction_hash(b.miner_tx), true, rct_outputs, res);
+      for (const crypto::hash &txid: b.tx_hashes)
+        verify_tx(db, height, blockchain_height, pruning_seed, txid, false, rct_outputs, res);
+
+      const uint64_t previous_rct_outputs = height ? cumulative_rct_outputs[height - 1 - first] : 0;
+      if (cumulative_rct_outputs[height - first] != previous_rct_outputs + rct_outputs)
+        res.error(height, "cumulative rct outputs " + std::to_string(cumulative_rct_outputs[height - first]) + ", expected " + std::to_string(previous_rct_outputs + rct_outputs));
+    }
+    catch (const std::exception &e)
+    {
+      res.error(height, e.what());
+    }
+  }
+}
+
+// Checks the table totals against what the walk found, if the chain did not move meanwhile
+static uint64_t verify_totals(BlockchainDB &db, uint64_t blockchain_height, const std::vector<range_result> &results)
+{
+  uint64_t n_errors = 0;
+  uint64_t txes = 0, key_images = 0;
+  std::map<uint64_t, uint64_t> pre_rct_outputs;
+  for (size_t n = 0; n < results.size(); ++n)
+  {
+    const range_result &res = results[n];
+    if (n > 0 && res.txes && results[n - 1].txes && res.first_tx_id != results[n - 1].last_tx_id + 1)
+    {
+      MERROR("tx_id gap between ranges: " << results[n - 1].last_tx_id << " then " << res.first_tx_id);
+      ++n_errors;
+    }
+    txes += res.txes;
+    key_images += res.key_images;
+    for (const auto &e: res.pre_rct_outputs)
+      pre_rct_outputs[e.first] += e.second;
+  }
+
+  db_rtxn_guard snapshot(&db);
+  if (db.height() != blockchain_height)
+  {
+    MWARNING("The chain changed during verification, table totals not checked");
+    return n_errors;
+  }
+
+  if (db.get_tx_count() != txes)
+  {
+    MERROR("txs has " << db.get_tx_count() << " entries, " << txes << " found in blocks");
+    ++n_errors;
+  }
+
+  const auto histogram = db.get_output_histogram(std::vector<uint64_t>(), false, 0, 0);
+  for (const auto &e: histogram)
+  {
+    if (e.first == 0)
+      continue;
+    const auto i = pre_rct_outputs.find(e.first);
+    const uint64_t found = i == pre_rct_outputs.end() ? 0 : i->second;
+    if (std::get<0>(e.second) != found)
+    {
+      MERROR("output_amounts has " << std::get<0>(e.second) << " outputs of amount " << print_money(e.first) << ", " << found << " found in txes");
+      ++n_errors;
+    }
+  }
+  for (const auto &e: pre_rct_outputs)
+  {
+    if (histogram.find(e.first) == histogram.end())
+    {
+      MERROR("output_amounts has no outputs of amount " << print_money(e.first) << ", " << e.second << " found in txes");
+      ++n_errors;
+    }
+  }
+  const uint64_t rct_outputs = blockchain_height ? db.get_block_cumulative_rct_outputs(std::vector<uint64_t>(1, blockchain_height - 1)).front() : 0;
+  if (db.get_num_outputs(0) != rct_outputs)
+  {
+    MERROR("output_amounts has " << db.get_num_outputs(0) << " rct outputs, block_info says " << rct_outputs);
+    ++n_errors;
+  }
+
+  uint64_t spent_keys = 0;
+  db.for_all_key_images([&spent_keys](const crypto::key_image&) { ++spent_keys; return true; });
+  if (spent_keys != key_images)
+  {
+    MERROR("spent_keys has " << spent_keys << " entries, " << key_images << " found in txes");
+    ++n_errors;
+  }
+
+  return n_errors;
+}
+
+int main(int argc, char* argv[])
+{
+  TRY_ENTRY();
+
+  epee::string_tools::set_module_name_and_folder(argv[0]);
+
+  uint32_t log_level = 0;
+
+  tools::on_startup();
+
+  po::options_description desc_cmd_only("Command line options");
+  po::options_description desc_cmd_sett("Command line options and settings options");
+  const command_line::arg_descriptor<std::string> arg_log_level  = {"log-level",  "0-4 or categories", ""};
+  const command_line::arg_descriptor<uint64_t> arg_block_start  = {"block-start", "Start at block number", 0};
+  const command_line::arg_descriptor<uint64_t> arg_block_stop  = {"block-stop", "Stop at block number, 0 for the current height", 0};
+  const command_line::arg_descriptor<uint64_t> arg_range_size  = {"range-size", "Number of blocks each thread checks in one read transaction", 1000};
+
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_testnet_on);
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_stagenet_on);
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_db_cold_dir);
+  command_line::add_arg(desc_cmd_sett, arg_log_level);
+  command_line::add_arg(desc_cmd_sett, arg_block_start);
+  command_line::add_arg(desc_cmd_sett, arg_block_stop);
+  command_line::add_arg(desc_cmd_sett, arg_range_size);
+  command_line::add_arg(desc_cmd_only, command_line::arg_help);
+
+  po::options_description desc_options("Allowed options");
+  desc_options.add(desc_cmd_only).add(desc_cmd_sett);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_options, [&]()
+  {
+    auto parser = po::command_line_parser(argc, argv).options(desc_options);
+    po::store(parser.run(), vm);
+    po::notify(vm);
+    return true;
+  });
+  if (! r)
+    return 1;
+
+  if (command_line::get_arg(vm, command_line::arg_help))
+  {
+    std::cout << "MevaCoin '" << MEVACOIN_RELEASE_NAME << "' (v" << MEVACOIN_VERSION_FULL << ")" << ENDL << ENDL;
+    std::cout << desc_options << std::endl;
+    return 1;
+  }
+
+  mlog_configure(mlog_get_default_log_path("mevacoin-blockchain-verify.log"), true);
+  if (!command_line::is_arg_defaulted(vm, arg_log_level))
+    mlog_set_log(command_line::get_arg(vm, arg_log_level).c_str());
+  else
+    mlog_set_log(std::string(std::to_string(log_level) + ",bcutil:INFO").c_str());
+
+  LOG_PRINT_L0("Starting...");
+
+  std::string opt_data_dir = command_line::get_arg(vm, cryptonote::arg_data_dir);
+  const std::string opt_cold_dir = command_line::get_arg(vm, cryptonote::arg_db_cold_dir);
+  uint64_t opt_block_start = command_line::get_arg(vm, arg_block_start);
+  uint64_t opt_block_stop = command_line::get_arg(vm, arg_block_stop);
+  const uint64_t opt_range_size = std::max<uint64_t>(command_line::get_arg(vm, arg_range_size), 1);
+
+  // Read only, so it may run against the database of a running daemon
+  std::unique_ptr<BlockchainLMDB> db(new BlockchainLMDB());
+  const std::string filename = (boost::filesystem::path(opt_data_dir) / db->get_db_name()).string();
+  LOG_PRINT_L0("Loading blockchain from folder " << filename << " ...");
+
+  try
+  {
+    if (!opt_cold_dir.empty())
+      db->set_cold_storage(opt_cold_dir);
+    db->open(filename, DBF_RDONLY);
+  }
+  catch (const std::exception& e)
+  {
+    LOG_PRINT_L0("Error opening database: " << e.what());
+    return 1;
+  }
+
+  const uint64_t blockchain_height = db->height();
+  const uint32_t pruning_seed = db->get_blockchain_pruning_seed();
+  if (opt_block_stop == 0 || opt_block_stop > blockchain_height)
+    opt_block_stop = blockchain_height;
+  if (opt_block_start >= opt_block_stop)
+  {
+    LOG_PRINT_L0("Nothing to verify");
+    db->close();
+    return 0;
+  }
+  MINFO("Verifying blocks " << opt_block_start << " to " << opt_block_stop - 1 << " of " << blockchain_height
+      << (pruning_seed ? ", pruning seed " + std::to_string(pruning_seed) : ""));
+
+  std::vector<range_result> results((opt_block_stop - opt_block_start + opt_range_size - 1) / opt_range_size);
+  std::atomic<uint64_t> blocks_done(0);
+  const auto start_time = std::chrono::steady_clock::now();
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  tools::threadpool::waiter waiter(tpool);
+  for (size_t n = 0; n < results.size(); ++n)
+  {
+    const uint64_t start = opt_block_start + n * opt_range_size;
+    const uint64_t end = std::min(start + opt_range_size, opt_block_stop);
+    tpool.submit(&waiter, [&, n, start, end]() {
+      verify_range(*db, start, end, blockchain_height, pruning_seed, results[n]);
+      const uint64_t done = blocks_done += end - start;
+      if (done / 10000 != (done - (end - start)) / 10000)
+        MINFO(done << "/" << opt_block_stop - opt_block_start << " blocks verified");
+    }, true);
+  }
+  if (!waiter.wait())
+  {
+    LOG_ERROR("Verification did not complete");
+    db->close();
+    return 1;
+  }
+  const double seconds = std::max<double>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count() / 1000.0, 0.001);
+
+  uint64_t n_errors = 0;
+  range_result total;
+  for (const range_result &res: results)
+  {
+    for (const std::string &e: res.errors)
+      MERROR(e);
+    if (res.n_errors > res.errors.size())
+      MERROR("... and " << res.n_errors - res.errors.size() << " more errors in that range");
+    n_errors += res.n_errors;
+    total.blocks += res.blocks;
+    total.txes += res.txes;
+    total.outputs += res.outputs;
+    total.key_images += res.key_images;
+    total.bytes += res.bytes;
+    total.prunable_pending += res.prunable_pending;
+  }
+  if (opt_block_start == 0 && opt_block_stop == blockchain_height)
+    n_errors += verify_totals(*db, blockchain_height, results);
+  else
+    MINFO("Partial range, table totals not checked");
+  db->close();
+
+  MINFO("Verified " << total.blocks << " blocks, " << total.txes << " txes, " << total.outputs << " outputs, "
+      << total.key_images << " key images in " << seconds << " seconds with " << tpool.get_max_concurrency() << " threads");
+  MINFO("  " << (uint64_t)(total.blocks / seconds) << " blocks/s, " << (uint64_t)(total.txes / seconds) << " txes/s, "
+      << (uint64_t)(total.outputs / seconds) << " outputs/s, " << total.bytes / seconds / 1048576 << " MB/s of blobs");
+  if (total.prunable_pending)
+    MINFO(total.prunable_pending << " txes still have prunable data they will lose when pruning catches up");
+  if (n_errors)
+  {
+    MERROR(n_errors << " errors found");
+    return 1;
+  }
+  MINFO("No errors found");
+  return 0;
+
+  CATCH_ENTRY("Verification error", 1);
+}
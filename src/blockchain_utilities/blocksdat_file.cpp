@@ -27,6 +27,7 @@
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "blocksdat_file.h"
+#include "common/util.h"
 
 #undef MEVACOIN_DEFAULT_LOG_CATEGORY
 #define MEVACOIN_DEFAULT_LOG_CATEGORY "bcutil"
@@ -176,6 +177,18 @@ bool BlocksdatFile::store_blockchain_raw(Blockchain* _blockchain_storage, tx_mem
 
   MINFO("Number of blocks exported: " << num_blocks_written);
 
-  return BlocksdatFile::close();
+  if (!BlocksdatFile::close())
+    return false;
+
+  // the daemon only trusts an embedded mainnet file whose sha256 matches expected_block_hashes_hash
+  crypto::hash file_hash;
+  if (!tools::sha256sum(output_file.string(), file_hash))
+  {
+    MFATAL("failed to hash " << output_file.string());
+    return false;
+  }
+  MINFO("Blocks covered by hashes: " << (block_stop + 1) / HASH_OF_HASHES_STEP * HASH_OF_HASHES_STEP);
+  MINFO("sha256 of " << output_file.string() << ": " << file_hash);
+  return true;
 }
 
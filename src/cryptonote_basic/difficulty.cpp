@@ -32,6 +32,7 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <vector>
 
 #include "int-util.h"
@@ -200,23 +201,17 @@ namespace cryptonote {
       return check_hash_128(hash, difficulty);
   }
 
-  difficulty_type next_difficulty(std::vector<uint64_t> timestamps, std::vector<difficulty_type> cumulative_difficulties, size_t target_seconds) {
-    //cutoff DIFFICULTY_LAG
-    if(timestamps.size() > DIFFICULTY_WINDOW)
-    {
-      timestamps.resize(DIFFICULTY_WINDOW);
-      cumulative_difficulties.resize(DIFFICULTY_WINDOW);
-    }
-
-
-    size_t length = timestamps.size();
-    assert(length == cumulative_difficulties.size());
+  // sorted_timestamps holds the window's timestamps in ascending order, while
+  // cumulative_difficulties is in block order and may be longer than the window
+  template<typename T>
+  static difficulty_type next_difficulty_sorted(const std::vector<uint64_t> &sorted_timestamps, const T &cumulative_difficulties, size_t target_seconds) {
+    size_t length = sorted_timestamps.size();
+    assert(length <= cumulative_difficulties.size());
     if (length <= 1) {
       return 1;
     }
     static_assert(DIFFICULTY_WINDOW >= 2, "Window is too small");
     assert(length <= DIFFICULTY_WINDOW);
-    sort(timestamps.begin(), timestamps.end());
     size_t cut_begin, cut_end;
     static_assert(2 * DIFFICULTY_CUT <= DIFFICULTY_WINDOW - 2, "Cut length is too large");
     if (length <= DIFFICULTY_WINDOW - 2 * DIFFICULTY_CUT) {
@@ -227,7 +222,7 @@ namespace cryptonote {
       cut_end = cut_begin + (DIFFICULTY_WINDOW - 2 * DIFFICULTY_CUT);
     }
     assert(/*cut_begin >= 0 &&*/ cut_begin + 2 <= cut_end && cut_end <= length);
-    uint64_t time_span = timestamps[cut_end - 1] - timestamps[cut_begin];
+    uint64_t time_span = sorted_timestamps[cut_end - 1] - sorted_timestamps[cut_begin];
     if (time_span == 0) {
       time_span = 1;
     }
@@ -239,6 +234,50 @@ namespace cryptonote {
     return res.convert_to<difficulty_type>();
   }
 
+  difficulty_type next_difficulty(std::vector<uint64_t> timestamps, std::vector<difficulty_type> cumulative_difficulties, size_t target_seconds) {
+    //cutoff DIFFICULTY_LAG
+    if(timestamps.size() > DIFFICULTY_WINDOW)
+    {
+      timestamps.resize(DIFFICULTY_WINDOW);
+      cumulative_difficulties.resize(DIFFICULTY_WINDOW);
+    }
+
+    assert(timestamps.size() == cumulative_difficulties.size());
+    sort(timestamps.begin(), timestamps.end());
+    return next_difficulty_sorted(timestamps, cumulative_difficulties, target_seconds);
+  }
+
+  void difficulty_window::push_back(uint64_t timestamp, const difficulty_type &cumulative_difficulty) {
+    m_timestamps.push_back(timestamp);
+    m_cumulative_difficulties.push_back(cumulative_difficulty);
+    // blocks past the window are the DIFFICULTY_LAG ones, they enter it as older blocks are popped
+    if (m_timestamps.size() <= DIFFICULTY_WINDOW)
+      m_sorted_timestamps.insert(std::upper_bound(m_sorted_timestamps.begin(), m_sorted_timestamps.end(), timestamp), timestamp);
+  }
+
+  void difficulty_window::pop_front() {
+    assert(!m_timestamps.empty());
+    const auto it = std::lower_bound(m_sorted_timestamps.begin(), m_sorted_timestamps.end(), m_timestamps.front());
+    assert(it != m_sorted_timestamps.end() && *it == m_timestamps.front());
+    m_sorted_timestamps.erase(it);
+    m_timestamps.pop_front();
+    m_cumulative_difficulties.pop_front();
+    if (m_timestamps.size() >= DIFFICULTY_WINDOW) {
+      const uint64_t timestamp = m_timestamps[DIFFICULTY_WINDOW - 1];
+      m_sorted_timestamps.insert(std::upper_bound(m_sorted_timestamps.begin(), m_sorted_timestamps.end(), timestamp), timestamp);
+    }
+  }
+
+  void difficulty_window::clear() {
+    m_timestamps.clear();
+    m_cumulative_difficulties.clear();
+    m_sorted_timestamps.clear();
+  }
+
+  difficulty_type difficulty_window::next_difficulty(size_t target_seconds) const {
+    return next_difficulty_sorted(m_sorted_timestamps, m_cumulative_difficulties, target_seconds);
+  }
+
   std::string hex(difficulty_type v)
   {
     static const char chars[] = "0123456789abcdef";
@@ -31,6 +31,7 @@
 #pragma once
 
 #include <cstdint>
+#include <deque>
 #include <vector>
 #include <string>
 #include <boost/multiprecision/cpp_int.hpp>
@@ -59,5 +60,32 @@ namespace cryptonote
     bool check_hash(const crypto::hash &hash, difficulty_type difficulty);
     difficulty_type next_difficulty(std::vector<std::uint64_t> timestamps, std::vector<difficulty_type> cumulative_difficulties, size_t target_seconds);
 
+    /**
+     * @brief a rolling window of timestamps and cumulative difficulties
+     *
+     * Blocks are pushed at the back and popped from the front as the chain
+     * grows. The timestamps of the DIFFICULTY_WINDOW oldest blocks are kept
+     * sorted as they enter and leave the window, so the cut timestamps are
+     * found without sorting the window for every block.
+     *
+     * next_difficulty(target_seconds) gives the same result as next_difficulty()
+     * called with the window's timestamps and cumulative difficulties.
+     */
+    class difficulty_window
+    {
+    public:
+      void push_back(uint64_t timestamp, const difficulty_type &cumulative_difficulty);
+      void pop_front();
+      void clear();
+      size_t size() const { return m_timestamps.size(); }
+
+      difficulty_type next_difficulty(size_t target_seconds) const;
+
+    private:
+      std::deque<uint64_t> m_timestamps;
+      std::deque<difficulty_type> m_cumulative_difficulties;
+      std::vector<uint64_t> m_sorted_timestamps;
+    };
+
     std::string hex(difficulty_type v);
 }
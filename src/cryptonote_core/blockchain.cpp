@@ -88,6 +88,19 @@ DISABLE_VS_WARNINGS(4267)
 // used to overestimate the block reward when estimating a per kB to use
 #define BLOCK_REWARD_OVERESTIMATE (10 * 1000000000000)
 
+// max number of outputs whose range proofs are batch verified together when syncing, as
+// the cost of a failed batch, and the memory used by the multiexp, grow with it
+#define RCT_SEMANTICS_SYNC_BATCH_MAX_OUTPUTS 16384
+
+// min number of sorted ring members per worker when fetching them for a sync span, below
+// which splitting the db walk costs more than it saves
+#define OUTPUT_SCAN_MIN_SLICE_SIZE 1024
+
+// derived state key of the persisted long term block weights window, and how many blocks
+// may be added before it is saved again
+#define LONG_TERM_BLOCK_WEIGHTS_STATE_NAME "long_term_block_weights"
+#define LONG_TERM_BLOCK_WEIGHTS_STATE_SAVE_INTERVAL 100
+
 //------------------------------------------------------------------
 Blockchain::Blockchain(tx_memory_pool& tx_pool) :
   m_db(), m_tx_pool(tx_pool), m_hardfork(NULL), m_timestamps_and_difficulties_height(0), m_reset_timestamps_and_difficulties_height(true), m_current_block_cumul_weight_limit(0), m_current_block_cumul_weight_median(0),
@@ -95,6 +108,7 @@ Blockchain::Blockchain(tx_memory_pool& tx_pool) :
   m_long_term_block_weights_window(CRYPTONOTE_LONG_TERM_BLOCK_WEIGHT_WINDOW_SIZE),
   m_long_term_effective_median_block_weight(0),
   m_long_term_block_weights_cache_tip_hash(crypto::null_hash),
+  m_long_term_block_weights_cache_saved_height(0),
   m_long_term_block_weights_cache_rolling_median(CRYPTONOTE_LONG_TERM_BLOCK_WEIGHT_WINDOW_SIZE),
   m_difficulty_for_next_block_top_hash(crypto::null_hash),
   m_difficulty_for_next_block(1),
@@ -455,6 +469,9 @@ bool Blockchain::init(BlockchainDB* db, const network_type nettype, bool offline
 
   {
     db_txn_guard txn_guard(m_db, m_db->is_read_only());
+    // avoids reading a whole window of block weights to rebuild the long term median
+    if (load_long_term_block_weights_cache())
+      MINFO("Restored long term block weight median at height " << m_db->height() - 1);
     if (!update_next_cumulative_weight_limit())
       return false;
   }
@@ -527,6 +544,11 @@ bool Blockchain::deinit()
   {
     if (m_db)
     {
+      if (!m_db->is_read_only())
+      {
+        CRITICAL_REGION_LOCAL(m_blockchain_lock);
+        save_long_term_block_weights_cache(true);
+      }
       m_db->close();
       MTRACE("Local blockchain read/write activity stopped successfully");
     }
@@ -922,8 +944,6 @@ difficulty_type Blockchain::get_difficulty_for_next_block()
   }
 
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
-  std::vector<uint64_t> timestamps;
-  std::vector<difficulty_type> difficulties;
   uint64_t height;
   top_hash = get_tail_id(height); // get it again now that we have the lock
   ++height; // top block height to blockchain height
@@ -932,22 +952,19 @@ difficulty_type Blockchain::get_difficulty_for_next_block()
   //    then when the next block difficulty is queried, push the latest height data and
   //    pop the oldest one from the list. This only requires 1x read per height instead
   //    of doing 735 (DIFFICULTY_BLOCKS_COUNT).
+  // 2. The list keeps its timestamps sorted as blocks enter and leave the window, so the
+  //    window is not copied and sorted again for every block.
   if (m_reset_timestamps_and_difficulties_height)
     m_timestamps_and_difficulties_height = 0;
-  if (m_timestamps_and_difficulties_height != 0 && ((height - m_timestamps_and_difficulties_height) == 1) && m_timestamps.size() >= DIFFICULTY_BLOCKS_COUNT)
+  if (m_timestamps_and_difficulties_height != 0 && ((height - m_timestamps_and_difficulties_height) == 1) && m_difficulty_window.size() >= DIFFICULTY_BLOCKS_COUNT)
   {
     uint64_t index = height - 1;
-    m_timestamps.push_back(m_db->get_block_timestamp(index));
-    m_difficulties.push_back(m_db->get_block_cumulative_difficulty(index));
+    m_difficulty_window.push_back(m_db->get_block_timestamp(index), m_db->get_block_cumulative_difficulty(index));
 
-    while (m_timestamps.size() > DIFFICULTY_BLOCKS_COUNT)
-      m_timestamps.erase(m_timestamps.begin());
-    while (m_difficulties.size() > DIFFICULTY_BLOCKS_COUNT)
-      m_difficulties.erase(m_difficulties.begin());
+    while (m_difficulty_window.size() > DIFFICULTY_BLOCKS_COUNT)
+      m_difficulty_window.pop_front();
 
     m_timestamps_and_difficulties_height = height;
-    timestamps = m_timestamps;
-    difficulties = m_difficulties;
   }
   else
   {
@@ -955,25 +972,14 @@ difficulty_type Blockchain::get_difficulty_for_next_block()
     if (offset == 0)
       ++offset;
 
-    timestamps.clear();
-    difficulties.clear();
-    if (height > offset)
-    {
-      timestamps.reserve(height - offset);
-      difficulties.reserve(height - offset);
-    }
+    m_difficulty_window.clear();
     for (; offset < height; offset++)
-    {
-      timestamps.push_back(m_db->get_block_timestamp(offset));
-      difficulties.push_back(m_db->get_block_cumulative_difficulty(offset));
-    }
+      m_difficulty_window.push_back(m_db->get_block_timestamp(offset), m_db->get_block_cumulative_difficulty(offset));
 
     m_timestamps_and_difficulties_height = height;
-    m_timestamps = timestamps;
-    m_difficulties = difficulties;
   }
   size_t target = get_difficulty_target();
-  difficulty_type diff = next_difficulty(timestamps, difficulties, target);
+  difficulty_type diff = m_difficulty_window.next_difficulty(target);
 
   CRITICAL_REGION_LOCAL1(m_difficulty_lock);
   m_difficulty_for_next_block_top_hash = top_hash;
@@ -1008,28 +1014,23 @@ size_t Blockchain::recalculate_difficulties(boost::optional<uint64_t> start_heig
   const uint64_t top_height = m_db->height() - 1;
   MGINFO("Recalculating difficulties from height " << start_height << " to height " << top_height);
 
-  std::vector<uint64_t> timestamps;
-  std::vector<difficulty_type> difficulties;
-  timestamps.reserve(DIFFICULTY_BLOCKS_COUNT + 1);
-  difficulties.reserve(DIFFICULTY_BLOCKS_COUNT + 1);
+  difficulty_window window;
+  difficulty_type last_cum_diff = start_height;
   if (start_height > 1)
   {
-    for (uint64_t i = 0; i < DIFFICULTY_BLOCKS_COUNT; ++i)
+    const uint64_t first_height = start_height - std::min<uint64_t>(start_height - 1, DIFFICULTY_BLOCKS_COUNT);
+    for (uint64_t height = first_height; height < start_height; ++height)
     {
-      uint64_t height = start_height - 1 - i;
-      if (height == 0)
-        break;
-      timestamps.insert(timestamps.begin(), m_db->get_block_timestamp(height));
-      difficulties.insert(difficulties.begin(), m_db->get_block_cumulative_difficulty(height));
+      last_cum_diff = m_db->get_block_cumulative_difficulty(height);
+      window.push_back(m_db->get_block_timestamp(height), last_cum_diff);
     }
   }
-  difficulty_type last_cum_diff = start_height <= 1 ? start_height : difficulties.back();
   uint64_t drift_start_height = 0;
   std::vector<difficulty_type> new_cumulative_difficulties;
   for (uint64_t height = start_height; height <= top_height; ++height)
   {
     size_t target = get_ideal_hard_fork_version(height) < 2 ? DIFFICULTY_TARGET_V1 : DIFFICULTY_TARGET_V2;
-    difficulty_type recalculated_diff = next_difficulty(timestamps, difficulties, target);
+    difficulty_type recalculated_diff = window.next_difficulty(target);
 
     boost::multiprecision::uint256_t recalculated_cum_diff_256 = boost::multiprecision::uint256_t(recalculated_diff) + last_cum_diff;
     CHECK_AND_ASSERT_THROW_MES(recalculated_cum_diff_256 <= std::numeric_limits<difficulty_type>::max(), "Difficulty overflow!");
@@ -1053,15 +1054,11 @@ size_t Blockchain::recalculate_difficulties(boost::optional<uint64_t> start_heig
     }
 
     if (height > 0)
+      window.push_back(m_db->get_block_timestamp(height), recalculated_cum_diff);
+    if (window.size() > DIFFICULTY_BLOCKS_COUNT)
     {
-      timestamps.push_back(m_db->get_block_timestamp(height));
-      difficulties.push_back(recalculated_cum_diff);
-    }
-    if (timestamps.size() > DIFFICULTY_BLOCKS_COUNT)
-    {
-      CHECK_AND_ASSERT_THROW_MES(timestamps.size() == DIFFICULTY_BLOCKS_COUNT + 1, "Wrong timestamps size: " << timestamps.size());
-      timestamps.erase(timestamps.begin());
-      difficulties.erase(difficulties.begin());
+      CHECK_AND_ASSERT_THROW_MES(window.size() == DIFFICULTY_BLOCKS_COUNT + 1, "Wrong timestamps size: " << window.size());
+      window.pop_front();
     }
     last_cum_diff = recalculated_cum_diff;
   }
@@ -1424,7 +1421,8 @@ bool Blockchain::validate_miner_transaction(const block& b, size_t cumulative_bl
       const char* evt_msg = nullptr;
       int bp = 0; int bm = 1;
       if (meva::find_special_date(block_ts, bp, evt_name, evt_msg)) {
-       if (meva::should_show_commemorative_message(block_ts)) {
+       const time_t prev_ts = block_h > 0 ? static_cast<time_t>(m_db->get_block_timestamp(block_h - 1)) : block_ts;
+       if (meva::should_show_commemorative_message(block_h, block_ts, prev_ts)) {
         MGINFO("");
         MGINFO("  ============================================");
         MGINFO("  [MEVA] " << evt_name);
@@ -1545,6 +1543,68 @@ uint64_t Blockchain::get_long_term_block_weight_median(uint64_t start_height, si
   return m_long_term_block_weights_cache_rolling_median.median();
 }
 //------------------------------------------------------------------
+bool Blockchain::load_long_term_block_weights_cache()
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+
+  crypto::hash state_hash;
+  std::string state;
+  if (!m_db->get_derived_state(LONG_TERM_BLOCK_WEIGHTS_STATE_NAME, state_hash, state))
+    return false;
+
+  uint64_t state_height;
+  if (!m_db->block_exists(state_hash, &state_height))
+  {
+    MINFO("Saved long term block weight median is not for a block on the main chain, rebuilding");
+    return false;
+  }
+
+  // past a window's worth of new blocks, rebuilding is no slower than rolling forward
+  const uint64_t db_height = m_db->height();
+  if (db_height - 1 - state_height >= m_long_term_block_weights_window)
+    return false;
+
+  epee::misc_utils::rolling_median_t<uint64_t> rm(m_long_term_block_weights_window);
+  if (!rm.set_state(state) || (uint64_t)rm.size() != std::min<uint64_t>(state_height + 1, m_long_term_block_weights_window))
+  {
+    MWARNING("Saved long term block weight median is invalid, rebuilding");
+    return false;
+  }
+
+  for (uint64_t height = state_height + 1; height < db_height; ++height)
+    rm.insert(m_db->get_block_long_term_weight(height));
+
+  m_long_term_block_weights_cache_rolling_median = std::move(rm);
+  m_long_term_block_weights_cache_tip_hash = m_db->top_block_hash();
+  m_long_term_block_weights_cache_saved_height = state_height;
+  return true;
+}
+//------------------------------------------------------------------
+void Blockchain::save_long_term_block_weights_cache(bool force)
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+
+  uint64_t top_height;
+  const crypto::hash top_hash = get_tail_id(top_height);
+  if (top_hash != m_long_term_block_weights_cache_tip_hash)
+    return;
+  if ((uint64_t)m_long_term_block_weights_cache_rolling_median.size() != std::min<uint64_t>(top_height + 1, m_long_term_block_weights_window))
+    return;
+  if (!force && top_height >= m_long_term_block_weights_cache_saved_height && top_height - m_long_term_block_weights_cache_saved_height < LONG_TERM_BLOCK_WEIGHTS_STATE_SAVE_INTERVAL)
+    return;
+
+  try
+  {
+    m_db->set_derived_state(LONG_TERM_BLOCK_WEIGHTS_STATE_NAME, top_hash, m_long_term_block_weights_cache_rolling_median.get_state());
+    m_long_term_block_weights_cache_saved_height = top_height;
+  }
+  catch (const std::exception &e)
+  {
+    MWARNING("Failed to save long term block weight median: " << e.what());
+  }
+}
+//------------------------------------------------------------------
 uint64_t Blockchain::get_current_cumulative_block_weight_limit() const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -1600,6 +1660,28 @@ bool Blockchain::create_block_template(block& b, const crypto::hash *from_block,
       seed_hash = m_btc_seed_hash;
       return true;
     }
+
+    // Only the miner tx depends on the address and extra nonce: as long as
+    // the pool and chain tip did not change, the transactions selected for the
+    // cached template are still the best choice, so only swap the miner tx in.
+    // Serving many payout addresses then costs one selection, not one each.
+    if (m_btc_pool_cookie == m_tx_pool.cookie() && m_btc.prev_id == get_tail_id())
+    {
+      MDEBUG("Using cached template transactions for a different address or nonce");
+      b = m_btc;
+      const uint64_t now = time(NULL);
+      if (b.timestamp < now) // ensures it can't get below the median of the last few blocks
+        b.timestamp = now;
+      diffic = m_btc_difficulty;
+      height = m_btc_height;
+      expected_reward = m_btc_expected_reward;
+      seed_height = m_btc_seed_height;
+      seed_hash = m_btc_seed_hash;
+      if (!construct_block_template_miner_tx(b, height, m_btc_median_weight, m_btc_already_generated_coins, m_btc_txs_weight, m_btc_fee, miner_address, ex_nonce, cumulative_weight))
+        return false;
+      cache_block_template(b, miner_address, ex_nonce, diffic, height, expected_reward, cumulative_weight, seed_height, seed_hash, m_btc_pool_cookie, m_btc_median_weight, m_btc_already_generated_coins, m_btc_txs_weight, m_btc_fee);
+      return true;
+    }
     MDEBUG("Not using cached template: address " << (!memcmp(&miner_address, &m_btc_address, sizeof(cryptonote::account_public_address))) << ", nonce " << (m_btc_nonce == ex_nonce) << ", cookie " << (m_btc_pool_cookie == m_tx_pool.cookie()) << ", from_block " << (!!from_block));
     invalidate_block_template_cache();
   }
@@ -1770,6 +1852,16 @@ bool Blockchain::create_block_template(block& b, const crypto::hash *from_block,
       ", fee " << fee);
 #endif
 
+  if (!construct_block_template_miner_tx(b, height, median_weight, already_generated_coins, txs_weight, fee, miner_address, ex_nonce, cumulative_weight))
+    return false;
+
+  if (!from_block)
+    cache_block_template(b, miner_address, ex_nonce, diffic, height, expected_reward, cumulative_weight, seed_height, seed_hash, pool_cookie, median_weight, already_generated_coins, txs_weight, fee);
+  return true;
+}
+//------------------------------------------------------------------
+bool Blockchain::construct_block_template_miner_tx(block& b, uint64_t height, size_t median_weight, uint64_t already_generated_coins, size_t txs_weight, uint64_t fee, const account_public_address& miner_address, const blobdata& ex_nonce, uint64_t& cumulative_weight) const
+{
   /*
    two-phase miner transaction generation: we don't know exact block weight until we prepare block, but we don't know reward until we know
    block weight, so first miner transaction generated with fake amount of money, and with phase we know think we know expected block weight
@@ -1777,7 +1869,12 @@ bool Blockchain::create_block_template(block& b, const crypto::hash *from_block,
   //make blocks coin-base tx looks close to real coinbase tx to get truthful blob weight
   uint8_t hf_version = b.major_version;
   size_t max_outs = hf_version >= 4 ? 1 : 11;
-  bool r = construct_miner_tx(height, median_weight, already_generated_coins, txs_weight, fee, miner_address, b.miner_tx, ex_nonce, max_outs, hf_version);
+  // the parent timestamp picks the first block of a day; for an alternative parent it is not looked up,
+  // and the commemorative message then only shows every tenth block
+  uint64_t prev_height, prev_timestamp = 0;
+  if (m_db->block_exists(b.prev_id, &prev_height))
+    prev_timestamp = m_db->get_block_timestamp(prev_height);
+  bool r = construct_miner_tx(height, median_weight, already_generated_coins, txs_weight, fee, miner_address, b.miner_tx, ex_nonce, max_outs, hf_version, prev_timestamp);
   CHECK_AND_ASSERT_MES(r, false, "Failed to construct miner tx, first chance");
   cumulative_weight = txs_weight + get_transaction_weight(b.miner_tx);
 #if defined(DEBUG_CREATE_BLOCK_TEMPLATE)
@@ -1786,7 +1883,7 @@ bool Blockchain::create_block_template(block& b, const crypto::hash *from_block,
 #endif
   for (size_t try_count = 0; try_count != 10; ++try_count)
   {
-    r = construct_miner_tx(height, median_weight, already_generated_coins, cumulative_weight, fee, miner_address, b.miner_tx, ex_nonce, max_outs, hf_version);
+    r = construct_miner_tx(height, median_weight, already_generated_coins, cumulative_weight, fee, miner_address, b.miner_tx, ex_nonce, max_outs, hf_version, prev_timestamp);
 
     CHECK_AND_ASSERT_MES(r, false, "Failed to construct miner tx, second chance");
     size_t coinbase_weight = get_transaction_weight(b.miner_tx);
@@ -1830,8 +1927,6 @@ bool Blockchain::create_block_template(block& b, const crypto::hash *from_block,
         ", cumulative weight " << cumulative_weight << " is now good");
 #endif
 
-    if (!from_block)
-      cache_block_template(b, miner_address, ex_nonce, diffic, height, expected_reward, cumulative_weight, seed_height, seed_hash, pool_cookie);
     return true;
   }
   LOG_ERROR("Failed to create_block_template with " << 10 << " tries");
@@ -2449,12 +2544,10 @@ bool Blockchain::get_output_distribution(uint64_t amount, uint64_t from_height,
     return false;
   if (amount == 0)
   {
-    std::vector<uint64_t> heights;
-    heights.reserve(to_height + 1 - start_height);
     const uint64_t real_start_height = start_height > 0 ? start_height-1 : start_height;
-    for (uint64_t h = real_start_height; h <= to_height; ++h)
-      heights.push_back(h);
-    distribution = m_db->get_block_cumulative_rct_outputs(heights);
+    if (to_height < real_start_height)
+      return false;
+    distribution = m_db->get_block_cumulative_rct_outputs_range(real_start_height, to_height + 1 - real_start_height);
     if (start_height > 0)
     {
       base = distribution[0];
@@ -3081,6 +3174,23 @@ bool Blockchain::check_tx_inputs(transaction& tx,
   return true;
 }
 //------------------------------------------------------------------
+void Blockchain::get_tx_input_rings(const std::vector<transaction*> &txs, std::vector<rct::ctkeyM> &mix_rings) const
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  mix_rings.clear();
+  mix_rings.resize(txs.size());
+
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  db_rtxn_guard rtxn_guard(m_db);
+  for (size_t n = 0; n < txs.size(); ++n)
+  {
+    tx_verification_context tvc{};
+    crypto::hash valid_input_verification_id = crypto::null_hash;
+    if (!check_tx_inputs(*txs[n], tvc, valid_input_verification_id, NULL, &mix_rings[n]))
+      mix_rings[n].clear();
+  }
+}
+//------------------------------------------------------------------
 bool Blockchain::check_tx_outputs(const transaction& tx, tx_verification_context &tvc, std::uint8_t hf_version)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -3232,6 +3342,31 @@ bool Blockchain::check_tx_outputs(const transaction& tx, tx_verification_context
   return true;
 }
 //------------------------------------------------------------------
+bool Blockchain::check_tx_amounts(const transaction& tx)
+{
+  if (!check_inputs_types_supported(tx) || !check_money_overflow(tx))
+    return false;
+
+  for (const txin_v& in: tx.vin)
+    if (boost::get<txin_to_key>(in).key_offsets.empty())
+      return false;
+
+  if (tx.version == 1)
+  {
+    uint64_t inputs_amount = 0;
+    if (!get_inputs_money_amount(tx, inputs_amount))
+      return false;
+    return inputs_amount >= get_outs_money_amount(tx);
+  }
+
+  // output amounts are hidden in commitments, which the skipped proofs would have balanced.
+  // Inputs may still carry an amount, as RingCT txes can spend pre-RingCT outputs
+  for (const tx_out& out: tx.vout)
+    if (out.amount != 0)
+      return false;
+  return tx.rct_signatures.type != rct::RCTTypeNull && tx.rct_signatures.outPk.size() == tx.vout.size();
+}
+//------------------------------------------------------------------
 bool Blockchain::have_tx_keyimges_as_spent(const transaction &tx) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -3350,7 +3485,8 @@ bool Blockchain::expand_transaction_2(transaction &tx, const crypto::hash &tx_pr
 bool Blockchain::check_tx_inputs(transaction& tx,
   tx_verification_context &tvc,
   crypto::hash &valid_input_verification_id_inout,
-  uint64_t* pmax_used_block_height) const
+  uint64_t* pmax_used_block_height,
+  rct::ctkeyM *deferred_mix_ring_out) const
 {
   PERF_TIMER(check_tx_inputs);
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -3567,6 +3703,12 @@ bool Blockchain::check_tx_inputs(transaction& tx,
 
   // Verify ring signature input proofs
   valid_input_verification_id_inout = crypto::null_hash;
+  if (deferred_mix_ring_out)
+  {
+    MDEBUG("Deferring input verification for tx " << txid);
+    *deferred_mix_ring_out = std::move(pubkeys);
+    return true;
+  }
   if (!ver_input_proofs_rings(tx, pubkeys))
   {
     MERROR_VER("Failed to verify input ring signatures for tx " << txid);
@@ -4079,7 +4221,7 @@ leave:
   {
     tx_verification_context tvc{};
     // If fail non-input consensus rule checking...
-    if (!ver_non_input_consensus(extra_block_txs, tvc, hf_version))
+    if (!ver_non_input_consensus(extra_block_txs, tvc, hf_version, &m_rct_semantics_verified_txs))
     {
       MERROR_VER("Pool supplement provided for block with id: " << id << " failed to pass validation");
       bvc.m_verifivation_failed = true;
@@ -4135,6 +4277,10 @@ leave:
 
   key_images_container keys;
 
+  // txs (by index in txs) whose input proofs are verified together once all txs have been checked
+  std::vector<std::pair<size_t, rct::ctkeyM>> deferred_input_proofs;
+  deferred_input_proofs.reserve(bl.tx_hashes.size());
+
   uint64_t fee_summary = 0;
   uint64_t t_checktx = 0;
   uint64_t t_exists = 0;
@@ -4253,6 +4399,18 @@ leave:
     //     break;
     // }
 
+#if defined(PER_BLOCK_CHECKPOINT)
+    // proofs are assumed valid inside the pre-validated hash area, but spends and amounts
+    // are cheap to check and keep the database consistent if the embedded hashes are wrong
+    if (fast_check && (!check_for_double_spend(tx, keys) || !check_tx_amounts(tx)))
+    {
+      MERROR_VER("Block with id: " << id  << " has at least one transaction (id: " << tx_id << ") with a double spend or invalid amounts.");
+      bvc.m_verifivation_failed = true;
+      return_txs_to_pool();
+      return false;
+    }
+#endif
+
     TIME_MEASURE_FINISH(dd);
     t_dblspnd += dd;
     TIME_MEASURE_START(cc);
@@ -4262,8 +4420,10 @@ leave:
 #endif
     {
       // validate that transaction inputs and the keys spending them are correct.
+      // the input proofs themselves are verified for the whole block below
       tx_verification_context tvc;
-      if(!check_tx_inputs(tx, tvc, valid_input_verification_id))
+      rct::ctkeyM mix_ring;
+      if(!check_tx_inputs(tx, tvc, valid_input_verification_id, NULL, &mix_ring))
       {
         MERROR_VER("Block with id: " << id  << " has at least one transaction (id: " << tx_id << ") with wrong inputs.");
 
@@ -4274,6 +4434,8 @@ leave:
         return_txs_to_pool();
         return false;
       }
+      if (!mix_ring.empty())
+        deferred_input_proofs.emplace_back(txs.size() - 1, std::move(mix_ring));
     }
 
     TIME_MEASURE_FINISH(cc);
@@ -4282,6 +4444,31 @@ leave:
     cumulative_block_weight += tx_weight;
   }
 
+  // verify the input proofs of all the block's txs at once
+  if (!deferred_input_proofs.empty())
+  {
+    TIME_MEASURE_START(ee);
+    std::vector<std::pair<transaction*, const rct::ctkeyM*>> txs_and_mix_rings;
+    txs_and_mix_rings.reserve(deferred_input_proofs.size());
+    for (const auto &deferred: deferred_input_proofs)
+      txs_and_mix_rings.emplace_back(&txs[deferred.first].first, &deferred.second);
+
+    size_t failed_index = 0;
+    if (!ver_input_proofs_rings(txs_and_mix_rings, failed_index))
+    {
+      const crypto::hash &tx_id = std::get<0>(txs_meta[deferred_input_proofs[failed_index].first]);
+      MERROR_VER("Block with id: " << id  << " has at least one transaction (id: " << tx_id << ") with invalid input proofs.");
+
+      add_block_as_invalid(bl, id);
+      MERROR_VER("Block with id " << id << " added as invalid because of wrong inputs in transactions");
+      bvc.m_verifivation_failed = true;
+      return_txs_to_pool();
+      return false;
+    }
+    TIME_MEASURE_FINISH(ee);
+    t_checktx += ee;
+  }
+
   // if we were syncing pruned blocks
   if (n_pruned > 0)
   {
@@ -4380,8 +4567,13 @@ leave:
   bvc.m_added_to_main_chain = true;
   ++m_sync_counter;
 
-  // appears to be a NOP *and* is called elsewhere.  wat?
-  m_tx_pool.on_blockchain_inc(new_height, id);
+  // the pool only has to re-check the txes which conflict with this block
+  std::vector<crypto::key_image> spent_key_images;
+  for (const auto &tx: txs)
+    for (const auto &in: tx.first.vin)
+      if (in.type() == typeid(txin_to_key))
+        spent_key_images.push_back(boost::get<txin_to_key>(in).k_image);
+  m_tx_pool.on_blockchain_inc(new_height, id, spent_key_images);
   get_difficulty_for_next_block(); // just to cache it
   invalidate_block_template_cache();
 
@@ -4434,6 +4626,50 @@ bool Blockchain::update_blockchain_pruning()
   return m_db->update_pruning();
 }
 //------------------------------------------------------------------
+bool Blockchain::prune_blockchain_step(uint32_t pruning_seed, uint64_t max_bytes, uint64_t max_txes, uint64_t &pruned_bytes, bool &done)
+{
+  // block writes come first: if they hold the lock, try again later rather than wait
+  m_tx_pool.lock();
+  epee::misc_utils::auto_scope_leave_caller unlocker = epee::misc_utils::create_scope_leave_handler([&](){m_tx_pool.unlock();});
+  if (!m_blockchain_lock.try_lock())
+    return false;
+  epee::misc_utils::auto_scope_leave_caller blockchain_unlocker = epee::misc_utils::create_scope_leave_handler([&](){m_blockchain_lock.unlock();});
+
+  done = m_db->prune_blockchain_step(pruning_seed, max_bytes, max_txes, pruned_bytes);
+  return true;
+}
+//------------------------------------------------------------------
+bool Blockchain::reserve_db_storage()
+{
+  // growing storage may wait on all db access, so leave it for later if blocks are being added
+  if (!m_blockchain_lock.try_lock())
+    return true;
+  epee::misc_utils::auto_scope_leave_caller unlocker = epee::misc_utils::create_scope_leave_handler([&](){m_blockchain_lock.unlock();});
+
+  try
+  {
+    m_db->reserve_storage();
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Failed to grow db storage: " << e.what());
+    return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------
+bool Blockchain::move_to_cold_storage(uint64_t min_depth, uint64_t max_blocks, uint64_t &moved_bytes, bool &done)
+{
+  m_tx_pool.lock();
+  epee::misc_utils::auto_scope_leave_caller unlocker = epee::misc_utils::create_scope_leave_handler([&](){m_tx_pool.unlock();});
+  if (!m_blockchain_lock.try_lock())
+    return false;
+  epee::misc_utils::auto_scope_leave_caller blockchain_unlocker = epee::misc_utils::create_scope_leave_handler([&](){m_blockchain_lock.unlock();});
+
+  done = m_db->move_to_cold_storage(min_depth, max_blocks, moved_bytes);
+  return true;
+}
+//------------------------------------------------------------------
 bool Blockchain::check_blockchain_pruning()
 {
   m_tx_pool.lock();
@@ -4676,6 +4912,70 @@ void Blockchain::block_longhash_worker(uint64_t height, const epee::span<const b
   TIME_MEASURE_FINISH(t);
 }
 
+//------------------------------------------------------------------
+void Blockchain::rct_semantics_worker(uint64_t height, const std::vector<block_complete_entry> &blocks_entry, std::unordered_set<crypto::hash> &verified) const
+{
+  TIME_MEASURE_START(t);
+
+  std::vector<transaction> txes;
+  std::vector<uint64_t> tx_heights;
+  for (const auto &entry : blocks_entry)
+  {
+    for (const auto &tx_blob : entry.txs)
+    {
+      if (m_cancel)
+        return;
+      // anything we can't parse or verify here is left for handle_block_to_main_chain
+      transaction tx;
+      if (!parse_and_validate_tx_from_blob(tx_blob.blob, tx))
+        continue;
+      if (tx.version < 2 || tx.pruned || tx.rct_signatures.type == rct::RCTTypeNull)
+        continue;
+      txes.push_back(std::move(tx));
+      tx_heights.push_back(height);
+    }
+    ++height;
+  }
+
+  // verifies [begin, end) as one batch, halving on failure until the bad txs are isolated
+  std::function<void(size_t, size_t)> verify_batch = [&](size_t begin, size_t end)
+  {
+    std::vector<const rct::rctSig*> rvv;
+    rvv.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i)
+      rvv.push_back(&txes[i].rct_signatures);
+    if (ver_mixed_rct_semantics(std::move(rvv)))
+    {
+      for (size_t i = begin; i < end; ++i)
+        verified.insert(get_transaction_hash(txes[i]));
+      return;
+    }
+    if (end - begin == 1)
+    {
+      MERROR_VER("Tx " << get_transaction_hash(txes[begin]) << " in block at height " << tx_heights[begin] << " failed RingCT semantics batch verification");
+      return;
+    }
+    const size_t middle = begin + (end - begin) / 2;
+    verify_batch(begin, middle);
+    verify_batch(middle, end);
+  };
+
+  // split into batches by number of outputs, which is what the range proofs scale with
+  size_t begin = 0;
+  while (begin < txes.size() && !m_cancel)
+  {
+    size_t end = begin, n_outputs = 0;
+    while (end < txes.size() && (end == begin || n_outputs + txes[end].vout.size() <= RCT_SEMANTICS_SYNC_BATCH_MAX_OUTPUTS))
+      n_outputs += txes[end++].vout.size();
+    verify_batch(begin, end);
+    begin = end;
+  }
+
+  TIME_MEASURE_FINISH(t);
+  if (m_show_time_stats)
+    MDEBUG("RingCT semantics for " << txes.size() << " txes verified in " << t << " ms");
+}
+
 //------------------------------------------------------------------
 bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
 {
@@ -4689,6 +4989,7 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
   {
     if (m_batch_success)
     {
+      save_long_term_block_weights_cache(false);
       m_db->batch_stop();
       if (m_reset_timestamps_and_difficulties_height)
       {
@@ -4736,6 +5037,7 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
   TIME_MEASURE_FINISH(t1);
   m_blocks_longhash_table.clear();
   m_scan_table.clear();
+  m_rct_semantics_verified_txs.clear();
 
   // when we're well clear of the precomputed hashes, free the memory
   if (!m_blocks_hash_check.empty() && m_db->height() > m_blocks_hash_check.size() + 4096)
@@ -4754,11 +5056,11 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
 }
 
 //------------------------------------------------------------------
-void Blockchain::output_scan_worker(const uint64_t amount, const std::vector<uint64_t> &offsets, std::vector<output_data_t> &outputs) const
+void Blockchain::output_scan_worker(const std::vector<std::pair<uint64_t, uint64_t>> &amount_indices, std::vector<output_data_t> &outputs, std::vector<bool> &found) const
 {
   try
   {
-    m_db->get_output_key(epee::span<const uint64_t>(&amount, 1), offsets, outputs, true);
+    m_db->get_output_keys_batch(amount_indices, outputs, found);
   }
   catch (const std::exception& e)
   {
@@ -4905,10 +5207,15 @@ bool Blockchain::has_block_weights(uint64_t height, uint64_t nblocks) const
 //------------------------------------------------------------------
 // ND: Speedups:
 // 1. Thread long_hash computations if possible (m_max_prepare_blocks_threads = nthreads, default = 4)
-// 2. Group all amounts (from txs) and related absolute offsets and form a table of tx_prefix_hash
-//    vs [k_image, output_keys] (m_scan_table). This is faster because it takes advantage of bulk queries
-//    and is threaded if possible. The table (m_scan_table) will be used later when querying output
-//    keys.
+// 2. Collect all (amount, absolute offset) ring members (from txs), sorted and deduplicated, and form
+//    a table of tx_prefix_hash vs [k_image, output_keys] (m_scan_table). This is faster because the
+//    db is walked in key order by a single cursor per worker, and is threaded if possible. The table
+//    (m_scan_table) will be used later when querying output keys.
+// 3. The long_hash computations are not waited for before building the scan table: tx parsing and
+//    the output key fetch run on the remaining threads while the PoW workers are busy, and both
+//    stages are joined only once the scan table is complete.
+// 4. The RingCT semantics (range proofs) of all txs in the span are batch verified together in the
+//    background, so that handle_block_to_main_chain does not have to verify them block by block.
 bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete_entry> &blocks_entry, std::vector<block> &blocks)
 {
   MTRACE("Blockchain::" << __func__);
@@ -4966,6 +5273,16 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
   unsigned threads = tpool.get_max_concurrency();
   blocks.resize(blocks_entry.size());
 
+  // the long_hash and RingCT semantics workers keep running while the scan table is built below,
+  // so make sure they are done with their inputs and outputs on every path out of this function
+  std::vector<std::unordered_map<crypto::hash, crypto::hash>> maps;
+  std::unordered_set<crypto::hash> rct_semantics_verified_txs;
+  tools::threadpool::waiter longhash_waiter(tpool);
+  const auto longhash_joiner = epee::misc_utils::create_scope_leave_handler([&]() {
+    longhash_waiter.wait();
+    m_prepare_height = 0;
+  });
+
   if (1)
   {
     // limit threads, default limit = 4
@@ -4975,7 +5292,7 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
     unsigned int batches = blocks_entry.size() / threads;
     unsigned int extra = blocks_entry.size() % threads;
     MDEBUG("block_batches: " << batches);
-    std::vector<std::unordered_map<crypto::hash, crypto::hash>> maps(threads);
+    maps.resize(threads);
     auto it = blocks_entry.begin();
     unsigned blockidx = 0;
 
@@ -5025,7 +5342,6 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
     {
       m_blocks_longhash_table.clear();
       uint64_t thread_height = height;
-      tools::threadpool::waiter waiter(tpool);
       m_prepare_height = height;
       m_prepare_nblocks = blocks_entry.size();
       m_prepare_blocks = &blocks;
@@ -5036,21 +5352,9 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
           ++nblocks;
         if (nblocks == 0)
           break;
-        tpool.submit(&waiter, boost::bind(&Blockchain::block_longhash_worker, this, thread_height, epee::span<const block>(&blocks[thread_height - height], nblocks), std::ref(maps[i])), true);
+        tpool.submit(&longhash_waiter, boost::bind(&Blockchain::block_longhash_worker, this, thread_height, epee::span<const block>(&blocks[thread_height - height], nblocks), std::ref(maps[i])), true);
         thread_height += nblocks;
       }
-
-      if (!waiter.wait())
-        return false;
-      m_prepare_height = 0;
-
-      if (m_cancel)
-         return false;
-
-      for (const auto & map : maps)
-      {
-        m_blocks_longhash_table.insert(map.begin(), map.end());
-      }
     }
   }
 
@@ -5067,21 +5371,23 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
   m_fake_pow_calc_time = 0;
 
   m_scan_table.clear();
+  m_rct_semantics_verified_txs.clear();
 
-  TIME_MEASURE_FINISH(prepare);
-  m_fake_pow_calc_time = prepare / blocks_entry.size();
+  const unsigned longhash_threads = threads;
 
-  if (blocks_entry.size() > 1 && threads > 1 && m_show_time_stats)
-    MDEBUG("Prepare blocks took: " << prepare << " ms");
+  // not a leaf job, as the range proof batch verification may itself use the thread pool
+  if (total_txs > 0)
+    tpool.submit(&longhash_waiter, [this, height, &blocks_entry, &rct_semantics_verified_txs]() {
+      rct_semantics_worker(height, blocks_entry, rct_semantics_verified_txs);
+    });
 
   TIME_MEASURE_START(scantable);
 
-  // [input] stores all unique amounts found
-  std::vector < uint64_t > amounts;
-  // [input] stores all absolute_offsets for each amount
-  std::map<uint64_t, std::vector<uint64_t>> offset_map;
-  // [output] stores all output_data_t for each absolute_offset
-  std::map<uint64_t, std::vector<output_data_t>> tx_map;
+  // [input] stores all (amount, absolute_offset) pairs, sorted and unique
+  std::vector<std::pair<uint64_t, uint64_t>> amount_indices;
+  // [output] stores the output_data_t for each pair, and whether it was found
+  std::vector<output_data_t> outputs_found;
+  std::vector<bool> found;
   std::vector<std::pair<cryptonote::transaction, crypto::hash>> txes(total_txs);
 
 #define SCAN_TABLE_QUIT(m) \
@@ -5091,7 +5397,7 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
             return false; \
         } while(0); \
 
-  // generate sorted tables for all amounts and absolute offsets
+  // generate a sorted table of all amounts and absolute offsets
   size_t tx_index = 0, block_index = 0;
   for (const auto &entry : blocks_entry)
   {
@@ -5118,7 +5424,7 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
       its = m_scan_table.find(tx_prefix_hash);
       assert(its != m_scan_table.end());
 
-      // get all amounts from tx.vin(s)
+      // get all ring members from tx.vin(s)
       for (const auto &txin : tx.vin)
       {
         const txin_to_key &in_to_key = boost::get < txin_to_key > (txin);
@@ -5128,70 +5434,61 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
         if (it != its->second.end())
           SCAN_TABLE_QUIT("Duplicate key_image found from incoming blocks.");
 
-        amounts.push_back(in_to_key.amount);
-      }
-
-      // sort and remove duplicate amounts from amounts list
-      std::sort(amounts.begin(), amounts.end());
-      auto last = std::unique(amounts.begin(), amounts.end());
-      amounts.erase(last, amounts.end());
-
-      // add amount to the offset_map and tx_map
-      for (const uint64_t &amount : amounts)
-      {
-        if (offset_map.find(amount) == offset_map.end())
-          offset_map.emplace(amount, std::vector<uint64_t>());
-
-        if (tx_map.find(amount) == tx_map.end())
-          tx_map.emplace(amount, std::vector<output_data_t>());
-      }
-
-      // add new absolute_offsets to offset_map
-      for (const auto &txin : tx.vin)
-      {
-        const txin_to_key &in_to_key = boost::get < txin_to_key > (txin);
         // no need to check for duplicate here.
         auto absolute_offsets = relative_output_offsets_to_absolute(in_to_key.key_offsets);
         for (const auto & offset : absolute_offsets)
-          offset_map[in_to_key.amount].push_back(offset);
-
+          amount_indices.emplace_back(in_to_key.amount, offset);
       }
     }
     ++block_index;
   }
 
-  // sort and remove duplicate absolute_offsets in offset_map
-  for (auto &offsets : offset_map)
-  {
-    std::sort(offsets.second.begin(), offsets.second.end());
-    auto last = std::unique(offsets.second.begin(), offsets.second.end());
-    offsets.second.erase(last, offsets.second.end());
-  }
+  // sort and remove duplicate ring members, so the db is walked in key order
+  std::sort(amount_indices.begin(), amount_indices.end());
+  amount_indices.erase(std::unique(amount_indices.begin(), amount_indices.end()), amount_indices.end());
 
-  // gather all the output keys
+  // gather all the output keys, splitting the sorted list in contiguous
+  // slices so each worker still walks its part of the db in key order
   threads = tpool.get_max_concurrency();
   if (!m_db->can_thread_bulk_indices())
     threads = 1;
+  const size_t slices = std::max<size_t>(1, std::min<size_t>(threads, amount_indices.size() / OUTPUT_SCAN_MIN_SLICE_SIZE));
 
-  if (threads > 1 && amounts.size() > 1)
+  if (slices > 1)
   {
-    tools::threadpool::waiter waiter(tpool);
+    std::vector<std::vector<std::pair<uint64_t, uint64_t>>> slice_indices(slices);
+    std::vector<std::vector<output_data_t>> slice_outputs(slices);
+    std::vector<std::vector<bool>> slice_found(slices);
+    {
+      tools::threadpool::waiter waiter(tpool);
+      const size_t slice_size = (amount_indices.size() + slices - 1) / slices;
+      for (size_t i = 0; i < slices; i++)
+      {
+        const size_t start = std::min(i * slice_size, amount_indices.size());
+        const size_t end = std::min(start + slice_size, amount_indices.size());
+        slice_indices[i].assign(amount_indices.begin() + start, amount_indices.begin() + end);
+        tpool.submit(&waiter, boost::bind(&Blockchain::output_scan_worker, this, std::cref(slice_indices[i]), std::ref(slice_outputs[i]), std::ref(slice_found[i])), true);
+      }
+      if (!waiter.wait())
+        return false;
+    }
 
-    for (size_t i = 0; i < amounts.size(); i++)
+    outputs_found.reserve(amount_indices.size());
+    found.reserve(amount_indices.size());
+    for (size_t i = 0; i < slices; i++)
     {
-      uint64_t amount = amounts[i];
-      tpool.submit(&waiter, boost::bind(&Blockchain::output_scan_worker, this, amount, std::cref(offset_map[amount]), std::ref(tx_map[amount])), true);
+      // a worker which failed leaves its slice empty: those outputs count as not found
+      slice_outputs[i].resize(slice_indices[i].size());
+      slice_found[i].resize(slice_indices[i].size(), false);
+      outputs_found.insert(outputs_found.end(), slice_outputs[i].begin(), slice_outputs[i].end());
+      found.insert(found.end(), slice_found[i].begin(), slice_found[i].end());
     }
-    if (!waiter.wait())
-      return false;
   }
   else
   {
-    for (size_t i = 0; i < amounts.size(); i++)
-    {
-      uint64_t amount = amounts[i];
-      output_scan_worker(amount, offset_map[amount], tx_map[amount]);
-    }
+    output_scan_worker(amount_indices, outputs_found, found);
+    outputs_found.resize(amount_indices.size());
+    found.resize(amount_indices.size(), false);
   }
 
   // now generate a table for each tx_prefix and k_image hashes
@@ -5218,25 +5515,17 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
         const txin_to_key &in_to_key = boost::get < txin_to_key > (txin);
         auto needed_offsets = relative_output_offsets_to_absolute(in_to_key.key_offsets);
 
+        // amount_indices entries are sorted and unique, and outputs_found entries are in the same order
         std::vector<output_data_t> outputs;
+        outputs.reserve(needed_offsets.size());
         for (const uint64_t & offset_needed : needed_offsets)
         {
-          size_t pos = 0;
-          bool found = false;
-
-          for (const uint64_t &offset_found : offset_map[in_to_key.amount])
-          {
-            if (offset_needed == offset_found)
-            {
-              found = true;
-              break;
-            }
-
-            ++pos;
-          }
+          const std::pair<uint64_t, uint64_t> needed(in_to_key.amount, offset_needed);
+          const auto it = std::lower_bound(amount_indices.begin(), amount_indices.end(), needed);
+          const size_t pos = it - amount_indices.begin();
 
-          if (found && pos < tx_map[in_to_key.amount].size())
-            outputs.push_back(tx_map[in_to_key.amount].at(pos));
+          if (it != amount_indices.end() && *it == needed && found[pos])
+            outputs.push_back(outputs_found[pos]);
           else
             break;
         }
@@ -5254,6 +5543,26 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
       MDEBUG("Prepare scantable took: " << scantable << " ms");
   }
 
+  // join the long_hash and RingCT semantics workers, which ran alongside the scan table construction
+  if (!longhash_waiter.wait())
+    return false;
+  m_prepare_height = 0;
+
+  if (m_cancel)
+    return false;
+
+  for (const auto & map : maps)
+  {
+    m_blocks_longhash_table.insert(map.begin(), map.end());
+  }
+  m_rct_semantics_verified_txs = std::move(rct_semantics_verified_txs);
+
+  TIME_MEASURE_FINISH(prepare);
+  m_fake_pow_calc_time = prepare / blocks_entry.size();
+
+  if (blocks_entry.size() > 1 && longhash_threads > 1 && m_show_time_stats)
+    MDEBUG("Prepare blocks took: " << prepare << " ms");
+
   return true;
 }
 
@@ -5604,7 +5913,7 @@ void Blockchain::invalidate_block_template_cache()
   m_btc_valid = false;
 }
 
-void Blockchain::cache_block_template(const block &b, const cryptonote::account_public_address &address, const blobdata &nonce, const difficulty_type &diff, uint64_t height, uint64_t expected_reward, uint64_t cumulative_weight, uint64_t seed_height, const crypto::hash &seed_hash, uint64_t pool_cookie)
+void Blockchain::cache_block_template(const block &b, const cryptonote::account_public_address &address, const blobdata &nonce, const difficulty_type &diff, uint64_t height, uint64_t expected_reward, uint64_t cumulative_weight, uint64_t seed_height, const crypto::hash &seed_hash, uint64_t pool_cookie, size_t median_weight, uint64_t already_generated_coins, size_t txs_weight, uint64_t fee)
 {
   MDEBUG("Setting block template cache");
   m_btc = b;
@@ -5617,6 +5926,10 @@ void Blockchain::cache_block_template(const block &b, const cryptonote::account_
   m_btc_seed_hash = seed_hash;
   m_btc_seed_height = seed_height;
   m_btc_pool_cookie = pool_cookie;
+  m_btc_median_weight = median_weight;
+  m_btc_already_generated_coins = already_generated_coins;
+  m_btc_txs_weight = txs_weight;
+  m_btc_fee = fee;
   m_btc_valid = true;
 }
 
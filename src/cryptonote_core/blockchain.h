@@ -658,6 +658,21 @@ namespace cryptonote
       crypto::hash &valid_input_verification_id_inout,
       bool kept_by_block = false) const;
 
+    /**
+     * @brief dereferences the rings of a group of transactions for batch input verification
+     *
+     * Runs every input check of check_tx_inputs() except the input proofs themselves, for all
+     * the transactions under a single lock and read transaction, and returns the mixrings they
+     * reference so the caller can verify the proofs of the whole group with ver_input_proofs_rings().
+     *
+     * The mixring of a transaction which fails the checks is left empty: such a transaction
+     * should go through check_tx_inputs() as usual to find out why it failed.
+     *
+     * @param txs the transactions whose inputs to check
+     * @param mix_rings return-by-reference the dereferenced mixring of each transaction
+     */
+    void get_tx_input_rings(const std::vector<transaction*> &txs, std::vector<rct::ctkeyM> &mix_rings) const;
+
     /**
      * @brief get fee quantization mask
      *
@@ -1073,14 +1088,28 @@ namespace cryptonote
     }
 
     /**
-     * @brief get a number of outputs of a specific amount
+     * @brief get a batch of outputs, looked up in (amount, index) order
      *
-     * @param amount the amount
-     * @param offsets the indices (indexed to the amount) of the outputs
+     * @param amount_indices the (amount, index) pairs of the outputs
      * @param outputs return-by-reference the outputs collected
+     * @param found return-by-reference whether each output was found
      */
-    void output_scan_worker(const uint64_t amount,const std::vector<uint64_t> &offsets,
-        std::vector<output_data_t> &outputs) const;
+    void output_scan_worker(const std::vector<std::pair<uint64_t, uint64_t>> &amount_indices,
+        std::vector<output_data_t> &outputs, std::vector<bool> &found) const;
+
+    /**
+     * @brief batch verifies the RingCT semantics (range proofs) of all txs in a set of blocks
+     *
+     * Failing batches are split until the failing txs are found, and those are
+     * left out of the verified set so they get checked again, and rejected,
+     * when their block is added.
+     *
+     * @param height the height of the first block
+     * @param blocks_entry the blocks, with their txs
+     * @param verified return-by-reference the hashes of the txs which passed
+     */
+    void rct_semantics_worker(uint64_t height, const std::vector<block_complete_entry> &blocks_entry,
+        std::unordered_set<crypto::hash> &verified) const;
 
     /**
      * @brief computes the "short" and "long" hashes for a set of blocks
@@ -1114,7 +1143,13 @@ namespace cryptonote
     uint32_t get_blockchain_pruning_seed() const { return m_db->get_blockchain_pruning_seed(); }
     bool prune_blockchain(uint32_t pruning_seed = 0);
     bool update_blockchain_pruning();
+    // returns false without pruning if blocks are being added
+    bool prune_blockchain_step(uint32_t pruning_seed, uint64_t max_bytes, uint64_t max_txes, uint64_t &pruned_bytes, bool &done);
+    bool get_pruning_progress(uint64_t &done, uint64_t &total) const { return m_db->get_pruning_progress(done, total); }
     bool check_blockchain_pruning();
+    bool reserve_db_storage();
+    // returns false without moving anything if blocks are being added
+    bool move_to_cold_storage(uint64_t min_depth, uint64_t max_blocks, uint64_t &moved_bytes, bool &done);
 
     void lock();
     void unlock();
@@ -1193,6 +1228,7 @@ namespace cryptonote
     // metadata containers
     std::unordered_map<crypto::hash, std::unordered_map<crypto::key_image, std::vector<output_data_t>>> m_scan_table;
     std::unordered_map<crypto::hash, crypto::hash> m_blocks_longhash_table;
+    std::unordered_set<crypto::hash> m_rct_semantics_verified_txs;
 
     // Keccak hashes for each block and for fast pow checking
     std::vector<std::pair<crypto::hash, crypto::hash>> m_blocks_hash_of_hashes;
@@ -1209,13 +1245,13 @@ namespace cryptonote
     uint64_t m_fake_scan_time;
     uint64_t m_sync_counter;
     uint64_t m_bytes_to_sync;
-    std::vector<uint64_t> m_timestamps;
-    std::vector<difficulty_type> m_difficulties;
+    difficulty_window m_difficulty_window;
     uint64_t m_timestamps_and_difficulties_height;
     bool m_reset_timestamps_and_difficulties_height;
     uint64_t m_long_term_block_weights_window;
     uint64_t m_long_term_effective_median_block_weight;
     mutable crypto::hash m_long_term_block_weights_cache_tip_hash;
+    uint64_t m_long_term_block_weights_cache_saved_height;
     mutable epee::misc_utils::rolling_median_t<uint64_t> m_long_term_block_weights_cache_rolling_median;
 
     epee::critical_section m_difficulty_lock;
@@ -1252,6 +1288,10 @@ namespace cryptonote
     uint64_t m_btc_cumulative_weight;
     crypto::hash m_btc_seed_hash;
     uint64_t m_btc_seed_height;
+    size_t m_btc_median_weight;
+    uint64_t m_btc_already_generated_coins;
+    size_t m_btc_txs_weight;
+    uint64_t m_btc_fee;
     bool m_btc_valid;
 
 
@@ -1343,6 +1383,7 @@ namespace cryptonote
      * @param tvc returned information about tx verification
      * @param valid_input_verification_id_inout a previously valid verID if non-null, set on input verification
      * @param pmax_related_block_height return-by-pointer the height of the most recent block in the input set
+     * @param deferred_mix_ring_out if not NULL, input proofs are not verified here: when they need verifying, the dereferenced mixring is returned instead
      *
      * @return false if any validation step fails, otherwise true
      *
@@ -1353,11 +1394,16 @@ namespace cryptonote
      * then input verification is attempted anyways. If input verification is attempted and fails,
      * then `valid_input_verification_id_inout` is set to null. If input verification is attempted and succeeds,
      * then `valid_input_verification_id_inout` is set to the current used verification ID.
+     *
+     * If `deferred_mix_ring_out` is non-null and input verification would be attempted, the mixring is moved
+     * into it and the input proofs are left for the caller to verify (see ver_input_proofs_rings), so that
+     * the proofs of several transactions can be verified together. It is left empty if no verification is needed.
      */
     bool check_tx_inputs(transaction& tx,
       tx_verification_context &tvc,
       crypto::hash &valid_input_verification_id_inout,
-      uint64_t* pmax_used_block_height = NULL) const;
+      uint64_t* pmax_used_block_height = NULL,
+      rct::ctkeyM *deferred_mix_ring_out = NULL) const;
 
     /**
      * @brief performs a blockchain reorganization according to the longest chain rule
@@ -1522,6 +1568,26 @@ namespace cryptonote
      */
     uint64_t get_long_term_block_weight_median(uint64_t start_height, size_t count) const;
 
+    /**
+     * @brief restores the long term block weight median cache saved in the db
+     *
+     * The saved state must be for a block on the main chain. If blocks were
+     * added after it was saved, their weights are rolled into the median.
+     *
+     * @return true if the cache was restored, false if it needs rebuilding
+     */
+    bool load_long_term_block_weights_cache();
+
+    /**
+     * @brief saves the long term block weight median cache to the db
+     *
+     * The cache is saved only if it is for the current top block and, unless
+     * forced, if enough blocks were added since it was last saved.
+     *
+     * @param force save even if it was saved recently
+     */
+    void save_long_term_block_weights_cache(bool force);
+
     /**
      * @brief checks if a transaction is unlocked (its outputs spendable)
      *
@@ -1626,6 +1692,21 @@ namespace cryptonote
      */
     bool check_for_double_spend(const transaction& tx, key_images_container& keys_this_block) const;
 
+    /**
+     * @brief checks the amounts of a transaction whose proofs are assumed valid
+     *
+     * Inside the compiled-in block hash area ring signatures and range proofs
+     * are not verified, so this checks the cheap part of the accounting on its
+     * own: input types, overflow, inputs covering outputs for pre-RingCT
+     * transactions, and hidden output amounts with one commitment per output for
+     * RingCT, whose inputs may still be pre-RingCT outputs with a cleartext amount.
+     *
+     * @param tx the transaction to check
+     *
+     * @return false if the amounts do not add up, otherwise true
+     */
+    static bool check_tx_amounts(const transaction& tx);
+
     /**
      * @brief loads block hashes from compiled-in data set
      *
@@ -1647,7 +1728,27 @@ namespace cryptonote
      *
      * At some point, may be used to push an update to miners
      */
-    void cache_block_template(const block &b, const cryptonote::account_public_address &address, const blobdata &nonce, const difficulty_type &diff, uint64_t height, uint64_t expected_reward, uint64_t cumulative_weight, uint64_t seed_height, const crypto::hash &seed_hash, uint64_t pool_cookie);
+    void cache_block_template(const block &b, const cryptonote::account_public_address &address, const blobdata &nonce, const difficulty_type &diff, uint64_t height, uint64_t expected_reward, uint64_t cumulative_weight, uint64_t seed_height, const crypto::hash &seed_hash, uint64_t pool_cookie, size_t median_weight, uint64_t already_generated_coins, size_t txs_weight, uint64_t fee);
+
+    /**
+     * @brief builds the miner tx of a block template whose transactions are selected
+     *
+     * The miner tx is padded so the block weight it was built for matches the
+     * block's actual weight.
+     *
+     * @param b the block template, its miner tx is replaced
+     * @param height the height of the block
+     * @param median_weight the median block weight the reward is based on
+     * @param already_generated_coins the coins generated before this block
+     * @param txs_weight the total weight of the block's transactions
+     * @param fee the total fee of the block's transactions
+     * @param miner_address the address the reward is paid to
+     * @param ex_nonce extra nonce to add to the miner tx
+     * @param cumulative_weight return-by-reference the weight of the block
+     *
+     * @return true on success, false otherwise
+     */
+    bool construct_block_template_miner_tx(block& b, uint64_t height, size_t median_weight, uint64_t already_generated_coins, size_t txs_weight, uint64_t fee, const account_public_address& miner_address, const blobdata& ex_nonce, uint64_t& cumulative_weight) const;
 
     /**
      * @brief sends new block notifications to ZMQ `miner_data` subscribers
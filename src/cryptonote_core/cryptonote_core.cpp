@@ -71,6 +71,9 @@ DISABLE_VS_WARNINGS(4355)
 // basically at least how many bytes the block itself serializes to without the miner tx
 #define BLOCK_SIZE_SANITY_LEEWAY 100
 
+// blocks moved to cold storage per idle step, while holding the blockchain lock
+#define COLD_STORAGE_BLOCKS_PER_STEP 100
+
 namespace cryptonote
 {
   const command_line::arg_descriptor<bool, false> arg_testnet_on  = {
@@ -198,6 +201,16 @@ namespace cryptonote
   , "Prune blockchain"
   , false
   };
+  static const command_line::arg_descriptor<bool> arg_prune_blockchain_background  = {
+    "prune-blockchain-background"
+  , "Prune blockchain in the background, a little at a time, while the daemon keeps running"
+  , false
+  };
+  static const command_line::arg_descriptor<uint64_t> arg_prune_blockchain_io_budget  = {
+    "prune-blockchain-io-budget"
+  , "Maximum prunable data background pruning removes per second, in kB"
+  , 8192
+  };
   static const command_line::arg_descriptor<std::string> arg_reorg_notify = {
     "reorg-notify"
   , "Run a program for each reorg, '%s' will be replaced by the split height, "
@@ -240,7 +253,10 @@ namespace cryptonote
               m_disable_dns_checkpoints(false),
               m_update_download(0),
               m_nettype(UNDEFINED),
-              m_update_available(false)
+              m_update_available(false),
+              m_background_pruning(false),
+              m_background_pruning_budget(0),
+              m_cold_storage(false)
   {
     m_checkpoints_updating.clear();
     set_cryptonote_protocol(pprotocol);
@@ -344,6 +360,8 @@ namespace cryptonote
     command_line::add_arg(desc, arg_max_txpool_weight);
     command_line::add_arg(desc, arg_block_notify);
     command_line::add_arg(desc, arg_prune_blockchain);
+    command_line::add_arg(desc, arg_prune_blockchain_background);
+    command_line::add_arg(desc, arg_prune_blockchain_io_budget);
     command_line::add_arg(desc, arg_reorg_notify);
     command_line::add_arg(desc, arg_block_rate_notify);
     command_line::add_arg(desc, arg_keep_alt_blocks);
@@ -440,6 +458,12 @@ namespace cryptonote
     return true;
   }
   //-----------------------------------------------------------------------------------------------
+  bool core::get_txpool_backlog_by_fee(std::vector<tx_backlog_entry>& backlog, bool include_sensitive_txes) const
+  {
+    m_mempool.get_transaction_backlog_by_fee(backlog, include_sensitive_txes);
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::get_transactions(const std::vector<crypto::hash>& txs_ids, std::vector<transaction>& txs, std::vector<crypto::hash>& missed_txs, bool pruned) const
   {
     return m_blockchain_storage.get_transactions(txs_ids, txs, missed_txs, pruned);
@@ -469,12 +493,15 @@ namespace cryptonote
     m_disable_dns_checkpoints |= not allow_dns;
 
     std::string db_sync_mode = command_line::get_arg(vm, cryptonote::arg_db_sync_mode);
+    std::string db_cold_dir = command_line::get_arg(vm, cryptonote::arg_db_cold_dir);
     bool db_salvage = command_line::get_arg(vm, cryptonote::arg_db_salvage) != 0;
     bool fast_sync = command_line::get_arg(vm, arg_fast_block_sync) != 0;
     uint64_t blocks_threads = command_line::get_arg(vm, arg_prep_blocks_threads);
     std::string check_updates_string = command_line::get_arg(vm, arg_check_updates);
     size_t max_txpool_weight = command_line::get_arg(vm, arg_max_txpool_weight);
     bool prune_blockchain = command_line::get_arg(vm, arg_prune_blockchain);
+    bool prune_blockchain_background = command_line::get_arg(vm, arg_prune_blockchain_background);
+    m_background_pruning_budget = command_line::get_arg(vm, arg_prune_blockchain_io_budget) * 1024;
     bool keep_alt_blocks = command_line::get_arg(vm, arg_keep_alt_blocks);
     bool keep_fakechain = command_line::get_arg(vm, arg_keep_fakechain);
 
@@ -609,9 +636,11 @@ namespace cryptonote
       if (db_salvage)
         db_flags |= DBF_SALVAGE;
 
+      db->set_cold_storage(db_cold_dir);
       db->open(filename, db_flags);
       if(!db->m_open)
         return false;
+      m_cold_storage = !db_cold_dir.empty() && !db->is_read_only();
     }
     catch (const DB_ERROR& e)
     {
@@ -746,7 +775,13 @@ namespace cryptonote
     if (!keep_alt_blocks && !m_blockchain_storage.get_db().is_read_only())
       m_blockchain_storage.get_db().drop_alt_blocks();
 
-    if (prune_blockchain)
+    // a background pruning run interrupted by a restart picks up where it left off
+    uint64_t pruning_done, pruning_total;
+    if (prune_blockchain_background || m_blockchain_storage.get_pruning_progress(pruning_done, pruning_total))
+    {
+      CHECK_AND_ASSERT_MES(start_background_pruning(), false, "Failed to start background pruning");
+    }
+    else if (prune_blockchain)
     {
       // display a message if the blockchain is not pruned yet
       if (!m_blockchain_storage.get_blockchain_pruning_seed())
@@ -837,6 +872,178 @@ namespace cryptonote
     if (!add_new_tx(tx, txid, tx_blob, tx_weight, tvc, tx_relay, relayed))
       return false;
 
+    return report_incoming_tx(txid, tvc);
+    CATCH_ENTRY_L0("core::handle_incoming_tx()", false);
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::handle_incoming_txs(const epee::span<const blobdata> tx_blobs, const epee::span<tx_verification_context> tvcs, relay_method tx_relay, bool relayed)
+  {
+    TRY_ENTRY();
+
+    CHECK_AND_ASSERT_MES(tx_blobs.size() == tvcs.size(), false, "Mismatched tx blob and verification context counts");
+
+    struct incoming_tx
+    {
+      transaction tx;
+      crypto::hash txid = crypto::null_hash;
+      uint64_t weight = 0;
+      bool to_verify = false;
+      bool nic_verified = false;
+      crypto::hash valid_input_verification_id = crypto::null_hash;
+    };
+    std::vector<incoming_tx> txs(tx_blobs.size());
+    for (tx_verification_context &tvc: tvcs)
+      tvc = {};
+
+    tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+
+    // a peer gets dropped for a single bad tx, so once one is found the rest of its batch is not
+    // worth verifying: stop before the ring fetch and the input proofs
+    const auto has_drop_offense = [&tvcs]() {
+      for (const tx_verification_context &tvc: tvcs)
+        if ((tvc.m_verifivation_failed || tvc.m_verifivation_impossible) && !tvc.m_no_drop_offense)
+          return true;
+      return false;
+    };
+
+    // stage 1: parse all txs in parallel
+    {
+      tools::threadpool::waiter waiter(tpool);
+      for (size_t i = 0; i < tx_blobs.size(); ++i)
+      {
+        tpool.submit(&waiter, [&, i]() {
+          tx_verification_context &tvc = tvcs[i];
+          if (tx_blobs[i].size() > get_max_tx_size())
+          {
+            LOG_PRINT_L1("WRONG TRANSACTION BLOB, too big size " << tx_blobs[i].size() << ", rejected");
+            tvc.m_verifivation_failed = true;
+            tvc.m_too_big = true;
+            return;
+          }
+          if (!parse_and_validate_tx_from_blob(tx_blobs[i], txs[i].tx, txs[i].txid))
+          {
+            LOG_PRINT_L1("Incoming transactions failed to parse, rejected");
+            tvc.m_verifivation_failed = true;
+            return;
+          }
+          txs[i].weight = get_transaction_weight(txs[i].tx, tx_blobs[i].size());
+          txs[i].to_verify = true;
+        }, true);
+      }
+      if (!waiter.wait())
+        return false;
+    }
+    if (relayed && has_drop_offense())
+      return false;
+
+    // known txs are skipped by add_new_tx anyway, don't spend time verifying them
+    for (incoming_tx &itx: txs)
+      if (itx.to_verify && (m_mempool.have_tx(itx.txid, relay_category::legacy) || m_blockchain_storage.have_tx(itx.txid)))
+        itx.to_verify = false;
+
+    // stage 2: non-input consensus rules, with the RingCT semantics of all txs verified as one batch
+    const uint8_t hf_version = m_blockchain_storage.get_current_hard_fork_version();
+    std::unordered_set<crypto::hash> rct_semantics_verified_txids;
+    {
+      std::vector<const rct::rctSig*> rvv;
+      for (const incoming_tx &itx: txs)
+        if (itx.to_verify && itx.tx.version >= 2 && itx.tx.rct_signatures.type != rct::RCTTypeNull)
+          rvv.push_back(&itx.tx.rct_signatures);
+      // on failure, leave the set empty so each tx gets checked on its own to find the culprit
+      if (rvv.size() > 1 && ver_mixed_rct_semantics(rvv))
+        for (const incoming_tx &itx: txs)
+          if (itx.to_verify && itx.tx.version >= 2 && itx.tx.rct_signatures.type != rct::RCTTypeNull)
+            rct_semantics_verified_txids.insert(itx.txid);
+
+      tools::threadpool::waiter waiter(tpool);
+      for (size_t i = 0; i < txs.size(); ++i)
+      {
+        if (!txs[i].to_verify)
+          continue;
+        tpool.submit(&waiter, [&, i]() {
+          txs[i].nic_verified = ver_non_input_consensus(txs[i].tx, tvcs[i], hf_version, &rct_semantics_verified_txids);
+          txs[i].to_verify = txs[i].nic_verified;
+        }, true);
+      }
+      if (!waiter.wait())
+        return false;
+    }
+    if (relayed && has_drop_offense())
+      return false;
+
+    // stage 3: fetch all rings at once
+    std::vector<size_t> indices;
+    std::vector<transaction*> ptxs;
+    for (size_t i = 0; i < txs.size(); ++i)
+    {
+      if (!txs[i].to_verify)
+        continue;
+      indices.push_back(i);
+      ptxs.push_back(&txs[i].tx);
+    }
+    std::vector<rct::ctkeyM> mix_rings;
+    m_blockchain_storage.get_tx_input_rings(ptxs, mix_rings);
+
+    // stage 4: verify the input proofs of all txs as one batch. Txs without a ring failed the input
+    // checks and are left for the pool to reject with the right reason
+    std::vector<std::pair<transaction*, const rct::ctkeyM*>> txs_and_mix_rings;
+    std::vector<size_t> batch_indices;
+    for (size_t n = 0; n < indices.size(); ++n)
+    {
+      if (mix_rings[n].empty())
+        continue;
+      txs_and_mix_rings.emplace_back(ptxs[n], &mix_rings[n]);
+      batch_indices.push_back(n);
+    }
+    std::vector<bool> verified;
+    ver_input_proofs_rings(txs_and_mix_rings, verified);
+    for (size_t b = 0; b < batch_indices.size(); ++b)
+    {
+      const size_t n = batch_indices[b];
+      incoming_tx &itx = txs[indices[n]];
+      if (!verified[b])
+      {
+        MERROR_VER("Failed to verify input ring signatures for tx " << itx.txid);
+        tvcs[indices[n]].m_verifivation_failed = true;
+        tvcs[indices[n]].m_invalid_input = true;
+        itx.to_verify = false;
+        continue;
+      }
+      itx.valid_input_verification_id = make_input_verification_id(itx.txid, mix_rings[n]);
+    }
+
+    // stage 5: add to the pool one at a time. The key images and the verIDs get checked against
+    // the pool and the chain as they are now, so anything which changed since is caught here
+    bool all_good = true;
+    CRITICAL_REGION_LOCAL(m_incoming_tx_lock);
+    for (size_t i = 0; i < txs.size(); ++i)
+    {
+      incoming_tx &itx = txs[i];
+      tx_verification_context &tvc = tvcs[i];
+      if (tvc.m_verifivation_failed)
+      {
+        all_good = false;
+        if (itx.txid != crypto::null_hash)
+          MERROR_VER("Transaction verification failed: " << itx.txid);
+        continue;
+      }
+      if (!itx.nic_verified)
+        continue; // already known
+      if (!add_new_tx(itx.tx, itx.txid, tx_blobs[i], itx.weight, tvc, tx_relay, relayed,
+            itx.nic_verified ? hf_version : 0, itx.valid_input_verification_id))
+      {
+        all_good = false;
+        continue;
+      }
+      all_good &= report_incoming_tx(itx.txid, tvc);
+    }
+
+    return all_good;
+    CATCH_ENTRY_L0("core::handle_incoming_txs()", false);
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::report_incoming_tx(const crypto::hash &txid, const tx_verification_context &tvc)
+  {
     if (tvc.m_verifivation_failed)
     {
       MERROR_VER("Transaction verification failed: " << txid);
@@ -856,7 +1063,6 @@ namespace cryptonote
     MDEBUG("tx added to pool: " << txid);
 
     return true;
-    CATCH_ENTRY_L0("core::handle_incoming_tx()", false);
   }
   //-----------------------------------------------------------------------------------------------
   bool core::check_tx_semantic(const transaction& tx, tx_verification_context& tvc,
@@ -1120,7 +1326,8 @@ namespace cryptonote
     return m_blockchain_storage.get_total_transactions();
   }
   //-----------------------------------------------------------------------------------------------
-  bool core::add_new_tx(transaction& tx, const crypto::hash& tx_hash, const cryptonote::blobdata &blob, size_t tx_weight, tx_verification_context& tvc, relay_method tx_relay, bool relayed)
+  bool core::add_new_tx(transaction& tx, const crypto::hash& tx_hash, const cryptonote::blobdata &blob, size_t tx_weight, tx_verification_context& tvc, relay_method tx_relay, bool relayed,
+    uint8_t nic_verified_hf_version, const crypto::hash &valid_input_verification_id)
   {
     if(m_mempool.have_tx(tx_hash, relay_category::legacy))
     {
@@ -1135,7 +1342,8 @@ namespace cryptonote
     }
 
     uint8_t version = m_blockchain_storage.get_current_hard_fork_version();
-    const bool res = m_mempool.add_tx(tx, tx_hash, blob, tx_weight, tvc, tx_relay, relayed, version);
+    const bool res = m_mempool.add_tx(tx, tx_hash, blob, tx_weight, tvc, tx_relay, relayed, version,
+      nic_verified_hf_version, valid_input_verification_id);
 
     // If new incoming tx passed verification and entered the pool, notify ZMQ
     if (!tvc.m_verifivation_failed && tvc.m_added_to_pool && matches_category(tx_relay, relay_category::legacy))
@@ -1696,6 +1904,12 @@ namespace cryptonote
     m_check_disk_space_interval.do_call(boost::bind(&core::check_disk_space, this));
     m_block_rate_interval.do_call(boost::bind(&core::check_block_rate, this));
     m_blockchain_pruning_interval.do_call(boost::bind(&core::update_blockchain_pruning, this));
+    if (m_background_pruning)
+      m_background_pruning_interval.do_call(boost::bind(&core::background_prune_step, this));
+    if (!m_blockchain_storage.get_db().is_read_only())
+      m_db_storage_interval.do_call(boost::bind(&Blockchain::reserve_db_storage, &m_blockchain_storage));
+    if (m_cold_storage)
+      m_cold_storage_interval.do_call(boost::bind(&core::cold_storage_step, this));
     m_diff_recalc_interval.do_call(boost::bind(&core::recalculate_difficulties, this));
     m_miner.on_idle();
     m_mempool.on_idle();
@@ -1993,6 +2207,78 @@ namespace cryptonote
     return get_blockchain_storage().prune_blockchain(pruning_seed);
   }
   //-----------------------------------------------------------------------------------------------
+  bool core::start_background_pruning()
+  {
+    if (m_background_pruning)
+      return true;
+    if (m_blockchain_storage.get_db().is_read_only())
+    {
+      MERROR("Cannot prune a read only database");
+      return false;
+    }
+    uint64_t done, total;
+    if (get_blockchain_pruning_seed() && !m_blockchain_storage.get_pruning_progress(done, total))
+    {
+      MINFO("Blockchain is already pruned");
+      return true;
+    }
+    MGINFO("Pruning blockchain in the background, up to " << m_background_pruning_budget / 1024 << " kB/s");
+    m_background_pruning = true;
+    // the first step sets the pruning seed, so peers get told right away
+    return background_prune_step();
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::background_prune_step()
+  {
+    const uint64_t max_txes = std::max<uint64_t>(m_background_pruning_budget / 4096, 64);
+    uint64_t pruned_bytes = 0;
+    bool done = false;
+    try
+    {
+      if (!m_blockchain_storage.prune_blockchain_step(0, m_background_pruning_budget, max_txes, pruned_bytes, done))
+        return true; // blocks are being added, try again next time
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Background pruning failed: " << e.what());
+      m_background_pruning = false;
+      return false;
+    }
+    MDEBUG("Background pruning removed " << pruned_bytes << " bytes");
+    if (done)
+    {
+      MGINFO_GREEN("Blockchain pruning complete");
+      m_background_pruning = false;
+    }
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::cold_storage_step()
+  {
+    // the tip stays hot, it is what peers and reorgs mostly need
+    uint64_t moved_bytes = 0;
+    bool done = false;
+    try
+    {
+      if (!m_blockchain_storage.move_to_cold_storage(CRYPTONOTE_PRUNING_TIP_BLOCKS, COLD_STORAGE_BLOCKS_PER_STEP, moved_bytes, done))
+        return true; // blocks are being added, try again next time
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Moving data to cold storage failed: " << e.what());
+      m_cold_storage = false;
+      return false;
+    }
+    if (moved_bytes)
+      MDEBUG("Moved " << moved_bytes << " bytes to cold storage" << (done ? ", caught up" : ""));
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::get_background_pruning_progress(uint64_t &done, uint64_t &total) const
+  {
+    return get_blockchain_storage().get_pruning_progress(done, total);
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::is_within_compiled_block_hash_area(uint64_t height) const
   {
     return get_blockchain_storage().is_within_compiled_block_hash_area(height);
@@ -128,6 +128,26 @@ namespace cryptonote
       */
      bool handle_incoming_tx(const blobdata& tx_blob, tx_verification_context& tvc, relay_method tx_relay, bool relayed);
 
+     /**
+      * @brief handles a group of incoming transactions
+      *
+      * Verifies the transactions in stages, each over the whole group: parsing and
+      * non-input consensus rules in parallel, a single ring fetch, and one batch
+      * verification of the input proofs. Only the final pass adding the verified
+      * transactions to the pool is serialized, and it still checks their key images
+      * against the pool and the chain as it stands then. Relayed batches stop before
+      * the ring fetch as soon as one transaction fails in a way the peer gets dropped
+      * for, and none of the batch is added to the pool.
+      *
+      * @param tx_blobs the txs to handle
+      * @param tvcs metadata about each transaction's validity, same size as tx_blobs
+      * @param tx_relay how the transactions were received
+      * @param relayed whether or not the transactions were relayed to us
+      *
+      * @return true if every transaction was accepted, false otherwise
+      */
+     bool handle_incoming_txs(epee::span<const blobdata> tx_blobs, epee::span<tx_verification_context> tvcs, relay_method tx_relay, bool relayed);
+
     /**
       * @brief handles a single incoming block
       *
@@ -496,6 +516,14 @@ namespace cryptonote
       * @note see tx_memory_pool::get_txpool_backlog
       */
      bool get_txpool_backlog(std::vector<tx_backlog_entry>& backlog, bool include_sensitive_txes = false) const;
+
+     /**
+      * @copydoc tx_memory_pool::get_transaction_backlog_by_fee
+      * @param include_sensitive_txes include private transactions
+      *
+      * @note see tx_memory_pool::get_transaction_backlog_by_fee
+      */
+     bool get_txpool_backlog_by_fee(std::vector<tx_backlog_entry>& backlog, bool include_sensitive_txes = false) const;
      
      /**
       * @copydoc tx_memory_pool::get_transactions
@@ -871,6 +899,23 @@ namespace cryptonote
       */
      bool update_blockchain_pruning();
 
+     /**
+      * @brief starts pruning the blockchain in the background, a little every second
+      *
+      * @return true on success, false otherwise
+      */
+     bool start_background_pruning();
+
+     /**
+      * @brief gets the progress of background pruning
+      *
+      * @param done return-by-reference the number of transactions pruning went through
+      * @param total return-by-reference the number of transactions pruning goes through
+      *
+      * @return true iff background pruning is in progress
+      */
+     bool get_background_pruning_progress(uint64_t &done, uint64_t &total) const;
+
      /**
       * @brief checks the blockchain pruning if enabled
       *
@@ -963,9 +1008,19 @@ namespace cryptonote
       * @param tx_weight the weight of the transaction
       * @param tx_relay how the transaction was received
       * @param relayed whether or not the transaction was relayed to us
+      * @param nic_verified_hf_version hard fork which "tx" is known to pass non-input consensus test
+      * @param valid_input_verification_id a previously valid verID if non-null
       *
       */
-     bool add_new_tx(transaction& tx, const crypto::hash& tx_hash, const cryptonote::blobdata &blob, size_t tx_weight, tx_verification_context& tvc, relay_method tx_relay, bool relayed);
+     bool add_new_tx(transaction& tx, const crypto::hash& tx_hash, const cryptonote::blobdata &blob, size_t tx_weight, tx_verification_context& tvc, relay_method tx_relay, bool relayed,
+       uint8_t nic_verified_hf_version = 0, const crypto::hash &valid_input_verification_id = crypto::null_hash);
+
+     /**
+      * @brief logs the outcome of handling an incoming transaction
+      *
+      * @return false if the transaction failed verification, true otherwise
+      */
+     static bool report_incoming_tx(const crypto::hash &txid, const tx_verification_context &tvc);
 
      /**
       * @brief add a new transaction to the transaction pool
@@ -1053,6 +1108,20 @@ namespace cryptonote
       */
      bool check_block_rate();
 
+     /**
+      * @brief prunes the next chunk of the blockchain, within the I/O budget
+      *
+      * @return true on success, false otherwise
+      */
+     bool background_prune_step();
+
+     /**
+      * @brief moves the next chunk of old blockchain data to cold storage
+      *
+      * @return true on success, false otherwise
+      */
+     bool cold_storage_step();
+
      /**
       * @brief recalculate difficulties after the last difficulty checklpoint to circumvent the annoying 'difficulty drift' bug
       *
@@ -1085,6 +1154,9 @@ namespace cryptonote
      epee::math_helper::once_a_time_seconds<60*10, true> m_check_disk_space_interval; //!< interval for checking for disk space
      epee::math_helper::once_a_time_seconds<90, false> m_block_rate_interval; //!< interval for checking block rate
      epee::math_helper::once_a_time_seconds<60*60*5, true> m_blockchain_pruning_interval; //!< interval for incremental blockchain pruning
+     epee::math_helper::once_a_time_seconds<1, false> m_background_pruning_interval; //!< interval for background pruning steps
+     epee::math_helper::once_a_time_seconds<60, true> m_db_storage_interval; //!< interval for growing db storage ahead of need
+     epee::math_helper::once_a_time_seconds<1, false> m_cold_storage_interval; //!< interval for moving old data to cold storage
      epee::math_helper::once_a_time_seconds<60*60*24*7, false> m_diff_recalc_interval; //!< interval for recalculating difficulties
 
      std::atomic<bool> m_starter_message_showed; //!< has the "daemon will sync now" message been shown?
@@ -1095,6 +1167,10 @@ namespace cryptonote
 
      std::atomic<bool> m_update_available;
 
+     std::atomic<bool> m_background_pruning; //!< is the blockchain being pruned in the background?
+     uint64_t m_background_pruning_budget; //!< bytes of prunable data background pruning removes per second
+     std::atomic<bool> m_cold_storage; //!< is old blockchain data being moved to cold storage?
+
      std::string m_checkpoints_path; //!< path to json checkpoints file
      time_t m_last_dns_checkpoints_update; //!< time when dns checkpoints were last updated
      time_t m_last_json_checkpoints_update; //!< time when json checkpoints were last updated
@@ -76,7 +76,7 @@ namespace cryptonote
     LOG_PRINT_L2("destinations include " << num_stdaddresses << " standard addresses and " << num_subaddresses << " subaddresses");
   }
   //---------------------------------------------------------------
-  bool construct_miner_tx(size_t height, size_t median_weight, uint64_t already_generated_coins, size_t current_block_weight, uint64_t fee, const account_public_address &miner_address, transaction& tx, const blobdata& extra_nonce, size_t max_outs, uint8_t hard_fork_version) {
+  bool construct_miner_tx(size_t height, size_t median_weight, uint64_t already_generated_coins, size_t current_block_weight, uint64_t fee, const account_public_address &miner_address, transaction& tx, const blobdata& extra_nonce, size_t max_outs, uint8_t hard_fork_version, uint64_t prev_timestamp) {
     tx.vin.clear();
     tx.vout.clear();
     tx.extra.clear();
@@ -115,7 +115,8 @@ namespace cryptonote
       int bp = 0; int bm = 1;
 
       if (meva::find_special_date(now, bp, evt_name, evt_msg)) {
-       if (meva::should_show_commemorative_message(now)) {
+       const time_t prev_ts = prev_timestamp ? static_cast<time_t>(prev_timestamp) : now;
+       if (meva::should_show_commemorative_message(height, now, prev_ts)) {
         LOG_PRINT_L0("[MEVA] " << evt_name << " — " << evt_msg);
         if (bp > 0) LOG_PRINT_L0("[MEVA] Reward bonus: +" << bp << "%");
        }
@@ -23,6 +23,7 @@
 #pragma once
 #include <cstdint>
 #include <ctime>
+#include <climits>
 #include <string>
 
 namespace meva {
@@ -56,7 +57,7 @@ struct SpecialBlock {
 // ║  Il bonus si applica a TUTTI i blocchi di quel giorno.   ║
 // ╚══════════════════════════════════════════════════════════╝
 
-static const SpecialDate SPECIAL_DATES[] = {
+static constexpr SpecialDate SPECIAL_DATES[] = {
 
     // ====== ATTIVE ======
 
@@ -103,7 +104,7 @@ static const SpecialDate SPECIAL_DATES[] = {
     //     "Buon Natale dalla blockchain MevaCoin!"},
 };
 
-static const int NUM_SPECIAL_DATES = sizeof(SPECIAL_DATES) / sizeof(SPECIAL_DATES[0]);
+static constexpr int NUM_SPECIAL_DATES = sizeof(SPECIAL_DATES) / sizeof(SPECIAL_DATES[0]);
 
 
 // ╔══════════════════════════════════════════════════════════╗
@@ -115,7 +116,7 @@ static const int NUM_SPECIAL_DATES = sizeof(SPECIAL_DATES) / sizeof(SPECIAL_DATE
 // ║  quando viene minato quel blocco specifico.              ║
 // ╚══════════════════════════════════════════════════════════╝
 
-static const SpecialBlock SPECIAL_BLOCKS[] = {
+static constexpr SpecialBlock SPECIAL_BLOCKS[] = {
 
     // ====== ATTIVI ======
 
@@ -144,34 +145,104 @@ static const SpecialBlock SPECIAL_BLOCKS[] = {
     //     "Blocco #1.000.000 — Un milione! La storia e' scritta. Bonus x2"},
 };
 
-static const int NUM_SPECIAL_BLOCKS = sizeof(SPECIAL_BLOCKS) / sizeof(SPECIAL_BLOCKS[0]);
+static constexpr int NUM_SPECIAL_BLOCKS = sizeof(SPECIAL_BLOCKS) / sizeof(SPECIAL_BLOCKS[0]);
 
 
 // ╔══════════════════════════════════════════════════════════╗
 // ║                FUNZIONI (non modificare)                  ║
 // ╚══════════════════════════════════════════════════════════╝
 
+// Tutte le funzioni qui sotto sono pure: niente gmtime (non rientrante),
+// niente variabili statiche. Sono chiamate in parallelo dalla validazione
+// dei blocchi e dalla creazione dei template.
+
+// Data civile (calendario gregoriano, UTC)
+struct CivilDate {
+    int64_t year;
+    unsigned month;  // 1-12
+    unsigned day;    // 1-31
+};
+
+// Giorni dal 1970-01-01 per un timestamp, arrotondati verso il basso
+constexpr int64_t days_from_timestamp(int64_t timestamp) {
+    return timestamp >= 0 ? timestamp / 86400 : -((-(timestamp + 1)) / 86400) - 1;
+}
+
+// Giorni dal 1970-01-01 -> data civile (algoritmo "civil_from_days" di H. Hinnant)
+constexpr CivilDate civil_from_days(int64_t z) {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);                // [0, 146096]
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;  // [0, 399]
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);                // [0, 365]
+    const unsigned mp = (5 * doy + 2) / 153;                                     // [0, 11]
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;                             // [1, 31]
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;                                // [1, 12]
+    return CivilDate{static_cast<int64_t>(yoe) + era * 400 + (m <= 2), m, d};
+}
+
+// Come gmtime: fallisce se l'anno non entra in tm_year
+constexpr bool civil_from_timestamp(int64_t timestamp, CivilDate &date) {
+    date = civil_from_days(days_from_timestamp(timestamp));
+    return date.year - 1900 >= INT_MIN && date.year - 1900 <= INT_MAX;
+}
+
+// Tabella (mese, giorno) -> indice in SPECIAL_DATES (-1 se nessuno),
+// calcolata a compile time. A parita' di data vale la prima riga.
+struct SpecialDateTable {
+    int8_t index[12][31];
+};
+
+constexpr SpecialDateTable make_special_date_table() {
+    SpecialDateTable table{};
+    for (int m = 0; m < 12; m++)
+        for (int d = 0; d < 31; d++)
+            table.index[m][d] = -1;
+    for (int i = NUM_SPECIAL_DATES - 1; i >= 0; i--)
+        table.index[SPECIAL_DATES[i].month - 1][SPECIAL_DATES[i].day - 1] = static_cast<int8_t>(i);
+    return table;
+}
+
+constexpr bool special_dates_are_valid() {
+    for (int i = 0; i < NUM_SPECIAL_DATES; i++)
+        if (SPECIAL_DATES[i].month < 1 || SPECIAL_DATES[i].month > 12 || SPECIAL_DATES[i].day < 1 || SPECIAL_DATES[i].day > 31 || SPECIAL_DATES[i].bonus_pct < 0)
+            return false;
+    return true;
+}
+
+static_assert(NUM_SPECIAL_DATES <= 127, "Troppe date commemorative");
+static_assert(special_dates_are_valid(), "Data commemorativa non valida (mese 1-12, giorno 1-31, bonus >= 0)");
+
+static constexpr SpecialDateTable SPECIAL_DATE_TABLE = make_special_date_table();
+
+// Altezza massima dei blocchi bonus: sopra questa non serve cercare
+constexpr uint64_t max_special_block_height() {
+    uint64_t max_height = 0;
+    for (int i = 0; i < NUM_SPECIAL_BLOCKS; i++)
+        if (SPECIAL_BLOCKS[i].height > max_height)
+            max_height = SPECIAL_BLOCKS[i].height;
+    return max_height;
+}
+
+static constexpr uint64_t MAX_SPECIAL_BLOCK_HEIGHT = max_special_block_height();
+
 // Cerca se il timestamp cade in una data commemorativa
 // Ritorna: true se trovata, con bonus_pct, name e msg compilati
 inline bool find_special_date(time_t timestamp, int &bonus_pct, const char* &name, const char* &msg) {
-    struct tm* t = gmtime(&timestamp);
-    if (!t) return false;
-    int m = t->tm_mon + 1;  // tm_mon: 0=Gen, convertiamo a 1=Gen
-    int d = t->tm_mday;
-    for (int i = 0; i < NUM_SPECIAL_DATES; i++) {
-        if (SPECIAL_DATES[i].month == m && SPECIAL_DATES[i].day == d) {
-            bonus_pct = SPECIAL_DATES[i].bonus_pct;
-            name = SPECIAL_DATES[i].name;
-            msg = SPECIAL_DATES[i].msg;
-            return true;
-        }
-    }
-    return false;
+    CivilDate date{};
+    if (!civil_from_timestamp(static_cast<int64_t>(timestamp), date)) return false;
+    const int i = SPECIAL_DATE_TABLE.index[date.month - 1][date.day - 1];
+    if (i < 0) return false;
+    bonus_pct = SPECIAL_DATES[i].bonus_pct;
+    name = SPECIAL_DATES[i].name;
+    msg = SPECIAL_DATES[i].msg;
+    return true;
 }
 
 // Cerca se l'altezza corrisponde a un blocco bonus
 // Ritorna: true se trovato, con multiplier, name e msg compilati
 inline bool find_special_block(uint64_t height, int &multiplier, const char* &name, const char* &msg) {
+    if (height > MAX_SPECIAL_BLOCK_HEIGHT) return false;  // il caso normale, dopo l'ultimo blocco bonus
     for (int i = 0; i < NUM_SPECIAL_BLOCKS; i++) {
         if (SPECIAL_BLOCKS[i].height == height) {
             multiplier = SPECIAL_BLOCKS[i].multiplier;
@@ -207,37 +278,13 @@ inline uint64_t calculate_final_reward(uint64_t base_reward, uint64_t height, ti
 
 
 // Controlla se mostrare il messaggio commemorativo
-// - Primo blocco del giorno: SEMPRE
+// - Primo blocco del giorno (il blocco precedente e' di un altro giorno): SEMPRE
 // - Poi: ogni 10 blocchi (non ad ogni singolo blocco)
 // Il REWARD bonus viene sempre applicato, solo il MESSAGGIO e' limitato
-inline bool should_show_commemorative_message(time_t timestamp) {
-    static int last_shown_day = -1;
-    static int last_shown_year = -1;
-    static int blocks_since_msg = 0;
-
-    struct tm* t = gmtime(&timestamp);
-    if (!t) return true;
-
-    int day = t->tm_yday;
-    int year = t->tm_year;
-
-    if (day != last_shown_day || year != last_shown_year) {
-        // Primo blocco di un nuovo giorno commemorativo
-        last_shown_day = day;
-        last_shown_year = year;
-        blocks_since_msg = 0;
+inline bool should_show_commemorative_message(uint64_t height, time_t timestamp, time_t prev_timestamp) {
+    if (days_from_timestamp(timestamp) != days_from_timestamp(prev_timestamp))
         return true;  // SEMPRE al primo blocco
-    }
-
-    blocks_since_msg++;
-
-    // Mostra ogni 10 blocchi
-    if (blocks_since_msg >= 10) {
-        blocks_since_msg = 0;
-        return true;
-    }
-
-    return false;
+    return height % 10 == 0;
 }
 
 } // namespace meva
@@ -29,6 +29,7 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #include <algorithm>
+#include <memory>
 #include <boost/bimap/support/iterator_type_by.hpp>
 #include <boost/filesystem.hpp>
 #include <unordered_set>
@@ -47,6 +48,7 @@
 #include "tx_verification_utils.h"
 #include "warnings.h"
 #include "common/perf_timer.h"
+#include "common/threadpool.h"
 #include "crypto/hash.h"
 #include "crypto/duration.h"
 
@@ -96,6 +98,13 @@ namespace cryptonote
     //! Max DB check interval for relayable txes
     constexpr const std::chrono::minutes max_relayable_check{2};
 
+    //! how many unverified txes are re-validated together
+    constexpr const size_t revalidation_batch_size = 64;
+
+    //! time spent re-validating per idle call. Idle calls come once a second,
+    //! so this caps re-validation to about a fifth of the cpu
+    constexpr const std::chrono::milliseconds revalidation_budget{200};
+
     constexpr const std::chrono::seconds forward_delay_average{CRYPTONOTE_FORWARD_DELAY_AVERAGE};
 
     // a kind of increasing backoff within min/max bounds
@@ -121,7 +130,7 @@ namespace cryptonote
   }
   //---------------------------------------------------------------------------------
   //---------------------------------------------------------------------------------
-  tx_memory_pool::tx_memory_pool(Blockchain& bchs): m_blockchain(bchs), m_cookie(0), m_txpool_max_weight(DEFAULT_TXPOOL_MAX_WEIGHT), m_txpool_weight(0), m_mine_stem_txes(false), m_next_check(std::time(nullptr))
+  tx_memory_pool::tx_memory_pool(Blockchain& bchs): m_blockchain(bchs), m_cookie(0), m_txpool_max_weight(DEFAULT_TXPOOL_MAX_WEIGHT), m_txpool_weight(0), m_mine_stem_txes(false), m_revalidation_total(0), m_revalidation_done(0), m_revalidation_dropped(0), m_next_check(std::time(nullptr))
   {
     // class code expects unsigned values throughout
     if (m_next_check < time_t(0))
@@ -259,6 +268,7 @@ namespace cryptonote
 
           m_blockchain.add_txpool_tx(id, blob, meta);
           add_tx_to_transient_lists(id, fee / (double)(tx_weight ? tx_weight : 1), receive_time);
+          update_tx_stats(id, meta);
           lock.commit();
         }
         catch (const std::exception &e)
@@ -330,6 +340,7 @@ namespace cryptonote
           m_blockchain.remove_txpool_tx(id);
           m_blockchain.add_txpool_tx(id, blob, meta);
           add_tx_to_transient_lists(id, meta.fee / (double)(tx_weight ? tx_weight : 1), receive_time);
+          update_tx_stats(id, meta);
         }
         lock.commit();
         tvc.m_added_to_pool = !existing_tx;
@@ -348,6 +359,8 @@ namespace cryptonote
     tvc.m_verifivation_failed = false;
     if (tvc.m_added_to_pool)
       m_txpool_weight += tx_weight;
+    if (m_unverified_txs.erase(id))
+      ++m_revalidation_done;
 
     ++m_cookie;
 
@@ -501,6 +514,15 @@ namespace cryptonote
     return true;
   }
   //---------------------------------------------------------------------------------
+  void tx_memory_pool::add_key_images(const transaction_prefix &tx, const crypto::hash &txid, key_images_container &key_images)
+  {
+    for (const txin_v& in: tx.vin)
+    {
+      if (in.type() == typeid(txin_to_key))
+        key_images[boost::get<txin_to_key>(in).k_image].insert(txid);
+    }
+  }
+  //---------------------------------------------------------------------------------
   //FIXME: Can return early before removal of all of the key images.
   //       At the least, need to make sure that a false return here
   //       is treated properly.  Should probably not return early, however.
@@ -608,14 +630,13 @@ namespace cryptonote
   bool tx_memory_pool::get_transaction_info(const crypto::hash &txid, tx_details &td, bool include_sensitive_data, bool include_blob) const
   {
     PERF_TIMER(get_transaction_info);
-    CRITICAL_REGION_LOCAL(m_transactions_lock);
-    CRITICAL_REGION_LOCAL1(m_blockchain);
+    BlockchainDB &db = m_blockchain.get_db();
+    db_rtxn_guard snapshot(&db);
 
     try
     {
-      LockedTXN lock(m_blockchain.get_db());
       txpool_tx_meta_t meta;
-      if (!m_blockchain.get_txpool_tx_meta(txid, meta))
+      if (!db.get_txpool_tx_meta(txid, meta))
       {
         LOG_PRINT_L2("Failed to find tx in txpool: " << txid);
         return false;
@@ -625,13 +646,8 @@ namespace cryptonote
         // We don't want sensitive data && the tx is sensitive, so no need to return it
         return false;
       }
-      cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(txid, relay_category::all);
-      auto ci = m_parsed_tx_cache.find(txid);
-      if (ci != m_parsed_tx_cache.end())
-      {
-        td.tx = ci->second;
-      }
-      else if (!(meta.pruned ? parse_and_validate_tx_base_from_blob(txblob, td.tx) : parse_and_validate_tx_from_blob(txblob, td.tx)))
+      cryptonote::blobdata txblob = db.get_txpool_tx_blob(txid, relay_category::all);
+      if (!(meta.pruned ? parse_and_validate_tx_base_from_blob(txblob, td.tx) : parse_and_validate_tx_from_blob(txblob, td.tx)))
       {
         MERROR("Failed to parse tx from txpool");
         return false;
@@ -667,8 +683,7 @@ namespace cryptonote
   //------------------------------------------------------------------
   bool tx_memory_pool::get_transactions_info(const std::vector<crypto::hash>& txids, std::vector<std::pair<crypto::hash, tx_details>>& txs, bool include_sensitive) const
   {
-    CRITICAL_REGION_LOCAL(m_transactions_lock);
-    CRITICAL_REGION_LOCAL1(m_blockchain);
+    db_rtxn_guard snapshot(&m_blockchain.get_db());
 
     txs.clear();
 
@@ -686,20 +701,30 @@ namespace cryptonote
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::get_complement(const std::vector<crypto::hash> &hashes, std::vector<cryptonote::blobdata> &txes) const
   {
-    CRITICAL_REGION_LOCAL(m_transactions_lock);
-    CRITICAL_REGION_LOCAL1(m_blockchain);
+    // txes not re-validated yet are not handed to peers. The set is taken
+    // before the snapshot, as the pool lock can't be taken while it is held
+    std::unordered_set<crypto::hash> unverified;
+    {
+      CRITICAL_REGION_LOCAL(m_transactions_lock);
+      unverified = m_unverified_txs;
+    }
+
+    BlockchainDB &db = m_blockchain.get_db();
+    db_rtxn_guard snapshot(&db);
 
-    m_blockchain.for_all_txpool_txes([this, &hashes, &txes](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref*) {
+    db.for_all_txpool_txes([&db, &hashes, &txes, &unverified](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref*) {
       const auto tx_relay_method = meta.get_relay_method();
       if (tx_relay_method != relay_method::block && tx_relay_method != relay_method::fluff)
         return true;
+      if (unverified.count(txid))
+        return true;
       const auto i = std::find(hashes.begin(), hashes.end(), txid);
       if (i == hashes.end())
       {
         cryptonote::blobdata bd;
         try
         {
-          if (!m_blockchain.get_txpool_tx_blob(txid, bd, cryptonote::relay_category::broadcasted))
+          if (!db.get_txpool_tx_blob(txid, bd, cryptonote::relay_category::broadcasted))
           {
             MERROR("Failed to get blob for txpool transaction " << txid);
             return true;
@@ -720,6 +745,7 @@ namespace cryptonote
   void tx_memory_pool::on_idle()
   {
     m_remove_stuck_tx_interval.do_call([this](){return remove_stuck_transactions();});
+    revalidate_unverified_transactions();
   }
   //---------------------------------------------------------------------------------
   sorted_tx_container::iterator tx_memory_pool::find_tx_in_sorted_container(const crypto::hash& id)
@@ -799,8 +825,8 @@ namespace cryptonote
     LockedTXN lock(m_blockchain.get_db());
     txs.reserve(m_blockchain.get_txpool_tx_count());
     m_blockchain.for_all_txpool_txes([this, now, &txs, &change_timestamps, &next_check](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *){
-      // 0 fee transactions are never relayed
-      if(!meta.pruned && meta.fee > 0 && !meta.do_not_relay)
+      // 0 fee transactions are never relayed, and neither are txes not re-validated yet
+      if(!meta.pruned && meta.fee > 0 && !meta.do_not_relay && !m_unverified_txs.count(txid))
       {
         const relay_method tx_relay = meta.get_relay_method();
         switch (tx_relay)
@@ -855,6 +881,7 @@ namespace cryptonote
 	 to the callback routines. */
       elem.second.last_relayed_time = now + get_relay_delay(elem.second.last_relayed_time, elem.second.receive_time);
       m_blockchain.update_txpool_tx(elem.first, elem.second);
+      m_ready_txs.erase(elem.first);
     }
 
     m_next_check = time_t(next_check);
@@ -894,12 +921,18 @@ namespace cryptonote
             meta.last_relayed_time = std::chrono::system_clock::to_time_t(now);
 
           m_blockchain.update_txpool_tx(hash, meta);
+          m_ready_txs.erase(hash);
+          update_tx_stats(hash, meta);
           // wait until db update succeeds to ensure tx is visible in the pool
           was_just_broadcasted = !already_broadcasted && meta.matches(relay_category::broadcasted);
 
           if (was_just_broadcasted)
+          {
             // Make sure the tx gets re-added with an updated time
             add_tx_to_transient_lists(hash, meta.fee / (double)meta.weight, std::chrono::system_clock::to_time_t(now));
+            // it may be mined now, so cached block templates are stale
+            ++m_cookie;
+          }
         }
       }
       catch (const std::exception &e)
@@ -915,18 +948,18 @@ namespace cryptonote
   //---------------------------------------------------------------------------------
   size_t tx_memory_pool::get_transactions_count(bool include_sensitive) const
   {
-    CRITICAL_REGION_LOCAL(m_transactions_lock);
-    CRITICAL_REGION_LOCAL1(m_blockchain);
-    return m_blockchain.get_txpool_tx_count(include_sensitive);
+    BlockchainDB &db = m_blockchain.get_db();
+    db_rtxn_guard snapshot(&db);
+    return db.get_txpool_tx_count(include_sensitive ? relay_category::all : relay_category::broadcasted);
   }
   //---------------------------------------------------------------------------------
   void tx_memory_pool::get_transactions(std::vector<transaction>& txs, bool include_sensitive) const
   {
-    CRITICAL_REGION_LOCAL(m_transactions_lock);
-    CRITICAL_REGION_LOCAL1(m_blockchain);
+    BlockchainDB &db = m_blockchain.get_db();
+    db_rtxn_guard snapshot(&db);
     const relay_category category = include_sensitive ? relay_category::all : relay_category::broadcasted;
-    txs.reserve(m_blockchain.get_txpool_tx_count(include_sensitive));
-    m_blockchain.for_all_txpool_txes([&txs](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
+    txs.reserve(db.get_txpool_tx_count(category));
+    db.for_all_txpool_txes([&txs](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
       transaction tx;
       if (!(meta.pruned ? parse_and_validate_tx_base_from_blob(*bd, tx) : parse_and_validate_tx_from_blob(*bd, tx)))
       {
@@ -942,11 +975,11 @@ namespace cryptonote
   //------------------------------------------------------------------
   void tx_memory_pool::get_transaction_hashes(std::vector<crypto::hash>& txs, bool include_sensitive) const
   {
-    CRITICAL_REGION_LOCAL(m_transactions_lock);
-    CRITICAL_REGION_LOCAL1(m_blockchain);
+    BlockchainDB &db = m_blockchain.get_db();
+    db_rtxn_guard snapshot(&db);
     const relay_category category = include_sensitive ? relay_category::all : relay_category::broadcasted;
-    txs.reserve(m_blockchain.get_txpool_tx_count(include_sensitive));
-    m_blockchain.for_all_txpool_txes([&txs](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
+    txs.reserve(db.get_txpool_tx_count(category));
+    db.for_all_txpool_txes([&txs](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
       txs.push_back(txid);
       return true;
     }, false, category);
@@ -1029,15 +1062,26 @@ namespace cryptonote
   //------------------------------------------------------------------
   void tx_memory_pool::get_transaction_backlog(std::vector<tx_backlog_entry>& backlog, bool include_sensitive) const
   {
-    CRITICAL_REGION_LOCAL(m_transactions_lock);
-    CRITICAL_REGION_LOCAL1(m_blockchain);
+    std::vector<tx_stats_entry> entries;
+    {
+      CRITICAL_REGION_LOCAL(m_stats_lock);
+      entries = m_tx_stats;
+    }
+
     const uint64_t now = time(NULL);
-    const relay_category category = include_sensitive ? relay_category::all : relay_category::broadcasted;
-    backlog.reserve(m_blockchain.get_txpool_tx_count(include_sensitive));
-    m_blockchain.for_all_txpool_txes([&backlog, now](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
-      backlog.push_back({meta.weight, meta.fee, meta.receive_time - now});
-      return true;
-    }, false, category);
+    backlog.reserve(entries.size());
+    for (const tx_stats_entry &e: entries)
+    {
+      if (include_sensitive || !e.sensitive)
+        backlog.push_back({e.weight, e.fee, e.receive_time - now});
+    }
+  }
+  //------------------------------------------------------------------
+  void tx_memory_pool::get_transaction_backlog_by_fee(std::vector<tx_backlog_entry>& backlog, bool include_sensitive) const
+  {
+    const uint64_t now = time(NULL);
+    CRITICAL_REGION_LOCAL(m_stats_lock);
+    (include_sensitive ? m_all_stats : m_broadcasted_stats).get_fee_buckets(backlog, now);
   }
   //------------------------------------------------------------------
   void tx_memory_pool::get_block_template_backlog(std::vector<tx_block_template_backlog_entry>& backlog, bool include_sensitive) const
@@ -1103,100 +1147,22 @@ namespace cryptonote
   //------------------------------------------------------------------
   void tx_memory_pool::get_transaction_stats(struct txpool_stats& stats, bool include_sensitive) const
   {
-    CRITICAL_REGION_LOCAL(m_transactions_lock);
-    CRITICAL_REGION_LOCAL1(m_blockchain);
     const uint64_t now = time(NULL);
-    const relay_category category = include_sensitive ? relay_category::all : relay_category::broadcasted;
-    std::map<uint64_t, txpool_histo> agebytes;
-    stats.txs_total = m_blockchain.get_txpool_tx_count(include_sensitive);
-    std::vector<uint32_t> weights;
-    weights.reserve(stats.txs_total);
-    m_blockchain.for_all_txpool_txes([&stats, &weights, now, &agebytes](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
-      weights.push_back(meta.weight);
-      stats.bytes_total += meta.weight;
-      if (!stats.bytes_min || meta.weight < stats.bytes_min)
-        stats.bytes_min = meta.weight;
-      if (meta.weight > stats.bytes_max)
-        stats.bytes_max = meta.weight;
-      if (!meta.relayed)
-        stats.num_not_relayed++;
-      stats.fee_total += meta.fee;
-      if (!stats.oldest || meta.receive_time < stats.oldest)
-        stats.oldest = meta.receive_time;
-      if (meta.receive_time < now - 600)
-        stats.num_10m++;
-      if (meta.last_failed_height)
-        stats.num_failing++;
-      uint64_t age = now - meta.receive_time + (now == meta.receive_time);
-      agebytes[age].txs++;
-      agebytes[age].bytes += meta.weight;
-      if (meta.double_spend_seen)
-        ++stats.num_double_spends;
-      return true;
-    }, false, category);
-
-    stats.bytes_med = epee::misc_utils::median(weights);
-    if (stats.txs_total > 1)
-    {
-      /* looking for 98th percentile */
-      size_t end = stats.txs_total * 0.02;
-      uint64_t delta, factor;
-      std::map<uint64_t, txpool_histo>::iterator it, i2;
-      if (end)
-      {
-        /* If enough txs, spread the first 98% of results across
-         * the first 9 bins, drop final 2% in last bin.
-         */
-        it = agebytes.end();
-        size_t cumulative_num = 0;
-        /* Since agebytes is not empty and end is nonzero, the
-         * below loop can always run at least once.
-         */
-        do {
-          --it;
-          cumulative_num += it->second.txs;
-        } while (it != agebytes.begin() && cumulative_num < end);
-        stats.histo_98pc = it->first;
-        factor = 9;
-        delta = it->first;
-        stats.histo.resize(10);
-      } else
-      {
-        /* If not enough txs, don't reserve the last slot;
-         * spread evenly across all 10 bins.
-         */
-        stats.histo_98pc = 0;
-        it = agebytes.end();
-        factor = stats.txs_total > 9 ? 10 : stats.txs_total;
-        delta = now - stats.oldest;
-        stats.histo.resize(factor);
-      }
-      if (!delta)
-        delta = 1;
-      for (i2 = agebytes.begin(); i2 != it; i2++)
-      {
-        size_t i = (i2->first * factor - 1) / delta;
-        stats.histo[i].txs += i2->second.txs;
-        stats.histo[i].bytes += i2->second.bytes;
-      }
-      for (; i2 != agebytes.end(); i2++)
-      {
-        stats.histo[factor].txs += i2->second.txs;
-        stats.histo[factor].bytes += i2->second.bytes;
-      }
-    }
+    CRITICAL_REGION_LOCAL(m_stats_lock);
+    (include_sensitive ? m_all_stats : m_broadcasted_stats).get_stats(stats, now);
   }
   //------------------------------------------------------------------
   //TODO: investigate whether boolean return is appropriate
   bool tx_memory_pool::get_transactions_and_spent_keys_info(std::vector<tx_info>& tx_infos, std::vector<spent_key_image_info>& key_image_infos, bool include_sensitive_data) const
   {
-    CRITICAL_REGION_LOCAL(m_transactions_lock);
-    CRITICAL_REGION_LOCAL1(m_blockchain);
+    BlockchainDB &db = m_blockchain.get_db();
+    db_rtxn_guard snapshot(&db);
     const relay_category category = include_sensitive_data ? relay_category::all : relay_category::broadcasted;
-    const size_t count = m_blockchain.get_txpool_tx_count(include_sensitive_data);
+    const size_t count = db.get_txpool_tx_count(category);
     tx_infos.reserve(count);
     key_image_infos.reserve(count);
-    m_blockchain.for_all_txpool_txes([&tx_infos, key_image_infos, include_sensitive_data](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
+    key_images_container spent_key_images;
+    db.for_all_txpool_txes([&tx_infos, &spent_key_images, include_sensitive_data](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
       tx_info txi;
       txi.id_hash = epee::string_tools::pod_to_hex(txid);
       txi.tx_blob = blobdata(bd->data(), bd->size());
@@ -1208,6 +1174,7 @@ namespace cryptonote
         return true;
       }
       tx.set_hash(txid);
+      add_key_images(tx, txid, spent_key_images);
       txi.tx_json = obj_to_json_str(tx);
       txi.blob_size = bd->size();
       txi.weight = meta.weight;
@@ -1228,31 +1195,26 @@ namespace cryptonote
       return true;
     }, true, category);
 
-    for (const key_images_container::value_type& kee : m_spent_key_images) {
-      const crypto::key_image& k_image = kee.first;
-      const std::unordered_set<crypto::hash>& kei_image_set = kee.second;
+    // the key images are those of the txes above, so they match the category already
+    for (const key_images_container::value_type& kee : spent_key_images) {
       spent_key_image_info ki;
-      ki.id_hash = epee::string_tools::pod_to_hex(k_image);
-      for (const crypto::hash& tx_id_hash : kei_image_set)
-      {
-        if (m_blockchain.txpool_tx_matches_category(tx_id_hash, category))
-          ki.txs_hashes.push_back(epee::string_tools::pod_to_hex(tx_id_hash));
-      }
-
-      // Only return key images for which we have at least one tx that we can show for them
-      if (!ki.txs_hashes.empty())
-        key_image_infos.push_back(std::move(ki));
+      ki.id_hash = epee::string_tools::pod_to_hex(kee.first);
+      for (const crypto::hash& tx_id_hash : kee.second)
+        ki.txs_hashes.push_back(epee::string_tools::pod_to_hex(tx_id_hash));
+      key_image_infos.push_back(std::move(ki));
     }
     return true;
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::get_pool_for_rpc(std::vector<cryptonote::rpc::tx_in_pool>& tx_infos, cryptonote::rpc::key_images_with_tx_hashes& key_image_infos) const
   {
-    CRITICAL_REGION_LOCAL(m_transactions_lock);
-    CRITICAL_REGION_LOCAL1(m_blockchain);
-    tx_infos.reserve(m_blockchain.get_txpool_tx_count());
-    key_image_infos.reserve(m_blockchain.get_txpool_tx_count());
-    m_blockchain.for_all_txpool_txes([&tx_infos, key_image_infos](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
+    BlockchainDB &db = m_blockchain.get_db();
+    db_rtxn_guard snapshot(&db);
+    const size_t count = db.get_txpool_tx_count();
+    tx_infos.reserve(count);
+    key_image_infos.reserve(count);
+    key_images_container spent_key_images;
+    db.for_all_txpool_txes([&tx_infos, &spent_key_images](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
       cryptonote::rpc::tx_in_pool txi;
       txi.tx_hash = txid;
       if (!(meta.pruned ? parse_and_validate_tx_base_from_blob(*bd, txi.tx) : parse_and_validate_tx_from_blob(*bd, txi.tx)))
@@ -1262,6 +1224,7 @@ namespace cryptonote
         return true;
       }
       txi.tx.set_hash(txid);
+      add_key_images(txi.tx, txid, spent_key_images);
       txi.blob_size = bd->size();
       txi.weight = meta.weight;
       txi.fee = meta.fee;
@@ -1279,18 +1242,8 @@ namespace cryptonote
       return true;
     }, true, relay_category::broadcasted);
 
-    for (const key_images_container::value_type& kee : m_spent_key_images) {
-      std::vector<crypto::hash> tx_hashes;
-      const std::unordered_set<crypto::hash>& kei_image_set = kee.second;
-      for (const crypto::hash& tx_id_hash : kei_image_set)
-      {
-        if (m_blockchain.txpool_tx_matches_category(tx_id_hash, relay_category::broadcasted))
-          tx_hashes.push_back(tx_id_hash);
-      }
-
-      if (!tx_hashes.empty())
-        key_image_infos[kee.first] = std::move(tx_hashes);
-    }
+    for (const key_images_container::value_type& kee : spent_key_images)
+      key_image_infos[kee.first] = std::vector<crypto::hash>(kee.second.begin(), kee.second.end());
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -1318,11 +1271,11 @@ namespace cryptonote
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::get_transaction(const crypto::hash& id, cryptonote::blobdata& txblob, relay_category tx_category) const
   {
-    CRITICAL_REGION_LOCAL(m_transactions_lock);
-    CRITICAL_REGION_LOCAL1(m_blockchain);
+    BlockchainDB &db = m_blockchain.get_db();
+    db_rtxn_guard snapshot(&db);
     try
     {
-      return m_blockchain.get_txpool_tx_blob(id, txblob, tx_category);
+      return db.get_txpool_tx_blob(id, txblob, tx_category);
     }
     catch (const std::exception &e)
     {
@@ -1330,11 +1283,26 @@ namespace cryptonote
     }
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const crypto::hash& top_block_id)
+  bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const crypto::hash& top_block_id, const std::vector<crypto::key_image> &spent_key_images)
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     m_input_cache.clear();
     m_parsed_tx_cache.clear();
+
+    // a longer chain only unlocks more outputs, so only the txes double
+    // spending this block can stop being ready
+    for (const crypto::key_image &k_image: spent_key_images)
+    {
+      const key_images_container::const_iterator it = m_spent_key_images.find(k_image);
+      if (it == m_spent_key_images.end())
+        continue;
+      for (const crypto::hash &txid: it->second)
+      {
+        auto ready_it = m_ready_txs.find(txid);
+        if (ready_it != m_ready_txs.end())
+          ready_it->second.ready = false;
+      }
+    }
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -1343,14 +1311,16 @@ namespace cryptonote
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     m_input_cache.clear();
     m_parsed_tx_cache.clear();
+    for (auto &e: m_ready_txs)
+      e.second.ready = false;
     return true;
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::have_tx(const crypto::hash &id, relay_category tx_category) const
   {
-    CRITICAL_REGION_LOCAL(m_transactions_lock);
-    CRITICAL_REGION_LOCAL1(m_blockchain);
-    return m_blockchain.get_db().txpool_has_tx(id, tx_category);
+    BlockchainDB &db = m_blockchain.get_db();
+    db_rtxn_guard snapshot(&db);
+    return db.txpool_has_tx(id, tx_category);
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::have_tx_keyimges_as_spent(const transaction& tx, const crypto::hash& txid) const
@@ -1517,6 +1487,8 @@ namespace cryptonote
             try
             {
               m_blockchain.update_txpool_tx(txid, meta);
+              m_ready_txs.erase(txid);
+              update_tx_stats(txid, meta);
             }
             catch (const std::exception &e)
             {
@@ -1589,35 +1561,52 @@ namespace cryptonote
 
     LOG_PRINT_L2("Filling block template, median weight " << median_weight << ", " << m_txs_by_fee_and_receive_time.size() << " txes in the pool");
 
-    LockedTXN lock(m_blockchain.get_db());
+    const uint64_t top_block_height = m_blockchain.get_current_blockchain_height() - 1;
+    const crypto::hash top_block_hash = m_blockchain.get_block_id_by_height(top_block_height);
+
+    // only opened if a tx needs checking, txes already known to be ready are not read at all
+    std::unique_ptr<LockedTXN> lock;
 
     auto sorted_it = m_txs_by_fee_and_receive_time.begin();
     for (; sorted_it != m_txs_by_fee_and_receive_time.end(); ++sorted_it)
     {
-      txpool_tx_meta_t meta;
-      if (!m_blockchain.get_txpool_tx_meta(sorted_it->get_right(), meta))
+      const crypto::hash &txid = sorted_it->get_right();
+      if (m_unverified_txs.count(txid))
       {
-        static bool warned = false;
-        if (!warned)
-          MERROR("  failed to find tx meta: " << sorted_it->get_right() << " (will only print once)");
-        warned = true;
+        LOG_PRINT_L2("  " << txid << " not re-validated yet");
         continue;
       }
-      LOG_PRINT_L2("Considering " << sorted_it->get_right() << ", weight " << meta.weight << ", current block weight " << total_weight << "/" << max_total_weight << ", current coinbase " << print_money(best_coinbase) << ", relay method " << (unsigned)meta.get_relay_method());
-
-      if (!meta.matches(relay_category::legacy) && !(m_mine_stem_txes && meta.get_relay_method() == relay_method::stem))
+      auto ready_it = m_ready_txs.find(txid);
+      if (ready_it == m_ready_txs.end())
       {
-        LOG_PRINT_L2("  tx relay method is " << (unsigned)meta.get_relay_method());
-        continue;
+        txpool_tx_meta_t meta;
+        if (!m_blockchain.get_txpool_tx_meta(txid, meta))
+        {
+          static bool warned = false;
+          if (!warned)
+            MERROR("  failed to find tx meta: " << txid << " (will only print once)");
+          warned = true;
+          continue;
+        }
+        ready_tx_info info{};
+        info.weight = meta.weight;
+        info.fee = meta.fee;
+        info.minable = !meta.pruned && (meta.matches(relay_category::legacy) || (m_mine_stem_txes && meta.get_relay_method() == relay_method::stem));
+        info.ready = false;
+        info.failed_top_block_id = crypto::null_hash;
+        ready_it = m_ready_txs.emplace(txid, std::move(info)).first;
       }
-      if (meta.pruned)
+      ready_tx_info &info = ready_it->second;
+      LOG_PRINT_L2("Considering " << txid << ", weight " << info.weight << ", current block weight " << total_weight << "/" << max_total_weight << ", current coinbase " << print_money(best_coinbase));
+
+      if (!info.minable)
       {
-        LOG_PRINT_L2("  tx is pruned");
+        LOG_PRINT_L2("  tx is pruned or its relay method does not allow mining it");
         continue;
       }
 
       // Can not exceed maximum block weight
-      if (max_total_weight < total_weight + meta.weight)
+      if (max_total_weight < total_weight + info.weight)
       {
         LOG_PRINT_L2("  would exceed maximum block weight");
         continue;
@@ -1629,12 +1618,12 @@ namespace cryptonote
         // If we're getting lower coinbase tx,
         // stop including more tx
         uint64_t block_reward;
-        if(!get_block_reward(median_weight, total_weight + meta.weight, already_generated_coins, block_reward, version))
+        if(!get_block_reward(median_weight, total_weight + info.weight, already_generated_coins, block_reward, version))
         {
           LOG_PRINT_L2("  would exceed maximum block weight");
           continue;
         }
-        coinbase = block_reward + fee + meta.fee;
+        coinbase = block_reward + fee + info.fee;
         if (coinbase < template_accept_threshold(best_coinbase))
         {
           LOG_PRINT_L2("  would decrease coinbase to " << print_money(coinbase));
@@ -1652,56 +1641,86 @@ namespace cryptonote
         }
       }
 
-      // "local" and "stem" txes are filtered above
-      cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(sorted_it->get_right(), relay_category::all);
+      if (!info.ready)
+      {
+        if (info.failed_top_block_id == top_block_hash)
+        {
+          LOG_PRINT_L2("  not ready to go");
+          continue;
+        }
 
-      cryptonote::transaction tx;
+        if (!lock)
+          lock.reset(new LockedTXN(m_blockchain.get_db()));
 
-      // Skip transactions that are not ready to be
-      // included into the blockchain or that are
-      // missing key images
-      const cryptonote::txpool_tx_meta_t original_meta = meta;
-      bool ready = false;
-      try
-      {
-        ready = is_transaction_ready_to_go(meta, sorted_it->get_right(), txblob, tx);
-      }
-      catch (const std::exception &e)
-      {
-        MERROR("Failed to check transaction readiness: " << e.what());
-        // continue, not fatal
-      }
-      if (memcmp(&original_meta, &meta, sizeof(meta)))
-      {
+        txpool_tx_meta_t meta;
+        if (!m_blockchain.get_txpool_tx_meta(txid, meta))
+        {
+          MERROR("  failed to find tx meta: " << txid);
+          continue;
+        }
+
+        // "local" and "stem" txes are filtered above
+        cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(txid, relay_category::all);
+
+        cryptonote::transaction tx;
+
+        // Skip transactions that are not ready to be
+        // included into the blockchain or that are
+        // missing key images
+        const cryptonote::txpool_tx_meta_t original_meta = meta;
+        bool ready = false;
         try
-	{
-	  m_blockchain.update_txpool_tx(sorted_it->get_right(), meta);
-	}
+        {
+          ready = is_transaction_ready_to_go(meta, txid, txblob, tx);
+        }
         catch (const std::exception &e)
-	{
-	  MERROR("Failed to update tx meta: " << e.what());
-	  // continue, not fatal
-	}
-      }
-      if (!ready)
-      {
-        LOG_PRINT_L2("  not ready to go");
-        continue;
+        {
+          MERROR("Failed to check transaction readiness: " << e.what());
+          // continue, not fatal
+        }
+        if (memcmp(&original_meta, &meta, sizeof(meta)))
+        {
+          try
+          {
+            m_blockchain.update_txpool_tx(txid, meta);
+            if (original_meta.last_failed_height != meta.last_failed_height)
+              update_tx_stats(txid, meta);
+          }
+          catch (const std::exception &e)
+          {
+            MERROR("Failed to update tx meta: " << e.what());
+            // continue, not fatal
+          }
+        }
+        if (!ready)
+        {
+          info.failed_top_block_id = top_block_hash;
+          LOG_PRINT_L2("  not ready to go");
+          continue;
+        }
+
+        info.key_images.clear();
+        for (const txin_v &in: tx.vin)
+          if (in.type() == typeid(txin_to_key))
+            info.key_images.push_back(boost::get<txin_to_key>(in).k_image);
+        info.ready = true;
       }
-      if (have_key_images(k_images, tx))
+
+      if (std::any_of(info.key_images.begin(), info.key_images.end(), [&k_images](const crypto::key_image &k_image) { return k_images.count(k_image) != 0; }))
       {
         LOG_PRINT_L2("  key images already seen");
         continue;
       }
 
-      bl.tx_hashes.push_back(sorted_it->get_right());
-      total_weight += meta.weight;
-      fee += meta.fee;
+      bl.tx_hashes.push_back(txid);
+      total_weight += info.weight;
+      fee += info.fee;
       best_coinbase = coinbase;
-      append_key_images(k_images, tx);
+      k_images.insert(info.key_images.begin(), info.key_images.end());
       LOG_PRINT_L2("  added, new block weight " << total_weight << "/" << max_total_weight << ", coinbase " << print_money(best_coinbase));
     }
-    lock.commit();
+    if (lock)
+      lock->commit();
 
     expected_reward = best_coinbase;
     LOG_PRINT_L2("Block template filled with " << bl.tx_hashes.size() << " txes, weight "
@@ -1715,73 +1734,228 @@ namespace cryptonote
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     CRITICAL_REGION_LOCAL1(m_blockchain);
 
-    // Simply throw away incremental info, too difficult to update
-    m_added_txs_by_id.clear();
-    m_added_txs_start_time = (time_t)0;
-    m_removed_txs_by_time.clear();
-    m_removed_txs_start_time = (time_t)0;
-
-    MINFO("Validating txpool contents for v" << (unsigned)version);
+    MINFO("Queueing txpool contents for re-validation for v" << (unsigned)version);
 
-    LockedTXN lock(m_blockchain.get_db());
+    // the rules changed, nothing is known to be ready anymore
+    m_ready_txs.clear();
 
-    struct tx_entry_t
+    // pruned txes can't be re-validated, they are left alone
+    size_t queued = 0;
+    m_blockchain.for_all_txpool_txes([this, &queued](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref*) {
+      if (!meta.pruned && m_unverified_txs.insert(txid).second)
+        ++queued;
+      return true;
+    }, false, relay_category::all);
+    m_revalidation_total += queued;
+    if (queued)
+      ++m_cookie; // the queued txes are not mined until re-validated
+    return queued;
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::revalidate_unverified_transactions()
+  {
+    const auto deadline = std::chrono::steady_clock::now() + revalidation_budget;
+    do
+    {
+      if (!revalidate_unverified_batch(revalidation_batch_size))
+        break;
+    } while (std::chrono::steady_clock::now() < deadline);
+  }
+  //---------------------------------------------------------------------------------
+  bool tx_memory_pool::revalidate_unverified_batch(size_t max_txes)
+  {
+    struct unverified_tx
     {
       crypto::hash txid;
       txpool_tx_meta_t meta;
+      cryptonote::blobdata blob;
+      transaction tx;
+      bool good = false;
     };
+    std::vector<unverified_tx> txes;
 
-    // get all txids
-    std::vector<tx_entry_t> txes;
-    m_blockchain.for_all_txpool_txes([&txes](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref*) {
-      if (!meta.pruned) // skip pruned txes
-        txes.push_back({txid, meta});
-      return true;
-    }, false, relay_category::all);
+    // pick a batch and read it, the checks themselves run without the pool lock
+    {
+      CRITICAL_REGION_LOCAL(m_transactions_lock);
+      if (m_unverified_txs.empty())
+        return false;
+      BlockchainDB &db = m_blockchain.get_db();
+      db_rtxn_guard snapshot(&db);
+      for (auto it = m_unverified_txs.begin(); it != m_unverified_txs.end() && txes.size() < max_txes; )
+      {
+        unverified_tx e;
+        e.txid = *it;
+        if (!db.get_txpool_tx_meta(e.txid, e.meta) || !db.get_txpool_tx_blob(e.txid, e.blob, relay_category::all))
+        {
+          it = m_unverified_txs.erase(it); // gone from the pool since
+          ++m_revalidation_done;
+          continue;
+        }
+        txes.push_back(std::move(e));
+        ++it;
+      }
+    }
+
+    const uint8_t version = m_blockchain.get_current_hard_fork_version();
+    tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+    {
+      tools::threadpool::waiter waiter(tpool);
+      for (unverified_tx &e: txes)
+      {
+        tpool.submit(&waiter, [&e, version]() {
+          if (!parse_and_validate_tx_from_blob(e.blob, e.tx))
+            return;
+          e.tx.set_hash(e.txid);
+          tx_verification_context tvc{};
+          e.good = cryptonote::ver_non_input_consensus(e.tx, tvc, version);
+        }, true);
+      }
+      if (!waiter.wait())
+        return false;
+    }
+
+    // the fee rules may have changed too
+    for (unverified_tx &e: txes)
+      if (e.good && !e.meta.kept_by_block && !m_blockchain.check_fee(e.meta.weight, e.meta.fee))
+        e.good = false;
 
-    // take them all out and add them back in, some might fail
-    size_t added = 0;
-    for (auto &e: txes)
+    // same as Blockchain::check_tx_inputs, with the input proofs of the batch verified together
+    std::vector<transaction*> ptxs;
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < txes.size(); ++i)
+    {
+      if (!txes[i].good)
+        continue;
+      ptxs.push_back(&txes[i].tx);
+      indices.push_back(i);
+    }
+    std::vector<rct::ctkeyM> mix_rings;
+    m_blockchain.get_tx_input_rings(ptxs, mix_rings);
+    std::vector<std::pair<transaction*, const rct::ctkeyM*>> txs_and_mix_rings;
+    std::vector<size_t> batch_indices;
+    for (size_t n = 0; n < ptxs.size(); ++n)
     {
+      if (mix_rings[n].empty())
+      {
+        // txes from popped blocks may become valid again, as add_tx would do
+        txes[indices[n]].good = txes[indices[n]].meta.kept_by_block;
+        continue;
+      }
+      txs_and_mix_rings.emplace_back(ptxs[n], &mix_rings[n]);
+      batch_indices.push_back(n);
+    }
+    std::vector<bool> verified;
+    ver_input_proofs_rings(txs_and_mix_rings, verified);
+    for (size_t b = 0; b < batch_indices.size(); ++b)
+    {
+      const size_t n = batch_indices[b];
+      unverified_tx &e = txes[indices[n]];
+      e.good = verified[b] || e.meta.kept_by_block;
+      e.meta.valid_input_verification_id = verified[b] ? make_input_verification_id(e.txid, mix_rings[n]) : crypto::null_hash;
+    }
+
+    // now commit the results, for the txes which are still waiting for them
+    size_t dropped = 0;
+    CRITICAL_REGION_LOCAL(m_transactions_lock);
+    CRITICAL_REGION_LOCAL1(m_blockchain);
+    for (unverified_tx &e: txes)
+    {
+      if (m_unverified_txs.erase(e.txid) == 0)
+        continue;
+      ++m_revalidation_done;
       try
       {
-        size_t weight;
-        uint64_t fee;
-        cryptonote::transaction tx;
-        cryptonote::blobdata blob;
-        bool relayed, do_not_relay, double_spend_seen, pruned;
-        crypto::hash valid_input_verification_id;
-        if (!take_tx(e.txid, tx, blob, weight, fee, valid_input_verification_id, relayed, do_not_relay, double_spend_seen, pruned))
-          MERROR("Failed to get tx " << e.txid << " from txpool for re-validation");
-
-        cryptonote::tx_verification_context tvc{};
-        relay_method tx_relay = e.meta.get_relay_method();
-        if (!add_tx(tx, e.txid, blob, e.meta.weight, tvc, tx_relay, relayed, version,
-          /*nic_verified_hf_version=*/0, valid_input_verification_id))
+        if (!e.good)
         {
           MINFO("Failed to re-validate tx " << e.txid << " for v" << (unsigned)version << ", dropped");
+          size_t weight;
+          uint64_t fee;
+          crypto::hash valid_input_verification_id;
+          bool relayed, do_not_relay, double_spend_seen, pruned;
+          if (take_tx(e.txid, e.tx, e.blob, weight, fee, valid_input_verification_id, relayed, do_not_relay, double_spend_seen, pruned))
+            ++dropped;
           continue;
         }
-        m_blockchain.update_txpool_tx(e.txid, e.meta);
-        ++added;
+        txpool_tx_meta_t meta;
+        if (m_blockchain.get_txpool_tx_meta(e.txid, meta) && meta.valid_input_verification_id != e.meta.valid_input_verification_id)
+        {
+          LockedTXN lock(m_blockchain.get_db());
+          meta.valid_input_verification_id = e.meta.valid_input_verification_id;
+          m_blockchain.update_txpool_tx(e.txid, meta);
+          lock.commit();
+          m_ready_txs.erase(e.txid);
+        }
       }
-      catch (const std::exception &e)
+      catch (const std::exception &ex)
       {
-        MERROR("Failed to re-validate tx from pool");
-        continue;
+        MERROR("Failed to re-validate tx " << e.txid << " from pool: " << ex.what());
       }
     }
+    m_revalidation_dropped += dropped;
+    ++m_cookie; // the txes kept may be mined now
 
-    lock.commit();
+    MINFO("Re-validated " << m_revalidation_done << "/" << m_revalidation_total << " txpool transactions");
+    if (m_unverified_txs.empty())
+    {
+      MGINFO("Txpool re-validation done: " << m_revalidation_done << " transactions checked, " << m_revalidation_dropped << " dropped");
+      m_revalidation_total = m_revalidation_done = m_revalidation_dropped = 0;
+    }
+    return !m_unverified_txs.empty();
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::update_tx_stats(const crypto::hash &txid, const txpool_tx_meta_t &meta)
+  {
+    const tx_stats_entry entry{meta.weight, meta.fee, meta.receive_time, !!meta.relayed,
+      meta.last_failed_height != 0, !!meta.double_spend_seen, !meta.matches(relay_category::broadcasted)};
 
-    const size_t n_removed = txes.size() - added;
-    if (n_removed > 0)
-      ++m_cookie;
-    return n_removed;
+    CRITICAL_REGION_LOCAL(m_stats_lock);
+    const auto it = m_tx_stats_index.find(txid);
+    if (it != m_tx_stats_index.end())
+    {
+      tx_stats_entry &old_entry = m_tx_stats[it->second];
+      m_all_stats.remove(old_entry);
+      if (!old_entry.sensitive)
+        m_broadcasted_stats.remove(old_entry);
+      old_entry = entry;
+    }
+    else
+    {
+      m_tx_stats_index.emplace(txid, m_tx_stats.size());
+      m_tx_stats_ids.push_back(txid);
+      m_tx_stats.push_back(entry);
+    }
+    m_all_stats.add(entry);
+    if (!entry.sensitive)
+      m_broadcasted_stats.add(entry);
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::remove_tx_stats(const crypto::hash &txid)
+  {
+    CRITICAL_REGION_LOCAL(m_stats_lock);
+    const auto it = m_tx_stats_index.find(txid);
+    if (it == m_tx_stats_index.end())
+      return;
+    const size_t idx = it->second;
+    m_all_stats.remove(m_tx_stats[idx]);
+    if (!m_tx_stats[idx].sensitive)
+      m_broadcasted_stats.remove(m_tx_stats[idx]);
+    m_tx_stats_index.erase(it);
+
+    // move the last entry into the hole
+    if (idx != m_tx_stats.size() - 1)
+    {
+      m_tx_stats[idx] = m_tx_stats.back();
+      m_tx_stats_ids[idx] = m_tx_stats_ids.back();
+      m_tx_stats_index[m_tx_stats_ids[idx]] = idx;
+    }
+    m_tx_stats.pop_back();
+    m_tx_stats_ids.pop_back();
   }
   //---------------------------------------------------------------------------------
   void tx_memory_pool::add_tx_to_transient_lists(const crypto::hash& txid, double fee, time_t receive_time)
   {
+    // the tx's meta was (re)written, fill_block_template will pick it up again
+    m_ready_txs.erase(txid);
 
     time_t now = time(NULL);
     const std::unordered_map<crypto::hash, time_t>::iterator it = m_added_txs_by_id.find(txid);
@@ -1833,6 +2007,10 @@ namespace cryptonote
     {
       m_txs_by_fee_and_receive_time.erase(sorted_it);
     }
+    m_ready_txs.erase(txid);
+    if (m_unverified_txs.erase(txid))
+      ++m_revalidation_done;
+    remove_tx_stats(txid);
 
     const std::unordered_map<crypto::hash, time_t>::iterator it = m_added_txs_by_id.find(txid);
     if (it != m_added_txs_by_id.end())
@@ -1891,12 +2069,23 @@ namespace cryptonote
 
     m_txpool_max_weight = max_txpool_weight ? max_txpool_weight : DEFAULT_TXPOOL_MAX_WEIGHT;
     m_txs_by_fee_and_receive_time.clear();
+    m_ready_txs.clear();
     m_added_txs_by_id.clear();
     m_added_txs_start_time = (time_t)0;
     m_removed_txs_by_time.clear();
     m_removed_txs_start_time = (time_t)0;
     m_spent_key_images.clear();
+    m_unverified_txs.clear();
+    m_revalidation_total = m_revalidation_done = m_revalidation_dropped = 0;
     m_txpool_weight = 0;
+    {
+      CRITICAL_REGION_LOCAL(m_stats_lock);
+      m_tx_stats_index.clear();
+      m_tx_stats_ids.clear();
+      m_tx_stats.clear();
+      m_broadcasted_stats = tx_stats_totals();
+      m_all_stats = tx_stats_totals();
+    }
     std::vector<crypto::hash> remove;
 
     // first add the not kept by block, then the kept by block,
@@ -1920,7 +2109,11 @@ namespace cryptonote
           return false;
         }
         add_tx_to_transient_lists(txid, meta.fee / (double)meta.weight, meta.receive_time);
+        update_tx_stats(txid, meta);
         m_txpool_weight += meta.weight;
+        // the chain may have changed since, these get checked again in the background
+        if (!meta.pruned)
+          m_unverified_txs.insert(txid);
         return true;
       }, true, relay_category::all);
       if (!r)
@@ -1947,6 +2140,10 @@ namespace cryptonote
     m_mine_stem_txes = mine_stem_txes;
     m_cookie = 0;
 
+    m_revalidation_total = m_unverified_txs.size();
+    if (!m_unverified_txs.empty())
+      MGINFO(m_unverified_txs.size() << " txpool transactions will be re-validated in the background");
+
     // Ignore deserialization error
     return true;
   }
@@ -32,6 +32,7 @@
 #include "include_base_utils.h"
 
 #include <atomic>
+#include <map>
 #include <set>
 #include <tuple>
 #include <unordered_map>
@@ -53,6 +54,7 @@
 #include "crypto/hash.h"
 #include "rpc/core_rpc_server_commands_defs.h"
 #include "rpc/message_data_structs.h"
+#include "tx_pool_stats.h"
 
 namespace cryptonote
 {
@@ -192,19 +194,21 @@ namespace cryptonote
     /**
      * @brief action to take when notified of a block added to the blockchain
      *
-     * Currently does nothing
+     * Txes ready to be mined stay ready on top of the new block, unless the block
+     * spends one of their key images.
      *
      * @param new_block_height the height of the blockchain after the change
      * @param top_block_id the hash of the new top block
+     * @param spent_key_images the key images spent by the new block's txes
      *
      * @return true
      */
-    bool on_blockchain_inc(uint64_t new_block_height, const crypto::hash& top_block_id);
+    bool on_blockchain_inc(uint64_t new_block_height, const crypto::hash& top_block_id, const std::vector<crypto::key_image> &spent_key_images);
 
     /**
      * @brief action to take when notified of a block removed from the blockchain
      *
-     * Currently does nothing
+     * Every tx has to be checked again before it can be mined.
      *
      * @param new_block_height the height of the blockchain after the change
      * @param top_block_id the hash of the new top block
@@ -216,7 +220,8 @@ namespace cryptonote
     /**
      * @brief action to take periodically
      *
-     * Currently checks transaction pool for stale ("stuck") transactions
+     * Checks transaction pool for stale ("stuck") transactions, and
+     * re-validates some of the txes waiting for it
      */
     void on_idle();
 
@@ -289,12 +294,21 @@ namespace cryptonote
     /**
      * @brief get (weight, fee, receive time) for all transaction in the pool
      *
-     * @param txs return-by-reference that data
+     * @param backlog return-by-reference that data
      * @param include_sensitive return stempool, anonymity-pool, and unrelayed txes
      *
      */
     void get_transaction_backlog(std::vector<tx_backlog_entry>& backlog, bool include_sensitive = false) const;
 
+    /**
+     * @brief get (weight, fee, time in pool) summed per fee per byte bucket
+     *
+     * @param backlog return-by-reference one entry per bucket, see tx_stats_totals::get_fee_buckets
+     * @param include_sensitive return stempool, anonymity-pool, and unrelayed txes
+     *
+     */
+    void get_transaction_backlog_by_fee(std::vector<tx_backlog_entry>& backlog, bool include_sensitive = false) const;
+
     /**
      * @brief get (hash, weight, fee) for transactions in the pool - the minimum required information to create a block template
      *
@@ -409,15 +423,17 @@ namespace cryptonote
     std::string print_pool(bool short_format) const;
 
     /**
-     * @brief remove transactions from the pool which are no longer valid
+     * @brief queue the pool's transactions for re-validation
      *
      * With new versions of the currency, what conditions render a transaction
-     * invalid may change.  This function clears those which were received
-     * before a version change and no longer conform to requirements.
+     * invalid may change.  This function marks every transaction unverified;
+     * they are then checked in the background from on_idle, and the ones which
+     * no longer conform to requirements are removed. Unverified transactions
+     * are neither mined nor relayed.
      *
      * @param version the version the transactions must conform to
      *
-     * @return the number of transactions removed
+     * @return the number of transactions queued
      */
     size_t validate(uint8_t version);
 
@@ -503,6 +519,9 @@ namespace cryptonote
 
     /**
      * @brief get transactions not in the passed set
+     *
+     * Transactions not re-validated yet are left out, they are not handed
+     * to peers until they are.
      */
     bool get_complement(const std::vector<crypto::hash> &hashes, std::vector<cryptonote::blobdata> &txes) const;
 
@@ -540,6 +559,27 @@ namespace cryptonote
      */
     bool remove_stuck_transactions();
 
+    /**
+     * @brief re-validate unverified transactions for a limited time
+     *
+     * Runs batches of revalidate_unverified_batch() until the time budget for
+     * one idle call is spent, which caps the cpu share it takes.
+     */
+    void revalidate_unverified_transactions();
+
+    /**
+     * @brief re-validate a batch of unverified transactions
+     *
+     * The batch is checked like add_tx would, but without the pool lock, with
+     * the semantics and input proofs checks run in parallel. Transactions
+     * which fail are removed from the pool.
+     *
+     * @param max_txes the maximum number of transactions to check
+     *
+     * @return true if more transactions are waiting to be checked
+     */
+    bool revalidate_unverified_batch(size_t max_txes);
+
     /**
      * @brief check if a transaction in the pool has a given spent key image
      *
@@ -624,6 +664,21 @@ namespace cryptonote
      */
     void prune(size_t bytes = 0);
 
+    /**
+     * @brief record a transaction's meta in the pool stats, or refresh it
+     *
+     * @param txid the transaction's hash
+     * @param meta the transaction's meta, as just written to the db
+     */
+    void update_tx_stats(const crypto::hash &txid, const txpool_tx_meta_t &meta);
+
+    /**
+     * @brief drop a transaction from the pool stats, if it is there
+     *
+     * @param txid the transaction's hash
+     */
+    void remove_tx_stats(const crypto::hash &txid);
+
     void add_tx_to_transient_lists(const crypto::hash& txid, double fee, time_t receive_time);
     void remove_tx_from_transient_lists(const cryptonote::sorted_tx_container::iterator& sorted_it, const crypto::hash& txid, bool sensitive);
     void track_removed_tx(const crypto::hash& txid, bool sensitive);
@@ -642,7 +697,11 @@ namespace cryptonote
 #if defined(DEBUG_CREATE_BLOCK_TEMPLATE)
 public:
 #endif
-    mutable epee::critical_section m_transactions_lock;  //!< lock for the pool
+    //! lock for the pool's in memory state and for changes to its db tables
+    /*! Readers which only need the txpool tables read them from a db
+     *  snapshot instead, so they neither wait for nor hold up writers.
+     */
+    mutable epee::critical_section m_transactions_lock;
 #if defined(DEBUG_CREATE_BLOCK_TEMPLATE)
 private:
 #endif
@@ -689,6 +748,14 @@ private:
      */
     sorted_tx_container::iterator find_tx_in_sorted_container(const crypto::hash& id);
 
+    /**
+     * @brief adds a transaction's key images to a key image map
+     *
+     * Used to rebuild the key images of the txes read from a db snapshot,
+     * where m_spent_key_images cannot be used without the pool lock.
+     */
+    static void add_key_images(const transaction_prefix &tx, const crypto::hash &txid, key_images_container &key_images);
+
     //! cache/call Blockchain::check_tx_inputs results
     bool check_tx_inputs(const std::function<cryptonote::transaction&(void)> &get_tx,
       const crypto::hash &txid,
@@ -712,8 +779,42 @@ private:
 
     mutable std::unordered_map<crypto::hash, std::tuple<bool, tx_verification_context, uint64_t, crypto::hash>> m_input_cache;
 
+    //! what fill_block_template needs to know about a tx, without reading it from the db
+    struct ready_tx_info
+    {
+      uint64_t weight;
+      uint64_t fee;
+      bool minable; //!< relay method allows mining it, and it is not pruned
+      bool ready; //!< inputs are good on top of the current chain
+      crypto::hash failed_top_block_id; //!< top block the inputs last failed against
+      std::vector<crypto::key_image> key_images; //!< set once ready
+    };
+
+    //! txes considered by fill_block_template since they entered the pool or last changed
+    /*! Entries are dropped whenever the tx's meta is rewritten, except by
+     *  fill_block_template itself which updates the entry along with the meta.
+     *  Readiness is only reset for the txes a new block conflicts with, or for
+     *  all on a pop.
+     */
+    std::unordered_map<crypto::hash, ready_tx_info> m_ready_txs;
+
+    //! txes loaded from the db or queued by validate() which were not checked yet
+    std::unordered_set<crypto::hash> m_unverified_txs;
+    size_t m_revalidation_total; //!< txes queued for re-validation, for progress reports
+    size_t m_revalidation_done; //!< of which re-validated or gone
+    size_t m_revalidation_dropped; //!< of which dropped as invalid
+
     std::unordered_map<crypto::hash, transaction> m_parsed_tx_cache;
 
+    //! lock for the stats below, so their readers do not need the pool lock
+    mutable epee::critical_section m_stats_lock;
+    //! per tx entries are kept contiguous, so the backlog is copied out in one go
+    std::unordered_map<crypto::hash, size_t> m_tx_stats_index;
+    std::vector<crypto::hash> m_tx_stats_ids;
+    std::vector<tx_stats_entry> m_tx_stats;
+    tx_stats_totals m_broadcasted_stats; //!< broadcasted txes only
+    tx_stats_totals m_all_stats; //!< including stempool, anonymity-pool and unrelayed txes
+
     //! Next timestamp that a DB check for relayable txes is allowed
     std::atomic<time_t> m_next_check;
 
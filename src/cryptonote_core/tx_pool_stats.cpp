@@ -0,0 +1,230 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "misc_language.h"
+#include "tx_pool_stats.h"
+
+namespace cryptonote
+{
+
+tx_stats_totals::tx_stats_totals():
+  m_txs(0), m_bytes(0), m_fee(0), m_not_relayed(0), m_failing(0), m_double_spends(0)
+{
+}
+
+int tx_stats_totals::fee_bucket(uint64_t fee, uint64_t weight)
+{
+  if (fee == 0 || weight == 0)
+    return std::numeric_limits<int>::min();
+  return static_cast<int>(std::floor(std::log2(fee / (double)weight) * FEE_BUCKETS_PER_DOUBLING));
+}
+
+void tx_stats_totals::add(const tx_stats_entry &e)
+{
+  ++m_txs;
+  m_bytes += e.weight;
+  m_fee += e.fee;
+  m_not_relayed += !e.relayed;
+  m_failing += e.failing;
+  m_double_spends += e.double_spend_seen;
+
+  if (m_weights_low.empty() || e.weight <= *m_weights_low.rbegin())
+    m_weights_low.insert(e.weight);
+  else
+    m_weights_high.insert(e.weight);
+  balance_weights();
+
+  m_receive_times.insert(e.receive_time);
+  txpool_histo &histo = m_by_receive_minute[e.receive_time / AGE_BUCKET_SECONDS];
+  ++histo.txs;
+  histo.bytes += e.weight;
+
+  fee_bucket_totals &bucket = m_by_fee_bucket.emplace(fee_bucket(e.fee, e.weight), fee_bucket_totals{}).first->second;
+  ++bucket.txs;
+  bucket.weight += e.weight;
+  bucket.fee += e.fee;
+  bucket.receive_time_sum += e.receive_time;
+}
+
+void tx_stats_totals::remove(const tx_stats_entry &e)
+{
+  --m_txs;
+  m_bytes -= e.weight;
+  m_fee -= e.fee;
+  m_not_relayed -= !e.relayed;
+  m_failing -= e.failing;
+  m_double_spends -= e.double_spend_seen;
+
+  // every weight in the lower half is <= every weight in the upper half
+  std::multiset<uint64_t> &weights = !m_weights_low.empty() && e.weight <= *m_weights_low.rbegin() ? m_weights_low : m_weights_high;
+  const auto wit = weights.find(e.weight);
+  if (wit != weights.end())
+    weights.erase(wit);
+  balance_weights();
+
+  const auto rit = m_receive_times.find(e.receive_time);
+  if (rit != m_receive_times.end())
+    m_receive_times.erase(rit);
+
+  const auto hit = m_by_receive_minute.find(e.receive_time / AGE_BUCKET_SECONDS);
+  if (hit != m_by_receive_minute.end())
+  {
+    if (--hit->second.txs == 0)
+      m_by_receive_minute.erase(hit);
+    else
+      hit->second.bytes -= e.weight;
+  }
+
+  const auto fit = m_by_fee_bucket.find(fee_bucket(e.fee, e.weight));
+  if (fit != m_by_fee_bucket.end())
+  {
+    if (--fit->second.txs == 0)
+    {
+      m_by_fee_bucket.erase(fit);
+    }
+    else
+    {
+      fit->second.weight -= e.weight;
+      fit->second.fee -= e.fee;
+      fit->second.receive_time_sum -= e.receive_time;
+    }
+  }
+}
+
+void tx_stats_totals::balance_weights()
+{
+  if (m_weights_low.size() > m_weights_high.size() + 1)
+  {
+    const auto it = std::prev(m_weights_low.end());
+    m_weights_high.insert(*it);
+    m_weights_low.erase(it);
+  }
+  else if (m_weights_high.size() > m_weights_low.size())
+  {
+    const auto it = m_weights_high.begin();
+    m_weights_low.insert(*it);
+    m_weights_high.erase(it);
+  }
+}
+
+void tx_stats_totals::get_stats(txpool_stats &stats, uint64_t now) const
+{
+  stats.txs_total = m_txs;
+  stats.bytes_total = m_bytes;
+  stats.fee_total = m_fee;
+  stats.num_not_relayed = m_not_relayed;
+  stats.num_failing = m_failing;
+  stats.num_double_spends = m_double_spends;
+  if (!m_weights_low.empty())
+  {
+    stats.bytes_min = *m_weights_low.begin();
+    stats.bytes_max = m_weights_high.empty() ? *m_weights_low.rbegin() : *m_weights_high.rbegin();
+    if (m_weights_low.size() > m_weights_high.size())
+      stats.bytes_med = *m_weights_low.rbegin();
+    else
+      stats.bytes_med = epee::misc_utils::get_mid(*m_weights_low.rbegin(), *m_weights_high.begin());
+  }
+  if (m_receive_times.empty())
+    return;
+  stats.oldest = *m_receive_times.begin();
+
+  // a bucket's txes are taken to be as old as its start, or as the oldest tx if that is later
+  std::map<uint64_t, txpool_histo> agebytes;
+  for (const auto &e: m_by_receive_minute)
+  {
+    const uint64_t start = std::max(e.first * AGE_BUCKET_SECONDS, stats.oldest);
+    if (start + 600 < now)
+      stats.num_10m += e.second.txs;
+    const uint64_t age = now > start ? now - start : 1;
+    agebytes[age].txs += e.second.txs;
+    agebytes[age].bytes += e.second.bytes;
+  }
+
+  if (stats.txs_total > 1)
+  {
+    /* looking for 98th percentile */
+    size_t end = stats.txs_total * 0.02;
+    uint64_t delta, factor;
+    std::map<uint64_t, txpool_histo>::iterator it, i2;
+    if (end)
+    {
+      /* If enough txs, spread the first 98% of results across
+       * the first 9 bins, drop final 2% in last bin.
+       */
+      it = agebytes.end();
+      size_t cumulative_num = 0;
+      /* Since agebytes is not empty and end is nonzero, the
+       * below loop can always run at least once.
+       */
+      do {
+        --it;
+        cumulative_num += it->second.txs;
+      } while (it != agebytes.begin() && cumulative_num < end);
+      stats.histo_98pc = it->first;
+      factor = 9;
+      delta = it->first;
+      stats.histo.resize(10);
+    } else
+    {
+      /* If not enough txs, don't reserve the last slot;
+       * spread evenly across all 10 bins.
+       */
+      stats.histo_98pc = 0;
+      it = agebytes.end();
+      factor = stats.txs_total > 9 ? 10 : stats.txs_total;
+      delta = now - stats.oldest;
+      stats.histo.resize(factor);
+    }
+    if (!delta)
+      delta = 1;
+    for (i2 = agebytes.begin(); i2 != it; i2++)
+    {
+      size_t i = (i2->first * factor - 1) / delta;
+      stats.histo[i].txs += i2->second.txs;
+      stats.histo[i].bytes += i2->second.bytes;
+    }
+    for (; i2 != agebytes.end(); i2++)
+    {
+      stats.histo[factor].txs += i2->second.txs;
+      stats.histo[factor].bytes += i2->second.bytes;
+    }
+  }
+}
+
+void tx_stats_totals::get_fee_buckets(std::vector<tx_backlog_entry> &backlog, uint64_t now) const
+{
+  backlog.reserve(backlog.size() + m_by_fee_bucket.size());
+  for (const auto &e: m_by_fee_bucket)
+    backlog.push_back({e.second.weight, e.second.fee, e.second.receive_time_sum / e.second.txs - now});
+}
+
+}  // namespace cryptonote
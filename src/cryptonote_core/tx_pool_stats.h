@@ -0,0 +1,123 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "rpc/core_rpc_server_commands_defs.h"
+
+namespace cryptonote
+{
+
+//! what the pool stats and backlog need to know about a tx
+struct tx_stats_entry
+{
+  uint64_t weight;
+  uint64_t fee;
+  uint64_t receive_time;
+  bool relayed;
+  bool failing;
+  bool double_spend_seen;
+  bool sensitive; //!< not broadcasted yet
+};
+
+/**
+ * @brief running totals over the txes of one relay category
+ *
+ * The weights are split in two halves so the median sits at their ends.
+ * Txes are also bucketed by receive minute, for the age histogram, and by
+ * fee per byte, for the fee estimates, so reads cost one step per bucket rather
+ * than one per tx. Ages are thus known to the minute, except for the oldest
+ * tx which is exact.
+ *
+ * Not thread safe, the pool guards it with its stats lock.
+ */
+class tx_stats_totals
+{
+public:
+  static constexpr uint64_t AGE_BUCKET_SECONDS = 60;
+  static constexpr int FEE_BUCKETS_PER_DOUBLING = 16;
+
+  tx_stats_totals();
+
+  void add(const tx_stats_entry &e);
+  void remove(const tx_stats_entry &e);
+
+  uint64_t txs() const { return m_txs; }
+
+  /**
+   * @brief fills the counters, weight range and median, and the age histogram
+   *
+   * @param stats return-by-reference the pool stats
+   * @param now the time ages are measured from
+   */
+  void get_stats(txpool_stats &stats, uint64_t now) const;
+
+  /**
+   * @brief fills one entry per fee per byte bucket
+   *
+   * Each entry holds the summed weight and fee of the bucket's txes, so its
+   * fee per byte is their weighted mean and within one bucket width of each
+   * of them, and the time in pool of their mean receive time.
+   *
+   * @param backlog return-by-reference the buckets, lowest fee per byte first
+   * @param now the time the time in pool is measured from
+   */
+  void get_fee_buckets(std::vector<tx_backlog_entry> &backlog, uint64_t now) const;
+
+  //! the fee per byte bucket of a tx, each one is a 1/FEE_BUCKETS_PER_DOUBLING power of two wide
+  static int fee_bucket(uint64_t fee, uint64_t weight);
+
+private:
+  struct fee_bucket_totals
+  {
+    uint64_t txs;
+    uint64_t weight;
+    uint64_t fee;
+    uint64_t receive_time_sum;
+  };
+
+  void balance_weights();
+
+  uint64_t m_txs;
+  uint64_t m_bytes;
+  uint64_t m_fee;
+  uint64_t m_not_relayed;
+  uint64_t m_failing;
+  uint64_t m_double_spends;
+  std::multiset<uint64_t> m_weights_low; //!< lower half, one larger than the upper half if odd
+  std::multiset<uint64_t> m_weights_high; //!< upper half
+  std::multiset<uint64_t> m_receive_times;
+  std::map<uint64_t, txpool_histo> m_by_receive_minute;
+  std::map<int, fee_bucket_totals> m_by_fee_bucket;
+};
+
+}  // namespace cryptonote
@@ -42,8 +42,8 @@
 
 using namespace cryptonote;
 
-// Do RCT expansion, then do post-expansion sanity checks, then do full non-semantics verification.
-static bool expand_tx_and_ver_rct_non_sem(transaction& tx, const rct::ctkeyM& mix_ring)
+// Do RCT expansion, then do post-expansion sanity checks, but leave the non-semantics verification to the caller.
+static bool expand_tx_for_rct_non_sem(transaction& tx, const rct::ctkeyM& mix_ring)
 {
     // Pruned transactions can not be expanded and verified because they are missing RCT data
     VER_ASSERT(!tx.pruned, "Pruned transaction will not pass verRctNonSemanticsSimple");
@@ -84,10 +84,38 @@ static bool expand_tx_and_ver_rct_non_sem(transaction& tx, const rct::ctkeyM& mi
     }
 
     // Mix ring data is now known to be correctly incorporated into the RCT sig inside tx.
-    VER_ASSERT(rct::verRctNonSemanticsSimple(rv), "Failed to verify simple RingCT signatures");
     return true;
 }
 
+// Do RCT expansion, then do post-expansion sanity checks, then do full non-semantics verification.
+static bool expand_tx_and_ver_rct_non_sem(transaction& tx, const rct::ctkeyM& mix_ring)
+{
+    if (!expand_tx_for_rct_non_sem(tx, mix_ring))
+        return false;
+
+    VER_ASSERT(rct::verRctNonSemanticsSimple(tx.rct_signatures), "Failed to verify simple RingCT signatures");
+    return true;
+}
+
+// Whether the input proofs of this tx can be verified alongside other txs' by verRctNonSemanticsSimple()
+static bool is_simple_rct_non_sem_batchable(const transaction& tx)
+{
+    if (tx.version != 2)
+        return false;
+
+    switch (tx.rct_signatures.type)
+    {
+    case rct::RCTTypeSimple:
+    case rct::RCTTypeBulletproof:
+    case rct::RCTTypeBulletproof2:
+    case rct::RCTTypeCLSAG:
+    case rct::RCTTypeBulletproofPlus:
+        return true;
+    default:
+        return false;
+    }
+}
+
 // Same as expand_tx_and_ver_rct_non_sem(), but for RingCT sigs of type RCTTypeFull only
 static bool expand_tx_and_ver_full_rct_non_sem(transaction& tx, const rct::ctkeyM& mix_ring)
 {
@@ -248,7 +276,8 @@ static bool is_canonical_bulletproof_plus_layout(const std::vector<rct::Bulletpr
 
 template <class TxForwardIt>
 static bool ver_non_input_consensus_templated(TxForwardIt tx_begin, TxForwardIt tx_end,
-        tx_verification_context& tvc, std::uint8_t hf_version)
+        tx_verification_context& tvc, std::uint8_t hf_version,
+        const std::unordered_set<crypto::hash>* rct_semantics_verified_txids = nullptr)
 {
     std::vector<const rct::rctSig*> rvv;
     rvv.reserve(static_cast<size_t>(std::distance(tx_begin, tx_end)));
@@ -294,9 +323,14 @@ static bool ver_non_input_consensus_templated(TxForwardIt tx_begin, TxForwardIt
         if (!Blockchain::check_tx_outputs(tx, tvc, hf_version) || tvc.m_verifivation_failed)
             return false;
 
-        // We only want to check RingCT semantics if this is actually a RingCT transaction
+        // We only want to check RingCT semantics if this is actually a RingCT transaction, and the
+        // caller has not already verified them as part of a larger batch
         if (tx.version >= 2)
+        {
+            if (rct_semantics_verified_txids && rct_semantics_verified_txids->count(get_transaction_hash(tx)))
+                continue;
             rvv.push_back(&tx.rct_signatures);
+        }
     }
 
     // Rule 7
@@ -371,6 +405,84 @@ bool ver_input_proofs_rings(transaction& tx, const rct::ctkeyM &dereferenced_mix
     }
 }
 
+bool ver_input_proofs_rings(const std::vector<std::pair<transaction*, const rct::ctkeyM*>> &txs_and_mix_rings,
+    size_t &failed_tx_index_out)
+{
+    std::vector<const rct::rctSig*> rvv;
+    std::vector<size_t> rvv_tx_indices;
+    rvv.reserve(txs_and_mix_rings.size());
+    rvv_tx_indices.reserve(txs_and_mix_rings.size());
+
+    // Expand all simple RingCT txs for the batch, and verify anything else on its own
+    for (size_t i = 0; i < txs_and_mix_rings.size(); ++i)
+    {
+        transaction& tx = *txs_and_mix_rings[i].first;
+        const rct::ctkeyM& mix_ring = *txs_and_mix_rings[i].second;
+
+        if (is_simple_rct_non_sem_batchable(tx))
+        {
+            if (!expand_tx_for_rct_non_sem(tx, mix_ring))
+            {
+                failed_tx_index_out = i;
+                return false;
+            }
+            rvv.push_back(&tx.rct_signatures);
+            rvv_tx_indices.push_back(i);
+        }
+        else if (!ver_input_proofs_rings(tx, mix_ring))
+        {
+            failed_tx_index_out = i;
+            return false;
+        }
+    }
+
+    if (rvv.empty())
+        return true;
+
+    size_t failed_rv_index = rvv.size();
+    if (rct::verRctNonSemanticsSimple(rvv, &failed_rv_index))
+        return true;
+
+    if (failed_rv_index < rvv.size())
+    {
+        failed_tx_index_out = rvv_tx_indices[failed_rv_index];
+        return false;
+    }
+
+    // The batch failed without pointing at a culprit, so fall back to checking each tx's proofs
+    MDEBUG("Batch input proof verification failed, falling back to per-transaction verification");
+    for (size_t n = 0; n < rvv.size(); ++n)
+    {
+        if (!rct::verRctNonSemanticsSimple(*rvv[n]))
+        {
+            failed_tx_index_out = rvv_tx_indices[n];
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ver_input_proofs_rings(const std::vector<std::pair<transaction*, const rct::ctkeyM*>> &txs_and_mix_rings,
+    std::vector<bool> &verified_out)
+{
+    size_t failed_tx_index = 0;
+    if (ver_input_proofs_rings(txs_and_mix_rings, failed_tx_index))
+    {
+        verified_out.assign(txs_and_mix_rings.size(), true);
+        return true;
+    }
+
+    // Once the batch fails, only the transactions verified on their own can be trusted
+    verified_out.assign(txs_and_mix_rings.size(), false);
+    for (size_t i = 0; i < txs_and_mix_rings.size(); ++i)
+    {
+        if (i != failed_tx_index)
+            verified_out[i] = ver_input_proofs_rings(*txs_and_mix_rings[i].first, *txs_and_mix_rings[i].second);
+    }
+    return false;
+}
+
 crypto::hash make_input_verification_id(const crypto::hash &tx_hash, const rct::ctkeyM &dereferenced_mix_ring)
 {
     std::stringstream ss;
@@ -464,13 +576,13 @@ bool ver_mixed_rct_semantics(std::vector<const rct::rctSig*> rvv)
 }
 
 bool ver_non_input_consensus(const transaction& tx, tx_verification_context& tvc,
-    std::uint8_t hf_version)
+    std::uint8_t hf_version, const std::unordered_set<crypto::hash>* rct_semantics_verified_txids)
 {
-    return ver_non_input_consensus_templated(&tx, &tx + 1, tvc, hf_version);
+    return ver_non_input_consensus_templated(&tx, &tx + 1, tvc, hf_version, rct_semantics_verified_txids);
 }
 
 bool ver_non_input_consensus(const pool_supplement& ps, tx_verification_context& tvc,
-    const std::uint8_t hf_version)
+    const std::uint8_t hf_version, const std::unordered_set<crypto::hash>* rct_semantics_verified_txids)
 {
     // We already verified the pool supplement for this hard fork version! Yippee!
     if (ps.nic_verified_hf_version == hf_version)
@@ -482,7 +594,8 @@ bool ver_non_input_consensus(const pool_supplement& ps, tx_verification_context&
     const auto tx_end = boost::make_transform_iterator(ps.txs_by_txid.cend(), it_transform);
 
     // Perform the checks...
-    const bool verified = ver_non_input_consensus_templated(tx_begin, tx_end, tvc, hf_version);
+    const bool verified = ver_non_input_consensus_templated(tx_begin, tx_end, tvc, hf_version,
+        rct_semantics_verified_txids);
 
     // Cache the hard fork version on success
     if (verified)
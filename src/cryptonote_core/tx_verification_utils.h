@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include <unordered_set>
+
 #include "cryptonote_basic/blobdatatype.h"
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/verification_context.h"
@@ -62,6 +64,35 @@ uint64_t get_transaction_weight_limit(uint8_t hf_version);
  */
 bool ver_input_proofs_rings(transaction& tx, const rct::ctkeyM &dereferenced_mix_ring);
 
+/**
+ * @brief Verify the input proofs of a group of transactions together
+ *
+ * Equivalent to calling ver_input_proofs_rings() on each (transaction, mixring) pair, except that
+ * the MLSAG/CLSAG proofs of all simple RingCT transactions in the group are verified as a single
+ * set of threadpool jobs instead of one set per transaction. Other transaction types are verified
+ * one at a time. If the group fails without the failure being attributable to a single
+ * transaction, each transaction is re-verified on its own to find the culprit.
+ *
+ * @param txs_and_mix_rings transactions and their mixrings. THE MIXRINGS MUST BE PREVIOUSLY VALIDATED
+ * @param failed_tx_index_out on failure, set to the index of a transaction which failed verification
+ * @return true when ver_input_proofs_rings() would return true for every pair, false otherwise
+ */
+bool ver_input_proofs_rings(const std::vector<std::pair<transaction*, const rct::ctkeyM*>> &txs_and_mix_rings,
+    size_t &failed_tx_index_out);
+
+/**
+ * @brief Verify the input proofs of a group of transactions, finding every one which fails
+ *
+ * The group is verified as one batch first. Only if the batch fails is each transaction verified
+ * on its own, so that one bad transaction does not fail the others.
+ *
+ * @param txs_and_mix_rings transactions and their mixrings. THE MIXRINGS MUST BE PREVIOUSLY VALIDATED
+ * @param verified_out set to whether each transaction's input proofs verified
+ * @return true if every transaction verified, false otherwise
+ */
+bool ver_input_proofs_rings(const std::vector<std::pair<transaction*, const rct::ctkeyM*>> &txs_and_mix_rings,
+    std::vector<bool> &verified_out);
+
 /**
  * @brief Make an ID for the parameters to ver_input_proofs_rings() for a transaction and its dereferenced chain data
  *
@@ -115,16 +146,20 @@ struct pool_supplement
  * calculated for that transaction. We use the .nic_verified_hf_version field to skip verification
  * for the pool supplement if hf_version matches, and we cache that version on success.
  *
+ * Rule 7 is skipped for transactions whose hash is in rct_semantics_verified_txids, for callers
+ * which have already batch verified the RingCT semantics of a larger group of transactions.
+ *
  * @param tx single transaction to verify
  * @param pool_supplement pool supplement to verify
  * @param tvc relevant flags will be set for if/why verification failed
  * @param hf_version Hard fork version to run rules against
+ * @param rct_semantics_verified_txids if not null, hashes of txs whose RingCT semantics are already verified
  * @return true if all relevant transactions verify, false otherwise
  */
 bool ver_non_input_consensus(const transaction& tx, tx_verification_context& tvc,
-    std::uint8_t hf_version);
+    std::uint8_t hf_version, const std::unordered_set<crypto::hash>* rct_semantics_verified_txids = nullptr);
 
 bool ver_non_input_consensus(const pool_supplement& ps, tx_verification_context& tvc,
-    std::uint8_t hf_version);
+    std::uint8_t hf_version, const std::unordered_set<crypto::hash>* rct_semantics_verified_txids = nullptr);
 
 } // namespace cryptonote
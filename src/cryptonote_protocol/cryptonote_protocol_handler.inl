@@ -951,10 +951,13 @@ namespace cryptonote
     else
       stem_txs.reserve(arg.txs.size());
 
-    for (auto& tx : arg.txs)
+    // verify the whole notification as one batch, then sort the txs for relaying
+    std::vector<tx_verification_context> tvcs(arg.txs.size());
+    m_core.handle_incoming_txs(epee::to_span(arg.txs), epee::to_mut_span(tvcs), tx_relay, true);
+    for (size_t i = 0; i < arg.txs.size(); ++i)
     {
-      tx_verification_context tvc{};
-      if (!m_core.handle_incoming_tx(tx, tvc, tx_relay, true) && !tvc.m_no_drop_offense)
+      const tx_verification_context &tvc = tvcs[i];
+      if ((tvc.m_verifivation_failed || tvc.m_verifivation_impossible) && !tvc.m_no_drop_offense)
       {
         LOG_PRINT_CCONTEXT_L1("Tx verification failed, dropping connection");
         drop_connection(context, false, false);
@@ -965,11 +968,11 @@ namespace cryptonote
       {
         case relay_method::local:
         case relay_method::stem:
-          stem_txs.push_back(std::move(tx));
+          stem_txs.push_back(std::move(arg.txs[i]));
           break;
         case relay_method::block:
         case relay_method::fluff:
-          fluff_txs.push_back(std::move(tx));
+          fluff_txs.push_back(std::move(arg.txs[i]));
           break;
         default:
         case relay_method::forward: // not supposed to happen here
@@ -971,13 +971,16 @@ bool t_command_parser_executor::version(const std::vector<std::string>& args)
 
 bool t_command_parser_executor::prune_blockchain(const std::vector<std::string>& args)
 {
-  if (args.size() > 1)
+  if (args.size() > 2)
   {
     std::cout << "Invalid syntax: Too many parameters. For more details, use the help command." << std::endl;
     return true;
   }
 
-  if (args.empty() || args[0] != "confirm")
+  bool background = false;
+  if (!args.empty() && args[0] == "background")
+    background = true;
+  if (args.size() != (background ? 2 : 1) || args.back() != "confirm")
   {
     std::cout << "Warning: pruning from within mevacoind will not shrink the database file size." << std::endl;
     std::cout << "Instead, parts of the file will be marked as free, so the file will not grow" << std::endl;
@@ -988,7 +991,7 @@ bool t_command_parser_executor::prune_blockchain(const std::vector<std::string>&
     return true;
   }
 
-  return m_executor.prune_blockchain();
+  return m_executor.prune_blockchain(background);
 }
 
 bool t_command_parser_executor::check_blockchain_pruning(const std::vector<std::string>& args)
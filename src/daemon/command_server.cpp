@@ -315,8 +315,8 @@ t_command_server::t_command_server(
     m_command_lookup.set_handler(
       "prune_blockchain"
     , std::bind(&t_command_parser_executor::prune_blockchain, &m_parser, p::_1)
-    , "prune_blockchain [confirm]"
-    , "Prune the blockchain."
+    , "prune_blockchain [background] [confirm]"
+    , "Prune the blockchain. With \"background\", prune a little at a time while the daemon keeps running, and show progress with sync_info."
     );
     m_command_lookup.set_handler(
       "check_blockchain_pruning"
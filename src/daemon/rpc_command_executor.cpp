@@ -2276,6 +2276,9 @@ bool t_rpc_command_executor::sync_info()
     tools::success_msg_writer() << "Downloading at " << current_download << " kB/s";
     if (res.next_needed_pruning_seed)
       tools::success_msg_writer() << "Next needed pruning seed: " << res.next_needed_pruning_seed;
+    if (res.pruning_in_progress)
+      tools::success_msg_writer() << "Pruning: " << res.pruning_txes_done << "/" << res.pruning_txes_total << " transactions ("
+          << (res.pruning_txes_total ? 100.0 * res.pruning_txes_done / res.pruning_txes_total : 0.0) << "%)";
 
     tools::success_msg_writer() << std::to_string(res.peers.size()) << " peers";
     tools::success_msg_writer() << "Remote Host                        Peer_ID   State   Prune_Seed          Height  DL kB/s, Queued Blocks / MB";
@@ -2341,7 +2344,7 @@ bool t_rpc_command_executor::pop_blocks(uint64_t num_blocks)
   return true;
 }
 
-bool t_rpc_command_executor::prune_blockchain()
+bool t_rpc_command_executor::prune_blockchain(bool background)
 {
     cryptonote::COMMAND_RPC_PRUNE_BLOCKCHAIN::request req;
     cryptonote::COMMAND_RPC_PRUNE_BLOCKCHAIN::response res;
@@ -2349,6 +2352,7 @@ bool t_rpc_command_executor::prune_blockchain()
     epee::json_rpc::error error_resp;
 
     req.check = false;
+    req.background = background;
 
     if (m_is_rpc)
     {
@@ -2366,7 +2370,10 @@ bool t_rpc_command_executor::prune_blockchain()
         }
     }
 
-    tools::success_msg_writer() << "Blockchain pruned";
+    if (background)
+      tools::success_msg_writer() << "Blockchain pruning started in the background";
+    else
+      tools::success_msg_writer() << "Blockchain pruned";
     return true;
 }
 
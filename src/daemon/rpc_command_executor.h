@@ -156,7 +156,7 @@ public:
 
   bool pop_blocks(uint64_t num_blocks);
 
-  bool prune_blockchain();
+  bool prune_blockchain(bool background);
 
   bool check_blockchain_pruning();
 
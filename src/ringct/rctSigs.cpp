@@ -28,6 +28,11 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <atomic>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <boost/thread/mutex.hpp>
 #include "rctSigs.h"
 
 #include "misc_log_ex.h"
@@ -119,6 +124,114 @@ namespace
         const size_t n_scalars = ring_size;
         return rct::clsag{rct::keyV(n_scalars, I), I, I, I};
     }
+
+    // The parts of a CLSAG verification which only depend on a ring member, and can
+    // thus be reused for every signature which uses that output in its ring
+    struct ring_member_precomp
+    {
+        rct::geDsmp P;       // precomp of the output key
+        rct::geDsmp hash8;   // precomp of 8*hash_to_p3(output key)
+        ge_p3 C;             // decompressed commitment
+    };
+
+    struct ctkey_hash
+    {
+        std::size_t operator()(const rct::ctkey &k) const { return std::hash<rct::key>()(k.dest) ^ std::hash<rct::key>()(k.mask); }
+    };
+
+    // A bounded LRU of ring_member_precomp, keyed by ring member. Entries are keyed by the
+    // member's keys themselves rather than by output index, so they can never go stale on reorg.
+    // It is sharded so concurrent verification threads rarely contend on the same lock.
+    class ring_member_cache
+    {
+    public:
+        static constexpr size_t N_SHARDS = 16;
+        static constexpr size_t DEFAULT_CAPACITY = 8192; // about 24 MB
+
+        ring_member_cache(): m_shard_capacity(DEFAULT_CAPACITY / N_SHARDS), m_hits(0), m_misses(0) {}
+
+        std::shared_ptr<const ring_member_precomp> get(const rct::ctkey &member)
+        {
+            shard &s = get_shard(member);
+            boost::unique_lock<boost::mutex> lock(s.mutex);
+            const auto i = s.index.find(member);
+            if (i == s.index.end())
+            {
+                ++m_misses;
+                return nullptr;
+            }
+            s.lru.splice(s.lru.begin(), s.lru, i->second);
+            ++m_hits;
+            return i->second->second;
+        }
+
+        void add(const rct::ctkey &member, std::shared_ptr<const ring_member_precomp> precomp)
+        {
+            shard &s = get_shard(member);
+            boost::unique_lock<boost::mutex> lock(s.mutex);
+            if (s.index.find(member) != s.index.end())
+                return;
+            s.lru.emplace_front(member, std::move(precomp));
+            s.index.emplace(member, s.lru.begin());
+            trim(s, m_shard_capacity);
+        }
+
+        void set_capacity(size_t capacity)
+        {
+            m_shard_capacity = (capacity + N_SHARDS - 1) / N_SHARDS;
+            for (shard &s: m_shards)
+            {
+                boost::unique_lock<boost::mutex> lock(s.mutex);
+                trim(s, m_shard_capacity);
+            }
+        }
+
+        rct::ring_member_cache_stats get_stats()
+        {
+            rct::ring_member_cache_stats stats;
+            stats.hits = m_hits;
+            stats.misses = m_misses;
+            stats.capacity = m_shard_capacity * N_SHARDS;
+            stats.size = 0;
+            for (shard &s: m_shards)
+            {
+                boost::unique_lock<boost::mutex> lock(s.mutex);
+                stats.size += s.index.size();
+            }
+            return stats;
+        }
+
+    private:
+        typedef std::list<std::pair<rct::ctkey, std::shared_ptr<const ring_member_precomp>>> lru_list;
+        struct shard
+        {
+            boost::mutex mutex;
+            lru_list lru;
+            std::unordered_map<rct::ctkey, lru_list::iterator, ctkey_hash> index;
+        };
+
+        shard &get_shard(const rct::ctkey &member) { return m_shards[member.dest.bytes[0] % N_SHARDS]; }
+
+        static void trim(shard &s, size_t capacity)
+        {
+            while (s.index.size() > capacity)
+            {
+                s.index.erase(s.lru.back().first);
+                s.lru.pop_back();
+            }
+        }
+
+        shard m_shards[N_SHARDS];
+        std::atomic<size_t> m_shard_capacity;
+        std::atomic<uint64_t> m_hits;
+        std::atomic<uint64_t> m_misses;
+    };
+
+    ring_member_cache &get_ring_member_cache()
+    {
+        static ring_member_cache cache;
+        return cache;
+    }
 }
 
 namespace rct {
@@ -942,34 +1055,40 @@ namespace rct {
             key c_new;
             key L;
             key R;
-            geDsmp P_precomp;
             geDsmp C_precomp;
             size_t i = 0;
             ge_p3 hash8_p3;
-            geDsmp hash_precomp;
             ge_p3 temp_p3;
             ge_p1p1 temp_p1;
+            ring_member_cache &member_cache = get_ring_member_cache();
 
             while (i < n) {
                 sc_0(c_new.bytes);
                 sc_mul(c_p.bytes,mu_P.bytes,c.bytes);
                 sc_mul(c_c.bytes,mu_C.bytes,c.bytes);
 
-                // Precompute points for L/R
-                precomp(P_precomp.k,pubs[i].dest);
+                // Precompute points for L/R, unless this ring member was seen recently
+                std::shared_ptr<const ring_member_precomp> member = member_cache.get(pubs[i]);
+                if (!member)
+                {
+                    std::shared_ptr<ring_member_precomp> new_member = std::make_shared<ring_member_precomp>();
+                    precomp(new_member->P.k,pubs[i].dest);
+                    CHECK_AND_ASSERT_MES(ge_frombytes_vartime(&new_member->C, pubs[i].mask.bytes) == 0, false, "point conv failed");
+                    hash_to_p3(hash8_p3,pubs[i].dest);
+                    ge_dsm_precomp(new_member->hash8.k, &hash8_p3);
+                    member_cache.add(pubs[i], new_member);
+                    member = std::move(new_member);
+                }
 
-                CHECK_AND_ASSERT_MES(ge_frombytes_vartime(&temp_p3, pubs[i].mask.bytes) == 0, false, "point conv failed");
-                ge_sub(&temp_p1,&temp_p3,&C_offset_cached);
+                ge_sub(&temp_p1,&member->C,&C_offset_cached);
                 ge_p1p1_to_p3(&temp_p3,&temp_p1);
                 ge_dsm_precomp(C_precomp.k,&temp_p3);
 
                 // Compute L
-                addKeys_aGbBcC(L,sig.s[i],c_p,P_precomp.k,c_c,C_precomp.k);
+                addKeys_aGbBcC(L,sig.s[i],c_p,member->P.k,c_c,C_precomp.k);
 
                 // Compute R
-                hash_to_p3(hash8_p3,pubs[i].dest);
-                ge_dsm_precomp(hash_precomp.k, &hash8_p3);
-                addKeys_aAbBcC(R,sig.s[i],hash_precomp.k,c_p,I_precomp.k,c_c,D_precomp.k);
+                addKeys_aAbBcC(R,sig.s[i],member->hash8.k,c_p,I_precomp.k,c_c,D_precomp.k);
 
                 c_to_hash[2*n+3] = L;
                 c_to_hash[2*n+4] = R;
@@ -986,6 +1105,16 @@ namespace rct {
     }
 
 
+    void set_ring_member_cache_capacity(size_t capacity)
+    {
+        get_ring_member_cache().set_capacity(capacity);
+    }
+
+    ring_member_cache_stats get_ring_member_cache_stats()
+    {
+        return get_ring_member_cache().get_stats();
+    }
+
     //These functions get keys from blockchain
     //replace these when connecting blockchain
     //getKeyFromBlockchain grabs a key from the blockchain at "reference_index" to mix with
@@ -1541,6 +1670,86 @@ namespace rct {
       }
     }
 
+    //Verifies the MLSAG/CLSAG input proofs of several simple rctSigs at once. All the inputs of all
+    //  the sigs are submitted as a single set of threadpool jobs, so sigs with few inputs do not leave
+    //  threads idle. If failed is not NULL and the failure can be attributed to a single sig, it is set
+    //  to the index of that sig in rvv, otherwise it is left untouched.
+    bool verRctNonSemanticsSimple(const std::vector<const rctSig*> & rvv, size_t *failed) {
+      size_t current = 0;
+      try
+      {
+        PERF_TIMER(verRctNonSemanticsSimple_batch);
+
+        std::vector<key> messages(rvv.size());
+        std::vector<const keyV*> pseudoOuts(rvv.size());
+        size_t total_inputs = 0;
+        for (current = 0; current < rvv.size(); ++current)
+        {
+          const rctSig &rv = *rvv[current];
+          CHECK_AND_ASSERT_MES(rv.type == RCTTypeSimple || rv.type == RCTTypeBulletproof || rv.type == RCTTypeBulletproof2 || rv.type == RCTTypeCLSAG || rv.type == RCTTypeBulletproofPlus,
+              false, "verRctNonSemanticsSimple called on non simple rctSig");
+          const bool bulletproof = is_rct_bulletproof(rv.type) || is_rct_bulletproof_plus(rv.type);
+          pseudoOuts[current] = bulletproof ? &rv.p.pseudoOuts : &rv.pseudoOuts;
+          CHECK_AND_ASSERT_MES(pseudoOuts[current]->size() == rv.mixRing.size(), false, "Mismatched sizes of pseudoOuts and mixRing");
+          if (is_rct_clsag(rv.type))
+            CHECK_AND_ASSERT_MES(rv.p.CLSAGs.size() == rv.mixRing.size(), false, "Mismatched sizes of CLSAGs and mixRing");
+          else
+            CHECK_AND_ASSERT_MES(rv.p.MGs.size() == rv.mixRing.size(), false, "Mismatched sizes of MGs and mixRing");
+          messages[current] = get_pre_mlsag_hash(rv, hw::get_device("default"));
+          total_inputs += rv.mixRing.size();
+        }
+        current = rvv.size();
+
+        std::deque<bool> results(total_inputs);
+        tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+        tools::threadpool::waiter waiter(tpool);
+
+        size_t result_index = 0;
+        for (size_t n = 0; n < rvv.size(); ++n) {
+          for (size_t i = 0; i < rvv[n]->mixRing.size(); ++i, ++result_index) {
+            tpool.submit(&waiter, [&, n, i, result_index] {
+                const rctSig &rv = *rvv[n];
+                if (is_rct_clsag(rv.type))
+                    results[result_index] = verRctCLSAGSimple(messages[n], rv.p.CLSAGs[i], rv.mixRing[i], (*pseudoOuts[n])[i]);
+                else
+                    results[result_index] = verRctMGSimple(messages[n], rv.p.MGs[i], rv.mixRing[i], (*pseudoOuts[n])[i]);
+            });
+          }
+        }
+        if (!waiter.wait())
+          return false;
+
+        result_index = 0;
+        for (size_t n = 0; n < rvv.size(); ++n) {
+          for (size_t i = 0; i < rvv[n]->mixRing.size(); ++i, ++result_index) {
+            if (!results[result_index]) {
+              LOG_PRINT_L1("verRctMGSimple/verRctCLSAGSimple failed for input " << i << " of sig " << n);
+              if (failed)
+                *failed = n;
+              return false;
+            }
+          }
+        }
+
+        return true;
+      }
+      // we can get deep throws from ge_frombytes_vartime if input isn't valid
+      catch (const std::exception &e)
+      {
+        LOG_PRINT_L1("Error in verRctNonSemanticsSimple: " << e.what());
+        if (failed && current < rvv.size())
+          *failed = current;
+        return false;
+      }
+      catch (...)
+      {
+        LOG_PRINT_L1("Error in verRctNonSemanticsSimple, but not an actual exception");
+        if (failed && current < rvv.size())
+          *failed = current;
+        return false;
+      }
+    }
+
     //RingCT protocol
     //genRct: 
     //   creates an rctSig with all data necessary to verify the rangeProofs and that the signer owns one of the
@@ -82,6 +82,18 @@ namespace rct {
     clsag proveRctCLSAGSimple(const key &, const ctkeyV &, const ctkey &, const key &, const key &, unsigned int, hw::device &);
     bool verRctCLSAGSimple(const key &, const clsag &, const ctkeyV &, const key &);
 
+    //CLSAG verification keeps the decompressed/precomputed points of recently seen ring
+    //  members in a bounded cache, since popular decoys appear in many signatures
+    struct ring_member_cache_stats
+    {
+      uint64_t hits;
+      uint64_t misses;
+      uint64_t size;
+      uint64_t capacity;
+    };
+    void set_ring_member_cache_capacity(size_t capacity);
+    ring_member_cache_stats get_ring_member_cache_stats();
+
     //proveRange and verRange
     //proveRange gives C, and mask such that \sumCi = C
     //   c.f. https://eprint.iacr.org/2015/1098 section 5.1
@@ -132,6 +144,7 @@ namespace rct {
     bool verRctSemanticsSimple(const rctSig & rv);
     bool verRctSemanticsSimple(const std::vector<const rctSig*> & rv);
     bool verRctNonSemanticsSimple(const rctSig & rv);
+    bool verRctNonSemanticsSimple(const std::vector<const rctSig*> & rvv, size_t *failed = NULL);
     static inline bool verRctSimple(const rctSig & rv) { return verRctSemanticsSimple(rv) && verRctNonSemanticsSimple(rv); }
     xmr_amount decodeRct(const rctSig & rv, const key & sk, unsigned int i, key & mask, hw::device &hwdev);
     xmr_amount decodeRct(const rctSig & rv, const key & sk, unsigned int i, hw::device &hwdev);
@@ -47,6 +47,7 @@ using namespace epee;
 #include "cryptonote_basic/cryptonote_basic_impl.h"
 #include "cryptonote_basic/merge_mining.h"
 #include "cryptonote_core/tx_sanity_check.h"
+#include "ringct/rctSigs.h"
 #include "misc_language.h"
 #include "net/local_ip.h"
 #include "net/parse.h"
@@ -89,18 +90,26 @@ namespace
     {
       uint64_t count;
       uint64_t time;
+      uint64_t db_time;
       uint64_t credits;
     };
 
     RPCTracker(const char *rpc, tools::LoggingPerformanceTimer &timer): rpc(rpc), timer(timer) {
+      cryptonote::db_read_timer::enable(true);
+      db_time_start = cryptonote::db_read_timer::total_ns();
     }
     ~RPCTracker() {
+      const uint64_t db_time = cryptonote::db_read_timer::total_ns() - db_time_start;
+      cryptonote::db_read_timer::enable(false);
       try
       {
+        MCLOG(tools::performance_timer_log_level, "perf." MEVACOIN_DEFAULT_LOG_CATEGORY, el::Color::Default,
+            "PERF " << rpc << ": " << timer.value() / 1000 << " us, " << db_time / 1000 << " us in db");
         boost::unique_lock<boost::mutex> lock(mutex);
         auto &e = tracker[rpc];
         ++e.count;
         e.time += timer.value();
+        e.db_time += db_time;
       }
       catch (...) { /* ignore */ }
     }
@@ -115,6 +124,7 @@ namespace
   private:
     std::string rpc;
     tools::LoggingPerformanceTimer &timer;
+    uint64_t db_time_start;
     static boost::mutex mutex;
     static std::unordered_map<std::string, entry_t> tracker;
   };
@@ -133,6 +143,16 @@ namespace
     return (value + quantum - 1) / quantum * quantum;
   }
 
+  // reads straight from the db, so it may be called with a read snapshot pinned
+  bool get_tx_outputs_gindexs(const cryptonote::BlockchainDB &db, const crypto::hash &tx_hash, size_t n_txes, std::vector<std::vector<uint64_t>> &indices)
+  {
+    uint64_t tx_index;
+    if (!db.tx_exists(tx_hash, tx_index))
+      return false;
+    indices = db.get_tx_amount_output_indices(tx_index, n_txes);
+    return indices.size() == n_txes;
+  }
+
   void store_128(boost::multiprecision::uint128_t value, uint64_t &slow64, std::string &swide, uint64_t &stop64)
   {
     slow64 = (value & 0xffffffffffffffff).convert_to<uint64_t>();
@@ -601,6 +621,19 @@ namespace cryptonote
     res.synchronized = check_core_ready();
     res.busy_syncing = m_p2p.get_payload_object().is_busy_syncing();
     res.restricted = restricted;
+    if (!restricted)
+    {
+      const rct::ring_member_cache_stats ring_member_cache_stats = rct::get_ring_member_cache_stats();
+      res.ring_member_cache_hits = ring_member_cache_stats.hits;
+      res.ring_member_cache_misses = ring_member_cache_stats.misses;
+      res.ring_member_cache_size = ring_member_cache_stats.size;
+      res.pruning_in_progress = m_core.get_background_pruning_progress(res.pruning_txes_done, res.pruning_txes_total);
+      const db_storage_stats storage_stats = m_core.get_blockchain_storage().get_db().get_storage_stats();
+      res.database_reserved = storage_stats.reserved;
+      res.database_resizes = storage_stats.resizes;
+      res.database_resize_stall_time = storage_stats.stall_time_us / 1000;
+      res.database_resize_max_stall_time = storage_stats.max_stall_time_us / 1000;
+    }
 
     res.status = CORE_RPC_STATUS_OK;
     return true;
@@ -758,15 +791,45 @@ namespace cryptonote
         }
       }
 
+      // the output indices are all read from one snapshot, which must still have the blocks
+      // found; if a reorg came in between, the blocks are looked up once more
+      BlockchainDB &db = m_core.get_blockchain_storage().get_db();
       std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > > bs;
-      if(!m_core.find_blockchain_supplement(req.start_height, req.block_ids, bs, res.current_height, res.top_block_hash, res.start_height, req.prune, !req.no_miner_tx, max_blocks, COMMAND_RPC_GET_BLOCKS_FAST_MAX_TX_COUNT))
+      boost::optional<db_rtxn_guard> snapshot;
+      for (int attempt = 0; !snapshot; ++attempt)
       {
-        res.status = "Failed";
-        add_host_fail(ctx);
-        return true;
-      }
+        bs.clear();
+        if(!m_core.find_blockchain_supplement(req.start_height, req.block_ids, bs, res.current_height, res.top_block_hash, res.start_height, req.prune, !req.no_miner_tx, max_blocks, COMMAND_RPC_GET_BLOCKS_FAST_MAX_TX_COUNT))
+        {
+          res.status = "Failed";
+          add_host_fail(ctx);
+          return true;
+        }
 
-      CHECK_PAYMENT_SAME_TS(req, res, bs.size() * COST_PER_BLOCK);
+        if (attempt == 0)
+          CHECK_PAYMENT_SAME_TS(req, res, bs.size() * COST_PER_BLOCK);
+
+        snapshot.emplace(&db);
+        if (bs.empty())
+          break;
+        const uint64_t last_height = res.start_height + bs.size() - 1;
+        cryptonote::block last_block;
+        if (!parse_and_validate_block_from_blob(bs.back().first.first, last_block))
+        {
+          res.status = "Failed";
+          return true;
+        }
+        if (last_height >= db.height() || db.get_block_hash_from_height(last_height) != get_block_hash(last_block))
+        {
+          // the supplement lookup takes the blockchain lock, so the snapshot can't be kept across it
+          snapshot = boost::none;
+          if (attempt > 0)
+          {
+            res.status = "Failed: blockchain changed during the request";
+            return true;
+          }
+        }
+      }
 
       size_t size = 0, ntxes = 0;
       res.blocks.reserve(bs.size());
@@ -795,7 +858,7 @@ namespace cryptonote
         if (n_txes_to_lookup > 0)
         {
           std::vector<std::vector<uint64_t>> indices;
-          bool r = m_core.get_tx_outputs_gindexs(req.no_miner_tx ? bd.second.front().first : bd.first.second, n_txes_to_lookup, indices);
+          bool r = get_tx_outputs_gindexs(db, req.no_miner_tx ? bd.second.front().first : bd.first.second, n_txes_to_lookup, indices);
           if (!r)
           {
             res.status = "Failed";
@@ -1112,6 +1175,11 @@ namespace cryptonote
     auto vhi = vh.cbegin();
     auto missedi = missed_txs.cbegin();
 
+    // heights, confirmations and output indices all come from one snapshot
+    BlockchainDB &db = m_core.get_blockchain_storage().get_db();
+    db_rtxn_guard snapshot(&db);
+    const uint64_t blockchain_height = db.height();
+
     for(auto& tx: txs)
     {
       res.txs.push_back(COMMAND_RPC_GET_TRANSACTIONS::entry());
@@ -1220,9 +1288,9 @@ namespace cryptonote
       }
       else
       {
-        e.block_height = m_core.get_blockchain_storage().get_db().get_tx_block_height(tx_hash);
-        e.confirmations = m_core.get_current_blockchain_height() - e.block_height;
-        e.block_timestamp = m_core.get_blockchain_storage().get_db().get_block_timestamp(e.block_height);
+        e.block_height = db.get_tx_block_height(tx_hash);
+        e.confirmations = blockchain_height - e.block_height;
+        e.block_timestamp = db.get_block_timestamp(e.block_height);
         e.received_timestamp = 0;
         e.double_spend_seen = false;
         e.relayed = false;
@@ -1236,12 +1304,14 @@ namespace cryptonote
       // output indices too if not in pool
       if (pool_tx_hashes.find(tx_hash) == pool_tx_hashes.end())
       {
-        bool r = m_core.get_tx_outputs_gindexs(tx_hash, e.output_indices);
+        std::vector<std::vector<uint64_t>> indices;
+        bool r = get_tx_outputs_gindexs(db, tx_hash, 1, indices);
         if (!r)
         {
           res.status = "Failed";
           return true;
         }
+        e.output_indices = std::move(indices.front());
       }
     }
 
@@ -3385,6 +3455,7 @@ namespace cryptonote
     ++res.height; // turn top block height into blockchain height
     res.target_height = m_p2p.get_payload_object().is_synchronized() ? 0 : m_core.get_target_blockchain_height();
     res.next_needed_pruning_seed = m_p2p.get_payload_object().get_next_needed_pruning_stripe().second;
+    res.pruning_in_progress = m_core.get_background_pruning_progress(res.pruning_txes_done, res.pruning_txes_total);
 
     for (const auto &c: m_p2p.get_payload_object().get_connections())
       res.peers.push_back({c});
@@ -3410,7 +3481,7 @@ namespace cryptonote
     size_t n_txes = m_core.get_pool_transactions_count();
     CHECK_PAYMENT_MIN1(req, res, COST_PER_TX_POOL_STATS * n_txes, false);
 
-    if (!m_core.get_txpool_backlog(res.backlog))
+    if (req.fee_buckets ? !m_core.get_txpool_backlog_by_fee(res.fee_buckets) : !m_core.get_txpool_backlog(res.backlog))
     {
       error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
       error_resp.message = "Failed to get txpool backlog";
@@ -3528,10 +3599,19 @@ namespace cryptonote
 
     try
     {
-      if (!(req.check ? m_core.check_blockchain_pruning() : m_core.prune_blockchain()))
+      if (req.check)
+      {
+        if (!m_core.check_blockchain_pruning())
+        {
+          error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
+          error_resp.message = "Failed to check blockchain pruning";
+          return false;
+        }
+      }
+      else if (!(req.background ? m_core.start_background_pruning() : m_core.prune_blockchain()))
       {
         error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
-        error_resp.message = req.check ? "Failed to check blockchain pruning" : "Failed to prune blockchain";
+        error_resp.message = "Failed to prune blockchain";
         return false;
       }
       res.pruning_seed = m_core.get_blockchain_pruning_seed();
@@ -3806,6 +3886,7 @@ namespace cryptonote
       res.data.back().rpc = d.first;
       res.data.back().count = d.second.count;
       res.data.back().time = d.second.time;
+      res.data.back().db_time = d.second.db_time;
       res.data.back().credits = d.second.credits;
     }
 
@@ -101,7 +101,7 @@ inline const std::string get_rpc_status(const bool trusted_daemon, const std::st
 // advance which version they will stop working with
 // Don't go over 32767 for any of these
 #define CORE_RPC_VERSION_MAJOR 3
-#define CORE_RPC_VERSION_MINOR 16
+#define CORE_RPC_VERSION_MINOR 21
 #define MAKE_CORE_RPC_VERSION(major,minor) (((major)<<16)|(minor))
 #define CORE_RPC_VERSION MAKE_CORE_RPC_VERSION(CORE_RPC_VERSION_MAJOR, CORE_RPC_VERSION_MINOR)
 
@@ -729,6 +729,16 @@ inline const std::string get_rpc_status(const bool trusted_daemon, const std::st
       std::string version;
       bool synchronized;
       bool restricted;
+      uint64_t ring_member_cache_hits;
+      uint64_t ring_member_cache_misses;
+      uint64_t ring_member_cache_size;
+      bool pruning_in_progress;
+      uint64_t pruning_txes_done;
+      uint64_t pruning_txes_total;
+      uint64_t database_reserved;
+      uint64_t database_resizes;
+      uint64_t database_resize_stall_time;
+      uint64_t database_resize_max_stall_time;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_access_response_base)
@@ -771,6 +781,16 @@ inline const std::string get_rpc_status(const bool trusted_daemon, const std::st
         KV_SERIALIZE(version)
         KV_SERIALIZE(synchronized)
         KV_SERIALIZE(restricted)
+        KV_SERIALIZE_OPT(ring_member_cache_hits, (uint64_t)0)
+        KV_SERIALIZE_OPT(ring_member_cache_misses, (uint64_t)0)
+        KV_SERIALIZE_OPT(ring_member_cache_size, (uint64_t)0)
+        KV_SERIALIZE_OPT(pruning_in_progress, false)
+        KV_SERIALIZE_OPT(pruning_txes_done, (uint64_t)0)
+        KV_SERIALIZE_OPT(pruning_txes_total, (uint64_t)0)
+        KV_SERIALIZE_OPT(database_reserved, (uint64_t)0)
+        KV_SERIALIZE_OPT(database_resizes, (uint64_t)0)
+        KV_SERIALIZE_OPT(database_resize_stall_time, (uint64_t)0)
+        KV_SERIALIZE_OPT(database_resize_max_stall_time, (uint64_t)0)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<response_t> response;
@@ -1635,8 +1655,11 @@ inline const std::string get_rpc_status(const bool trusted_daemon, const std::st
   {
     struct request_t: public rpc_access_request_base
     {
+      bool fee_buckets; // reply with fee_buckets instead of the per tx backlog
+
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_access_request_base)
+        KV_SERIALIZE_OPT(fee_buckets, false)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<request_t> request;
@@ -1644,10 +1667,12 @@ inline const std::string get_rpc_status(const bool trusted_daemon, const std::st
     struct response_t: public rpc_access_response_base
     {
       std::vector<tx_backlog_entry> backlog;
+      std::vector<tx_backlog_entry> fee_buckets; // summed weight and fee per fee per byte bucket, mean time in pool
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_access_response_base)
         KV_SERIALIZE_CONTAINER_POD_AS_BLOB(backlog)
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(fee_buckets)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<response_t> response;
@@ -2399,6 +2424,9 @@ inline const std::string get_rpc_status(const bool trusted_daemon, const std::st
       std::list<peer> peers;
       std::list<span> spans;
       std::string overview;
+      bool pruning_in_progress;
+      uint64_t pruning_txes_done;
+      uint64_t pruning_txes_total;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_access_response_base)
@@ -2408,6 +2436,9 @@ inline const std::string get_rpc_status(const bool trusted_daemon, const std::st
         KV_SERIALIZE(peers)
         KV_SERIALIZE(spans)
         KV_SERIALIZE(overview)
+        KV_SERIALIZE_OPT(pruning_in_progress, false)
+        KV_SERIALIZE_OPT(pruning_txes_done, (uint64_t)0)
+        KV_SERIALIZE_OPT(pruning_txes_total, (uint64_t)0)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<response_t> response;
@@ -2592,12 +2623,14 @@ inline const std::string get_rpc_status(const bool trusted_daemon, const std::st
       std::string rpc;
       uint64_t count;
       uint64_t time;
+      uint64_t db_time;
       uint64_t credits;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE(rpc)
         KV_SERIALIZE(count)
         KV_SERIALIZE(time)
+        KV_SERIALIZE_OPT(db_time, (uint64_t)0)
         KV_SERIALIZE(credits)
       END_KV_SERIALIZE_MAP()
     };
@@ -2720,10 +2753,12 @@ inline const std::string get_rpc_status(const bool trusted_daemon, const std::st
     struct request_t: public rpc_request_base
     {
       bool check;
+      bool background;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_request_base)
         KV_SERIALIZE_OPT(check, false)
+        KV_SERIALIZE_OPT(background, false)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<request_t> request;
@@ -15072,9 +15072,10 @@ std::vector<std::pair<uint64_t, uint64_t>> wallet2::estimate_backlog(const std::
     THROW_WALLET_EXCEPTION_IF(fee_level.second < fee_level.first, error::wallet_internal_error, "Minimum fee cannot be less than maximum fee");
   }
 
-  // get txpool backlog
+  // get txpool backlog, summed per fee bucket if the daemon supports it, per tx otherwise
   cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_BACKLOG::request req = AUTO_VAL_INIT(req);
   cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_BACKLOG::response res = AUTO_VAL_INIT(res);
+  req.fee_buckets = true;
 
   {
     const boost::lock_guard<boost::recursive_mutex> lock{m_daemon_rpc_mutex};
@@ -15088,11 +15089,13 @@ std::vector<std::pair<uint64_t, uint64_t>> wallet2::estimate_backlog(const std::
   uint64_t full_reward_zone = block_weight_limit / 2;
   THROW_WALLET_EXCEPTION_IF(full_reward_zone == 0, error::wallet_internal_error, "Invalid block weight limit from daemon");
 
+  const std::vector<cryptonote::tx_backlog_entry> &backlog = res.fee_buckets.empty() ? res.backlog : res.fee_buckets;
+
   std::vector<std::pair<uint64_t, uint64_t>> blocks;
   for (const auto& [our_fee_byte_min, our_fee_byte_max] : fee_levels)
   {
     uint64_t minfee_weight = 0, maxfee_weight = 0;
-    for (const auto &i: res.backlog)
+    for (const auto &i: backlog)
     {
       if (i.weight == 0)
       {
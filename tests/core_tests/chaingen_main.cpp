@@ -169,6 +169,12 @@ int main(int argc, char* argv[])
     GENERATE_AND_PLAY(txpool_double_spend_local);
     GENERATE_AND_PLAY(txpool_double_spend_keyimage);
     GENERATE_AND_PLAY(txpool_stem_loop);
+    GENERATE_AND_PLAY(txpool_ready_key_image_reset);
+    GENERATE_AND_PLAY(txpool_ready_pop_reset);
+    GENERATE_AND_PLAY(txpool_ready_relay_change);
+    GENERATE_AND_PLAY(txpool_init_unverified);
+    GENERATE_AND_PLAY(txpool_revalidation_drop);
+    GENERATE_AND_PLAY(txpool_validate_queues);
 
     // Double spend
     GENERATE_AND_PLAY(gen_double_spend_in_tx<false>);
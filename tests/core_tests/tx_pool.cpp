@@ -635,3 +635,290 @@ bool txpool_stem_loop::generate(std::vector<test_event_entry>& events) const
 
   return true;
 }
+
+txpool_template_base::txpool_template_base()
+  : test_chain_unit_base()
+  , m_tx_index(0)
+{
+  REGISTER_CALLBACK_METHOD(txpool_template_base, mark_tx);
+  REGISTER_CALLBACK_METHOD(txpool_template_base, check_template_has_tx);
+  REGISTER_CALLBACK_METHOD(txpool_template_base, check_template_lacks_tx);
+  REGISTER_CALLBACK_METHOD(txpool_template_base, relay_tx_fluff);
+  REGISTER_CALLBACK_METHOD(txpool_template_base, check_complement_lacks_tx);
+  REGISTER_CALLBACK_METHOD(txpool_template_base, restart_core);
+  REGISTER_CALLBACK_METHOD(txpool_template_base, run_idle);
+}
+
+bool txpool_template_base::mark_tx(cryptonote::core& /*c*/, size_t ev_index, const std::vector<test_event_entry>& /*events*/)
+{
+  m_tx_index = ev_index + 1;
+  return true;
+}
+
+bool txpool_template_base::check_template(cryptonote::core& c, const std::vector<test_event_entry>& events, const bool expected)
+{
+  CHECK_AND_ASSERT_MES(m_tx_index < events.size() && typeid(cryptonote::transaction) == events[m_tx_index].type(), false, "No tx marked");
+  const crypto::hash txid = cryptonote::get_transaction_hash(boost::get<cryptonote::transaction>(events[m_tx_index]));
+
+  cryptonote::account_base miner;
+  miner.generate();
+  cryptonote::block b;
+  cryptonote::difficulty_type diffic;
+  uint64_t height, expected_reward, cumulative_weight, seed_height;
+  crypto::hash seed_hash;
+  if (!c.get_block_template(b, miner.get_keys().m_account_address, diffic, height, expected_reward, cumulative_weight, cryptonote::blobdata(), seed_height, seed_hash))
+  {
+    MERROR("Failed to get a block template");
+    return false;
+  }
+
+  const bool found = std::find(b.tx_hashes.begin(), b.tx_hashes.end(), txid) != b.tx_hashes.end();
+  if (found != expected)
+  {
+    MERROR("Expected tx " << txid << (expected ? " in" : " not in") << " the block template");
+    return false;
+  }
+  return true;
+}
+
+bool txpool_template_base::check_template_has_tx(cryptonote::core& c, size_t /*ev_index*/, const std::vector<test_event_entry>& events)
+{
+  return check_template(c, events, true);
+}
+
+bool txpool_template_base::check_template_lacks_tx(cryptonote::core& c, size_t /*ev_index*/, const std::vector<test_event_entry>& events)
+{
+  return check_template(c, events, false);
+}
+
+bool txpool_template_base::relay_tx_fluff(cryptonote::core& c, size_t /*ev_index*/, const std::vector<test_event_entry>& events)
+{
+  CHECK_AND_ASSERT_MES(m_tx_index < events.size() && typeid(cryptonote::transaction) == events[m_tx_index].type(), false, "No tx marked");
+  const cryptonote::blobdata blob = t_serializable_object_to_blob(boost::get<cryptonote::transaction>(events[m_tx_index]));
+  c.on_transactions_relayed(epee::span<const cryptonote::blobdata>(&blob, 1), cryptonote::relay_method::fluff);
+  return true;
+}
+
+bool txpool_template_base::check_complement_lacks_tx(cryptonote::core& c, size_t /*ev_index*/, const std::vector<test_event_entry>& events)
+{
+  CHECK_AND_ASSERT_MES(m_tx_index < events.size() && typeid(cryptonote::transaction) == events[m_tx_index].type(), false, "No tx marked");
+  const cryptonote::transaction &tx = boost::get<cryptonote::transaction>(events[m_tx_index]);
+  const crypto::hash txid = cryptonote::get_transaction_hash(tx);
+  if (!c.pool_has_tx(txid))
+  {
+    MERROR("Expected tx " << txid << " to be in the pool");
+    return false;
+  }
+
+  std::vector<cryptonote::blobdata> txes;
+  if (!c.get_txpool_complement({}, txes))
+  {
+    MERROR("Failed to get the txpool complement");
+    return false;
+  }
+  if (std::find(txes.begin(), txes.end(), t_serializable_object_to_blob(tx)) != txes.end())
+  {
+    MERROR("Tx " << txid << " was handed to peers before being re-validated");
+    return false;
+  }
+  return true;
+}
+
+bool txpool_template_base::restart_core(cryptonote::core& c, size_t /*ev_index*/, const std::vector<test_event_entry>& /*events*/)
+{
+  static const std::pair<uint8_t, uint64_t> hard_forks[2] = {std::make_pair(1, 0), std::make_pair(0, 0)};
+  static const cryptonote::test_options test_options = {hard_forks, 0};
+
+  boost::program_options::options_description desc("Allowed options");
+  cryptonote::core::init_options(desc);
+  boost::program_options::variables_map vm;
+  const char *argv[] = {"core_tests", "--keep-fakechain"};
+  boost::program_options::store(boost::program_options::parse_command_line(2, argv, desc), vm);
+  boost::program_options::notify(vm);
+
+  c.deinit();
+  if (!c.init(vm, &test_options))
+  {
+    MERROR("Failed to restart core");
+    return false;
+  }
+  c.get_blockchain_storage().get_db().set_batch_transactions(true);
+  return true;
+}
+
+bool txpool_template_base::run_idle(cryptonote::core& c, size_t /*ev_index*/, const std::vector<test_event_entry>& /*events*/)
+{
+  return c.on_idle();
+}
+
+bool txpool_ready_key_image_reset::generate(std::vector<test_event_entry>& events) const
+{
+  INIT_MEMPOOL_TEST();
+
+  DO_CALLBACK(events, "mark_tx");
+  const std::size_t tx_index = events.size();
+  MAKE_TX(events, tx_0, miner_account, bob_account, send_amount, blk_0r);
+  DO_CALLBACK(events, "check_template_has_tx");
+
+  // use same key image with different id
+  cryptonote::transaction tx_1;
+  {
+    auto events_copy = events;
+    events_copy.erase(events_copy.begin() + tx_index);
+    MAKE_TX(events_copy, tx_temp, miner_account, bob_account, send_amount, blk_0r);
+    tx_1 = tx_temp;
+  }
+
+  // a block spending it makes tx_0 a double spend, though it was ready before
+  SET_EVENT_VISITOR_SETT(events, event_visitor_settings::set_txs_keeped_by_block);
+  events.push_back(tx_1);
+  MAKE_NEXT_BLOCK_TX1(events, blk_1, blk_0r, miner_account, tx_1);
+  DO_CALLBACK(events, "check_template_lacks_tx");
+
+  return true;
+}
+
+bool txpool_ready_pop_reset::generate(std::vector<test_event_entry>& events) const
+{
+  INIT_MEMPOOL_TEST();
+
+  MAKE_TX(events, tx_0, miner_account, bob_account, MK_COINS(1), blk_0r);
+  MAKE_NEXT_BLOCK_TX1(events, blk_1, blk_0r, miner_account, tx_0);
+  REWIND_BLOCKS_N(events, blk_1r, blk_1, miner_account, CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE);
+
+  // tx_1 spends the output tx_0 created
+  DO_CALLBACK(events, "mark_tx");
+  MAKE_TX(events, tx_1, bob_account, miner_account, MK_COINS(1) / 2, blk_1r);
+  DO_CALLBACK(events, "check_template_has_tx");
+
+  // a longer chain without tx_0 pops blk_1, so tx_1's input is gone
+  MAKE_NEXT_BLOCK(events, blk_1a, blk_0r, miner_account);
+  REWIND_BLOCKS_N(events, blk_2a, blk_1a, miner_account, CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE + 1);
+  DO_CALLBACK(events, "check_template_lacks_tx");
+
+  return true;
+}
+
+bool txpool_ready_relay_change::generate(std::vector<test_event_entry>& events) const
+{
+  INIT_MEMPOOL_TEST();
+
+  // stem txes are not mined by default
+  SET_EVENT_VISITOR_SETT(events, event_visitor_settings::set_txs_stem);
+  DO_CALLBACK(events, "mark_tx");
+  MAKE_TX(events, tx_0, miner_account, bob_account, send_amount, blk_0r);
+  DO_CALLBACK(events, "check_template_lacks_tx");
+
+  DO_CALLBACK(events, "relay_tx_fluff");
+  DO_CALLBACK(events, "check_template_has_tx");
+
+  return true;
+}
+
+bool txpool_init_unverified::generate(std::vector<test_event_entry>& events) const
+{
+  INIT_MEMPOOL_TEST();
+
+  DO_CALLBACK(events, "mark_tx");
+  MAKE_TX(events, tx_0, miner_account, bob_account, send_amount, blk_0r);
+  DO_CALLBACK(events, "check_template_has_tx");
+
+  // loaded from the db, it waits for on_idle to check it again
+  DO_CALLBACK(events, "restart_core");
+  DO_CALLBACK(events, "check_template_lacks_tx");
+  DO_CALLBACK(events, "check_complement_lacks_tx");
+  DO_CALLBACK(events, "run_idle");
+  DO_CALLBACK(events, "check_template_has_tx");
+
+  return true;
+}
+
+txpool_revalidation_drop::txpool_revalidation_drop()
+  : txpool_template_base()
+{
+  REGISTER_CALLBACK_METHOD(txpool_revalidation_drop, corrupt_pool_txes);
+  REGISTER_CALLBACK_METHOD(txpool_revalidation_drop, check_revalidated);
+}
+
+static std::vector<cryptonote::transaction> get_first_txes(const std::vector<test_event_entry>& events, size_t ev_index, size_t count)
+{
+  std::vector<cryptonote::transaction> txs;
+  for (size_t i = 0; i < ev_index && txs.size() < count; ++i)
+    if (typeid(cryptonote::transaction) == events[i].type())
+      txs.push_back(boost::get<cryptonote::transaction>(events[i]));
+  return txs;
+}
+
+bool txpool_revalidation_drop::corrupt_pool_txes(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  const std::vector<cryptonote::transaction> txs = get_first_txes(events, ev_index, 2);
+  CHECK_AND_ASSERT_MES(txs.size() == 2, false, "Expected two txes");
+
+  cryptonote::BlockchainDB &db = c.get_blockchain_storage().get_db();
+  cryptonote::db_wtxn_guard guard(&db);
+  for (size_t i = 0; i < txs.size(); ++i)
+  {
+    const crypto::hash txid = cryptonote::get_transaction_hash(txs[i]);
+    cryptonote::txpool_tx_meta_t meta;
+    CHECK_AND_ASSERT_MES(db.get_txpool_tx_meta(txid, meta), false, "Tx " << txid << " not in the pool");
+    meta.kept_by_block = i == 1;
+    cryptonote::transaction tx = txs[i];
+    CHECK_AND_ASSERT_MES(!tx.signatures.empty() && !tx.signatures[0].empty(), false, "Tx " << txid << " has no signature");
+    tx.signatures[0][0].c.data[0] ^= 1;
+    const cryptonote::blobdata blob = t_serializable_object_to_blob(tx);
+    db.remove_txpool_tx(txid);
+    db.add_txpool_tx(txid, blob, meta);
+  }
+  return true;
+}
+
+bool txpool_revalidation_drop::check_revalidated(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  const std::vector<cryptonote::transaction> txs = get_first_txes(events, ev_index, 2);
+  CHECK_AND_ASSERT_MES(txs.size() == 2, false, "Expected two txes");
+
+  const crypto::hash txid_0 = cryptonote::get_transaction_hash(txs[0]);
+  const crypto::hash txid_1 = cryptonote::get_transaction_hash(txs[1]);
+  if (c.pool_has_tx(txid_0))
+  {
+    MERROR("Invalid tx " << txid_0 << " was not dropped");
+    return false;
+  }
+  if (!c.pool_has_tx(txid_1))
+  {
+    MERROR("Kept by block tx " << txid_1 << " was dropped for its inputs");
+    return false;
+  }
+  return true;
+}
+
+bool txpool_revalidation_drop::generate(std::vector<test_event_entry>& events) const
+{
+  INIT_MEMPOOL_TEST();
+
+  MAKE_TX(events, tx_0, miner_account, bob_account, send_amount, blk_0r);
+  MAKE_TX(events, tx_1, miner_account, bob_account, send_amount, blk_0r);
+  DO_CALLBACK(events, "corrupt_pool_txes");
+
+  DO_CALLBACK(events, "restart_core");
+  DO_CALLBACK(events, "run_idle");
+  DO_CALLBACK(events, "check_revalidated");
+
+  return true;
+}
+
+bool txpool_validate_queues::generate(std::vector<test_event_entry>& events) const
+{
+  INIT_MEMPOOL_TEST();
+
+  DO_CALLBACK(events, "mark_tx");
+  MAKE_TX(events, tx_0, miner_account, bob_account, send_amount, blk_0r);
+  DO_CALLBACK(events, "check_template_has_tx");
+
+  // the fork queues the pool for re-validation, without checking or dropping anything yet
+  MAKE_NEXT_BLOCK_HF(events, blk_1, blk_0r, miner_account, 2);
+  DO_CALLBACK(events, "check_template_lacks_tx");
+  DO_CALLBACK(events, "check_complement_lacks_tx");
+
+  return true;
+}
@@ -136,3 +136,83 @@ struct txpool_stem_loop : txpool_double_spend_base
 
   bool generate(std::vector<test_event_entry>& events) const;
 };
+
+class txpool_template_base : public test_chain_unit_base
+{
+  size_t m_tx_index;
+
+  bool check_template(cryptonote::core& c, const std::vector<test_event_entry>& events, bool expected);
+
+public:
+  txpool_template_base();
+
+  //! The tx event following this callback is the one the checks below look for
+  bool mark_tx(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_template_has_tx(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_template_lacks_tx(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool relay_tx_fluff(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_complement_lacks_tx(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+
+  //! Restart the core on the same db, so the pool txes are loaded again by init()
+  bool restart_core(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool run_idle(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+};
+
+struct txpool_ready_key_image_reset : txpool_template_base
+{
+  txpool_ready_key_image_reset() : txpool_template_base()
+  {}
+
+  bool generate(std::vector<test_event_entry>& events) const;
+};
+
+struct txpool_ready_pop_reset : txpool_template_base
+{
+  txpool_ready_pop_reset() : txpool_template_base()
+  {}
+
+  bool generate(std::vector<test_event_entry>& events) const;
+};
+
+struct txpool_ready_relay_change : txpool_template_base
+{
+  txpool_ready_relay_change() : txpool_template_base()
+  {}
+
+  bool generate(std::vector<test_event_entry>& events) const;
+};
+
+struct txpool_init_unverified : txpool_template_base
+{
+  txpool_init_unverified() : txpool_template_base()
+  {}
+
+  bool generate(std::vector<test_event_entry>& events) const;
+};
+
+struct txpool_revalidation_drop : txpool_template_base
+{
+  txpool_revalidation_drop();
+
+  bool generate(std::vector<test_event_entry>& events) const;
+
+  //! Breaks the signatures of the first two txes in the db, and marks the second one kept by block
+  bool corrupt_pool_txes(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_revalidated(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+};
+
+struct txpool_validate_queues : txpool_template_base
+{
+  txpool_validate_queues() : txpool_template_base()
+  {}
+
+  bool generate(std::vector<test_event_entry>& events) const;
+};
+
+template<>
+struct get_test_options<txpool_validate_queues> {
+  const std::pair<uint8_t, uint64_t> hard_forks[3] = {std::make_pair(1, 0), std::make_pair(2, CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW + 1), std::make_pair(0, 0)};
+  const cryptonote::test_options test_options = {
+    hard_forks, 0
+  };
+};
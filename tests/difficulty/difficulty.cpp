@@ -48,6 +48,7 @@ static int test_wide_difficulty(const char *filename)
 {
     std::vector<uint64_t> timestamps;
     std::vector<cryptonote::difficulty_type> cumulative_difficulties;
+    cryptonote::difficulty_window window;
     fstream data(filename, fstream::in);
     data.exceptions(fstream::badbit);
     data.clear(data.rdstate());
@@ -72,8 +73,18 @@ static int test_wide_difficulty(const char *filename)
                 << "Found: " << res << endl;
             return 1;
         }
+        cryptonote::difficulty_type window_res = window.next_difficulty(DEFAULT_TEST_DIFFICULTY_TARGET);
+        if (window_res != res) {
+            cerr << "Wrong rolling window difficulty for block " << n << endl
+                << "Expected: " << res << endl
+                << "Found: " << window_res << endl;
+            return 1;
+        }
         timestamps.push_back(timestamp);
         cumulative_difficulties.push_back(cumulative_difficulty += difficulty);
+        window.push_back(timestamp, cumulative_difficulty);
+        if (window.size() > DIFFICULTY_BLOCKS_COUNT)
+            window.pop_front();
         ++n;
     }
     if (!data.eof()) {
@@ -96,6 +107,7 @@ int main(int argc, char *argv[]) {
 
     vector<uint64_t> timestamps, cumulative_difficulties;
     std::vector<cryptonote::difficulty_type> wide_cumulative_difficulties;
+    cryptonote::difficulty_window window;
     fstream data(argv[1], fstream::in);
     data.exceptions(fstream::badbit);
     data.clear(data.rdstate());
@@ -130,9 +142,19 @@ int main(int argc, char *argv[]) {
                 << "Found: " << wide_res << endl;
             return 1;
         }
+        cryptonote::difficulty_type window_res = window.next_difficulty(DEFAULT_TEST_DIFFICULTY_TARGET);
+        if (window_res != wide_res) {
+            cerr << "Wrong rolling window difficulty for block " << n << endl
+                << "Expected: " << wide_res << endl
+                << "Found: " << window_res << endl;
+            return 1;
+        }
         timestamps.push_back(timestamp);
         cumulative_difficulties.push_back(cumulative_difficulty += difficulty);
         wide_cumulative_difficulties.push_back(wide_cumulative_difficulty += difficulty);
+        window.push_back(timestamp, wide_cumulative_difficulty);
+        if (window.size() > DIFFICULTY_BLOCKS_COUNT)
+            window.pop_front();
         ++n;
     }
     if (!data.eof()) {
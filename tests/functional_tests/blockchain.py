@@ -144,6 +144,15 @@ class BlockchainTest():
         # diff etc should be the same
         assert res_getblocktemplate.prev_hash == res_info.top_block_hash
 
+        # a template for another address shares everything but the miner tx
+        res_getblocktemplate2 = daemon.getblocktemplate('44Kbx4sJ7JDRDV5aAhLJzQCjDz2ViLRduE3ijDZu3osWKBjMGkV1XPk4pfDUMqt1Aiezvephdqm6YD19GKFD9ZcXVUTp6BW')
+        assert res_getblocktemplate2.height == res_getblocktemplate.height
+        assert res_getblocktemplate2.prev_hash == res_getblocktemplate.prev_hash
+        assert res_getblocktemplate2.expected_reward == res_getblocktemplate.expected_reward
+        assert res_getblocktemplate2.wide_difficulty == res_getblocktemplate.wide_difficulty
+        assert res_getblocktemplate2.seed_hash == res_getblocktemplate.seed_hash
+        assert res_getblocktemplate2.blocktemplate_blob != res_getblocktemplate.blocktemplate_blob
+
         res_getlastblockheader = daemon.getlastblockheader()
 
         # pop a block
@@ -97,3 +97,32 @@ public:
 private:
   std::vector<rct::BulletproofPlus> proofs;
 };
+
+template<size_t n_proofs>
+class test_batched_bulletproof_plus
+{
+public:
+  static const size_t loop_count = n_proofs >= 10000 ? 1 : 10000 / n_proofs;
+  static const size_t n_unique_proofs = 64;
+
+  bool init()
+  {
+    // proving would dominate the setup time, so a small set of proofs is reused to fill the batch
+    unique_proofs.reserve(n_unique_proofs);
+    for (size_t i = 0; i < n_unique_proofs; ++i)
+      unique_proofs.push_back(rct::bulletproof_plus_PROVE(std::vector<uint64_t>(2, 749327532984), rct::skvGen(2)));
+    proofs.reserve(n_proofs);
+    for (size_t i = 0; i < n_proofs; ++i)
+      proofs.push_back(&unique_proofs[i % n_unique_proofs]);
+    return true;
+  }
+
+  bool test()
+  {
+    return rct::bulletproof_plus_VERIFY(proofs);
+  }
+
+private:
+  std::vector<rct::BulletproofPlus> unique_proofs;
+  std::vector<const rct::BulletproofPlus*> proofs;
+};
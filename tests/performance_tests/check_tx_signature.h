@@ -35,6 +35,7 @@
 #include "cryptonote_basic/account.h"
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_core/cryptonote_tx_utils.h"
+#include "cryptonote_core/tx_verification_utils.h"
 #include "crypto/crypto.h"
 #include "ringct/rctSigs.h"
 
@@ -161,3 +162,81 @@ private:
   cryptonote::account_base m_alice;
   std::vector<cryptonote::transaction> m_txes;
 };
+
+template<size_t a_ring_size, size_t a_outputs, size_t a_num_txes, bool a_batched>
+class test_check_tx_signature_incoming_batch : private multi_tx_test_base<a_ring_size>
+{
+  static_assert(0 < a_ring_size, "ring_size must be greater than 0");
+
+public:
+  static const size_t loop_count = a_num_txes <= 16 ? 10 : 2;
+  static const size_t ring_size = a_ring_size;
+  static const size_t outputs = a_outputs;
+  static const bool batched = a_batched;
+
+  typedef multi_tx_test_base<a_ring_size> base_class;
+
+  bool init()
+  {
+    using namespace cryptonote;
+
+    if (!base_class::init())
+      return false;
+
+    m_alice.generate();
+
+    std::vector<tx_destination_entry> destinations;
+    destinations.push_back(tx_destination_entry(this->m_source_amount - outputs + 1, m_alice.get_keys().m_account_address, false));
+    for (size_t n = 1; n < outputs; ++n)
+      destinations.push_back(tx_destination_entry(1, m_alice.get_keys().m_account_address, false));
+
+    crypto::secret_key tx_key;
+    std::vector<crypto::secret_key> additional_tx_keys;
+    std::unordered_map<crypto::public_key, cryptonote::subaddress_index> subaddresses;
+    subaddresses[this->m_miners[this->real_source_idx].get_keys().m_account_address.m_spend_public_key] = {0,0};
+
+    m_txes.resize(a_num_txes);
+    for (size_t n = 0; n < a_num_txes; ++n)
+    {
+      if (!construct_tx_and_get_tx_key(this->m_miners[this->real_source_idx].get_keys(), subaddresses, this->m_sources, destinations, cryptonote::account_public_address{}, std::vector<uint8_t>(), m_txes[n], tx_key, additional_tx_keys, true, {rct::RangeProofPaddedBulletproof, 4}))
+        return false;
+    }
+
+    // what Blockchain::get_tx_input_rings() would return for each of the txes
+    m_mix_ring.resize(1);
+    for (const auto &output: this->m_sources[0].outputs)
+      m_mix_ring[0].push_back(output.second);
+
+    return true;
+  }
+
+  bool test()
+  {
+    if (batched)
+    {
+      std::vector<const rct::rctSig*> rvv;
+      std::vector<std::pair<cryptonote::transaction*, const rct::ctkeyM*>> txs_and_mix_rings;
+      for (cryptonote::transaction &tx: m_txes)
+      {
+        rvv.push_back(&tx.rct_signatures);
+        txs_and_mix_rings.emplace_back(&tx, &m_mix_ring);
+      }
+      size_t failed_index = 0;
+      return cryptonote::ver_mixed_rct_semantics(rvv) && cryptonote::ver_input_proofs_rings(txs_and_mix_rings, failed_index);
+    }
+
+    for (cryptonote::transaction &tx: m_txes)
+    {
+      if (!cryptonote::ver_mixed_rct_semantics({&tx.rct_signatures}))
+        return false;
+      if (!cryptonote::ver_input_proofs_rings(tx, m_mix_ring))
+        return false;
+    }
+    return true;
+  }
+
+private:
+  cryptonote::account_base m_alice;
+  std::vector<cryptonote::transaction> m_txes;
+  rct::ctkeyM m_mix_ring;
+};
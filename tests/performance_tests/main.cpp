@@ -56,6 +56,7 @@
 #include "subaddress_expand.h"
 #include "sc_reduce32.h"
 #include "sc_check.h"
+#include "special_reward.h"
 #include "cn_fast_hash.h"
 #include "rct_mlsag.h"
 #include "equality.h"
@@ -180,6 +181,11 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE3(filter, p, test_check_tx_signature_aggregated_bulletproofs, 100, 2, 64);
   TEST_PERFORMANCE3(filter, p, test_check_tx_signature_aggregated_bulletproofs, 2, 10, 64);
 
+  TEST_PERFORMANCE4(filter, p, test_check_tx_signature_incoming_batch, 16, 2, 16, false);
+  TEST_PERFORMANCE4(filter, p, test_check_tx_signature_incoming_batch, 16, 2, 16, true);
+  TEST_PERFORMANCE4(filter, p, test_check_tx_signature_incoming_batch, 16, 2, 256, false);
+  TEST_PERFORMANCE4(filter, p, test_check_tx_signature_incoming_batch, 16, 2, 256, true);
+
   TEST_PERFORMANCE4(filter, p, test_check_hash, 0, 1, 0, 1);
   TEST_PERFORMANCE4(filter, p, test_check_hash, 0, 0xffffffffffffffff, 0, 0xffffffffffffffff);
   TEST_PERFORMANCE4(filter, p, test_check_hash, 0, 0xffffffffffffffff, 0, 1);
@@ -210,6 +216,7 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE2(filter, p, test_wallet2_expand_subaddresses, 50, 200);
 
   TEST_PERFORMANCE0(filter, p, test_is_valid_decomposed_amount);
+  TEST_PERFORMANCE0(filter, p, test_special_reward);
 
   TEST_PERFORMANCE1(filter, p, test_cn_slow_hash, 0);
   TEST_PERFORMANCE1(filter, p, test_cn_slow_hash, 1);
@@ -264,6 +271,12 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE6(filter, p, test_aggregated_bulletproof_plus, false, 2, 1, 1, 0, 64);
   TEST_PERFORMANCE6(filter, p, test_aggregated_bulletproof_plus, true, 2, 1, 1, 0, 64); // 64 proof, each with 2 amounts
 
+  TEST_PERFORMANCE1(filter, p, test_batched_bulletproof_plus, 1000); // 1000 proofs in one batch, each with 2 amounts
+  TEST_PERFORMANCE1(filter, p, test_batched_bulletproof_plus, 5000);
+  TEST_PERFORMANCE1(filter, p, test_batched_bulletproof_plus, 10000);
+  TEST_PERFORMANCE1(filter, p, test_batched_bulletproof_plus, 25000);
+  TEST_PERFORMANCE1(filter, p, test_batched_bulletproof_plus, 50000);
+
   TEST_PERFORMANCE2(filter, p, test_bulletproof, true, 1); // 1 bulletproof with 1 amount
   TEST_PERFORMANCE2(filter, p, test_bulletproof, false, 1);
 
@@ -28,6 +28,7 @@
 
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <atomic>
 #include <cstdio>
 #include <iostream>
 #include <chrono>
@@ -341,4 +342,399 @@ TYPED_TEST(BlockchainDBTest, RetrieveBlockData)
   ASSERT_HASH_EQ(get_block_hash(this->m_blocks[1].first), hashes[1]);
 }
 
+TYPED_TEST(BlockchainDBTest, GetOutputKeysBatch)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  db_wtxn_guard guard(this->m_db);
+
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0]));
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1]));
+
+  // every output of both miner txs, in reverse order and with duplicates
+  std::vector<std::pair<uint64_t, uint64_t>> amount_indices;
+  for (size_t i = 0; i < 2; ++i)
+  {
+    for (const auto &out : this->m_blocks[i].first.miner_tx.vout)
+    {
+      const uint64_t n_outputs = this->m_db->get_num_outputs(out.amount);
+      ASSERT_GT(n_outputs, 0);
+      for (uint64_t index = 0; index < n_outputs; ++index)
+        amount_indices.emplace_back(out.amount, index);
+    }
+  }
+  std::reverse(amount_indices.begin(), amount_indices.end());
+  amount_indices.push_back(amount_indices.front());
+  amount_indices.emplace_back(amount_indices.front().first, 1000000);
+
+  std::vector<output_data_t> outputs;
+  std::vector<bool> found;
+  ASSERT_NO_THROW(this->m_db->get_output_keys_batch(amount_indices, outputs, found));
+  ASSERT_EQ(amount_indices.size(), outputs.size());
+  ASSERT_EQ(amount_indices.size(), found.size());
+
+  for (size_t i = 0; i + 1 < amount_indices.size(); ++i)
+  {
+    ASSERT_TRUE(found[i]);
+    const output_data_t expected = this->m_db->get_output_key(amount_indices[i].first, amount_indices[i].second);
+    ASSERT_EQ(expected.pubkey, outputs[i].pubkey);
+    ASSERT_EQ(expected.unlock_time, outputs[i].unlock_time);
+    ASSERT_EQ(expected.height, outputs[i].height);
+  }
+  ASSERT_FALSE(found.back());
+}
+
+TYPED_TEST(BlockchainDBTest, CompressBlobs)
+{
+  BlockchainLMDB *db = dynamic_cast<BlockchainLMDB*>(this->m_db);
+  if (!db || !blob_compressor::available())
+    return;
+
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  {
+    db_wtxn_guard guard(this->m_db);
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0]));
+  }
+
+  // too few blobs to train a dictionary on
+  ASSERT_FALSE(db->blobs_compressed());
+  ASSERT_NO_THROW(db->compress_blobs(3, 0));
+  ASSERT_TRUE(db->blobs_compressed());
+
+  // blobs added from now on are compressed as they are stored
+  {
+    db_wtxn_guard guard(this->m_db);
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1]));
+  }
+
+  for (int reopen = 0; reopen < 2; ++reopen)
+  {
+    if (reopen)
+    {
+      ASSERT_NO_THROW(this->m_db->close());
+      ASSERT_NO_THROW(this->m_db->open(dirPath));
+      ASSERT_TRUE(db->blobs_compressed());
+    }
+    for (size_t i = 0; i < this->m_blocks.size(); ++i)
+    {
+      ASSERT_EQ(this->m_blocks[i].second, this->m_db->get_block_blob_from_height(i));
+      for (const auto &tx: this->m_txs[i])
+      {
+        blobdata bd;
+        ASSERT_TRUE(this->m_db->get_tx_blob(get_transaction_hash(tx.first), bd));
+        ASSERT_EQ(tx.second, bd);
+      }
+    }
+  }
+}
+
+TYPED_TEST(BlockchainDBTest, PruneStepByStep)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  for (size_t i = 0; i < this->m_blocks.size(); ++i)
+  {
+    db_wtxn_guard guard(this->m_db);
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[i], t_sizes[i], t_sizes[i], t_diffs[i], t_coins[i], this->m_txs[i]));
+  }
+
+  uint64_t done, total, pruned_bytes;
+  ASSERT_FALSE(this->m_db->get_pruning_progress(done, total));
+
+  // one tx per step, the first step sets the seed
+  ASSERT_FALSE(this->m_db->prune_blockchain_step(0, std::numeric_limits<uint64_t>::max(), 1, pruned_bytes));
+  ASSERT_NE(0, this->m_db->get_blockchain_pruning_seed());
+  ASSERT_TRUE(this->m_db->get_pruning_progress(done, total));
+  ASSERT_EQ(1, done);
+  ASSERT_GT(total, 1);
+
+  // progress survives a restart
+  ASSERT_NO_THROW(this->m_db->close());
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  ASSERT_TRUE(this->m_db->get_pruning_progress(done, total));
+  ASSERT_EQ(1, done);
+
+  size_t steps = 1;
+  while (!this->m_db->prune_blockchain_step(0, std::numeric_limits<uint64_t>::max(), 1, pruned_bytes))
+    ASSERT_LT(++steps, total);
+  ASSERT_FALSE(this->m_db->get_pruning_progress(done, total));
+  ASSERT_TRUE(this->m_db->prune_blockchain_step(0, std::numeric_limits<uint64_t>::max(), 1, pruned_bytes));
+  ASSERT_TRUE(this->m_db->check_pruning());
+}
+
+TYPED_TEST(BlockchainDBTest, ReserveStorage)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  // storage is reserved up front, well ahead of what is used
+  db_storage_stats stats = this->m_db->get_storage_stats();
+  ASSERT_GE(stats.reserved, 2 * stats.used);
+  const uint64_t resizes = stats.resizes;
+
+  for (size_t i = 0; i < this->m_blocks.size(); ++i)
+  {
+    db_wtxn_guard guard(this->m_db);
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[i], t_sizes[i], t_sizes[i], t_diffs[i], t_coins[i], this->m_txs[i]));
+  }
+
+  // nothing to grow yet
+  ASSERT_NO_THROW(this->m_db->reserve_storage());
+  stats = this->m_db->get_storage_stats();
+  ASSERT_EQ(resizes, stats.resizes);
+  ASSERT_GT(stats.used, 0);
+}
+
+TYPED_TEST(BlockchainDBTest, ColdStorage)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+  std::string coldPath = (tempPath / "cold").string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->set_cold_storage(coldPath));
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  for (size_t i = 0; i < this->m_blocks.size(); ++i)
+  {
+    db_wtxn_guard guard(this->m_db);
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[i], t_sizes[i], t_sizes[i], t_diffs[i], t_coins[i], this->m_txs[i]));
+  }
+
+  const auto check_blobs = [this]() {
+    for (size_t i = 0; i < this->m_blocks.size(); ++i)
+    {
+      ASSERT_EQ(this->m_blocks[i].second, this->m_db->get_block_blob_from_height(i));
+      for (const auto &tx: this->m_txs[i])
+      {
+        blobdata bd;
+        ASSERT_TRUE(this->m_db->get_tx_blob(get_transaction_hash(tx.first), bd));
+        ASSERT_EQ(tx.second, bd);
+      }
+    }
+    std::vector<std::pair<std::pair<blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, blobdata>>>> blocks;
+    ASSERT_TRUE(this->m_db->get_blocks_from(0, 1, this->m_blocks.size(), 1000, 1024*1024, blocks, false, false));
+    ASSERT_EQ(this->m_blocks.size(), blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+      ASSERT_EQ(this->m_blocks[i].second, blocks[i].first.first);
+      ASSERT_EQ(this->m_txs[i].size(), blocks[i].second.size());
+      for (size_t j = 0; j < blocks[i].second.size(); ++j)
+        ASSERT_EQ(this->m_txs[i][j].second, blocks[i].second[j].second);
+    }
+  };
+
+  // the tip stays hot
+  uint64_t moved_bytes;
+  ASSERT_TRUE(this->m_db->move_to_cold_storage(1, 10, moved_bytes));
+  ASSERT_GT(moved_bytes, 0);
+  check_blobs();
+
+  // popping a cold block takes it out of cold storage, and it can be moved again
+  ASSERT_TRUE(this->m_db->move_to_cold_storage(0, 10, moved_bytes));
+  {
+    db_wtxn_guard guard(this->m_db);
+    block blk;
+    std::vector<transaction> txs;
+    ASSERT_NO_THROW(this->m_db->pop_block(blk, txs));
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks.back(), t_sizes.back(), t_sizes.back(), t_diffs.back(), t_coins.back(), this->m_txs.back()));
+  }
+  check_blobs();
+  ASSERT_TRUE(this->m_db->move_to_cold_storage(0, 10, moved_bytes));
+  ASSERT_GT(moved_bytes, 0);
+
+  ASSERT_NO_THROW(this->m_db->close());
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  check_blobs();
+}
+
+TYPED_TEST(BlockchainDBTest, CumulativeRctOutputsRange)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  const auto check_range = [this]() {
+    const uint64_t height = this->m_db->height();
+    std::vector<uint64_t> heights;
+    for (uint64_t h = 0; h < height; ++h)
+      heights.push_back(h);
+    const std::vector<uint64_t> expected = this->m_db->get_block_cumulative_rct_outputs(heights);
+    ASSERT_EQ(expected, this->m_db->get_block_cumulative_rct_outputs_range(0, height));
+    if (height > 1)
+      ASSERT_EQ(std::vector<uint64_t>(expected.begin() + 1, expected.end()), this->m_db->get_block_cumulative_rct_outputs_range(1, height - 1));
+    ASSERT_THROW(this->m_db->get_block_cumulative_rct_outputs_range(0, height + 1), BLOCK_DNE);
+  };
+
+  for (size_t i = 0; i < this->m_blocks.size(); ++i)
+  {
+    {
+      db_wtxn_guard guard(this->m_db);
+      ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[i], t_sizes[i], t_sizes[i], t_diffs[i], t_coins[i], this->m_txs[i]));
+    }
+    check_range();
+  }
+
+  // popped blocks leave the range, and a pop that is aborted brings them back
+  {
+    db_wtxn_guard guard(this->m_db);
+    block blk;
+    std::vector<transaction> txs;
+    ASSERT_NO_THROW(this->m_db->pop_block(blk, txs));
+    guard.abort();
+  }
+  check_range();
+  {
+    db_wtxn_guard guard(this->m_db);
+    block blk;
+    std::vector<transaction> txs;
+    ASSERT_NO_THROW(this->m_db->pop_block(blk, txs));
+  }
+  check_range();
+
+  ASSERT_NO_THROW(this->m_db->close());
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  check_range();
+}
+
+TYPED_TEST(BlockchainDBTest, ReadSnapshot)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  for (size_t i = 0; i < this->m_blocks.size(); ++i)
+  {
+    db_wtxn_guard guard(this->m_db);
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[i], t_sizes[i], t_sizes[i], t_diffs[i], t_coins[i], this->m_txs[i]));
+  }
+
+  // reads are only timed while enabled on this thread
+  const uint64_t t0 = db_read_timer::total_ns();
+  ASSERT_EQ(this->m_blocks.size(), this->m_db->height());
+  ASSERT_EQ(t0, db_read_timer::total_ns());
+
+  db_read_timer::enable(true);
+  {
+    // nested reads reuse the pinned txn
+    db_rtxn_guard snapshot(this->m_db);
+    for (size_t i = 0; i < this->m_blocks.size(); ++i)
+    {
+      ASSERT_TRUE(this->m_db->block_exists(get_block_hash(this->m_blocks[i].first)));
+      ASSERT_EQ(i, this->m_db->get_block_height(get_block_hash(this->m_blocks[i].first)));
+    }
+    ASSERT_EQ(this->m_blocks.size(), this->m_db->height());
+  }
+  db_read_timer::enable(false);
+  ASSERT_LT(t0, db_read_timer::total_ns());
+
+  // a write after the snapshot is released goes through
+  {
+    db_wtxn_guard guard(this->m_db);
+    block blk;
+    std::vector<transaction> txs;
+    ASSERT_NO_THROW(this->m_db->pop_block(blk, txs));
+  }
+  ASSERT_EQ(this->m_blocks.size() - 1, this->m_db->height());
+}
+
+TYPED_TEST(BlockchainDBTest, TxpoolSnapshotReaders)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  // the pool readers hold a snapshot and no lock, while add_tx keeps writing
+  static const uint64_t num_txes = 200;
+  const blobdata &blob = this->m_txs[0][0].second;
+  std::atomic<bool> done(false), failed(false);
+  std::atomic<uint64_t> snapshots(0);
+
+  auto reader = [&]() {
+    uint64_t last = 0;
+    while (!done)
+    {
+      db_rtxn_guard snapshot(this->m_db);
+      const uint64_t before = this->m_db->get_txpool_tx_count();
+      uint64_t seen = 0;
+      this->m_db->for_all_txpool_txes([&seen](const crypto::hash&, const txpool_tx_meta_t&, const cryptonote::blobdata_ref*) {
+        ++seen;
+        return true;
+      });
+      const uint64_t after = this->m_db->get_txpool_tx_count();
+      if (before != seen || after != seen || seen < last)
+        failed = true;
+      last = seen;
+      ++snapshots;
+    }
+  };
+  std::thread reader0(reader), reader1(reader);
+
+  for (uint64_t i = 0; i < num_txes; ++i)
+  {
+    txpool_tx_meta_t meta;
+    memset(&meta, 0, sizeof(meta));
+    meta.weight = blob.size();
+    meta.fee = i + 1;
+    meta.set_relay_method(relay_method::fluff);
+    const crypto::hash txid = crypto::cn_fast_hash(&i, sizeof(i));
+    db_wtxn_guard guard(this->m_db);
+    this->m_db->add_txpool_tx(txid, blob, meta);
+  }
+  while (snapshots < 2)
+    std::this_thread::yield();
+  done = true;
+  reader0.join();
+  reader1.join();
+
+  ASSERT_FALSE(failed);
+  ASSERT_EQ(num_txes, this->m_db->get_txpool_tx_count());
+}
+
 }  // anonymous namespace
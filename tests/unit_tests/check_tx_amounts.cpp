@@ -0,0 +1,119 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#define IN_UNIT_TESTS // To access Blockchain::check_tx_amounts
+
+#include "gtest/gtest.h"
+
+#include "cryptonote_basic/cryptonote_basic.h"
+#include "cryptonote_core/blockchain.h"
+
+namespace
+{
+  cryptonote::txin_to_key make_input(uint64_t amount)
+  {
+    cryptonote::txin_to_key in;
+    in.amount = amount;
+    in.key_offsets = {1, 2};
+    in.k_image = crypto::key_image{};
+    return in;
+  }
+
+  cryptonote::tx_out make_output(uint64_t amount)
+  {
+    cryptonote::tx_out out;
+    out.amount = amount;
+    out.target = cryptonote::txout_to_key{};
+    return out;
+  }
+
+  cryptonote::transaction make_rct_tx(std::initializer_list<uint64_t> input_amounts, size_t n_outputs)
+  {
+    cryptonote::transaction tx;
+    tx.version = 2;
+    for (uint64_t amount: input_amounts)
+      tx.vin.push_back(make_input(amount));
+    for (size_t i = 0; i < n_outputs; ++i)
+      tx.vout.push_back(make_output(0));
+    tx.rct_signatures.type = rct::RCTTypeCLSAG;
+    tx.rct_signatures.outPk.resize(n_outputs);
+    return tx;
+  }
+}
+
+TEST(check_tx_amounts, v1_inputs_cover_outputs)
+{
+  cryptonote::transaction tx;
+  tx.version = 1;
+  tx.vin.push_back(make_input(1000));
+  tx.vout.push_back(make_output(600));
+  tx.vout.push_back(make_output(400));
+  ASSERT_TRUE(cryptonote::Blockchain::check_tx_amounts(tx));
+  tx.vout.push_back(make_output(1));
+  ASSERT_FALSE(cryptonote::Blockchain::check_tx_amounts(tx));
+}
+
+TEST(check_tx_amounts, v2_hidden_amounts)
+{
+  ASSERT_TRUE(cryptonote::Blockchain::check_tx_amounts(make_rct_tx({0, 0}, 2)));
+}
+
+TEST(check_tx_amounts, v2_spending_pre_rct_outputs)
+{
+  // RingCT txes may spend pre-RingCT outputs, which keep their denomination
+  ASSERT_TRUE(cryptonote::Blockchain::check_tx_amounts(make_rct_tx({1000000000000, 0}, 2)));
+  ASSERT_TRUE(cryptonote::Blockchain::check_tx_amounts(make_rct_tx({20000000000}, 1)));
+}
+
+TEST(check_tx_amounts, v2_cleartext_output_amount)
+{
+  cryptonote::transaction tx = make_rct_tx({0}, 2);
+  tx.vout[1].amount = 1;
+  ASSERT_FALSE(cryptonote::Blockchain::check_tx_amounts(tx));
+}
+
+TEST(check_tx_amounts, v2_commitments_mismatch)
+{
+  cryptonote::transaction tx = make_rct_tx({0}, 2);
+  tx.rct_signatures.outPk.resize(1);
+  ASSERT_FALSE(cryptonote::Blockchain::check_tx_amounts(tx));
+}
+
+TEST(check_tx_amounts, v2_null_rct_type)
+{
+  cryptonote::transaction tx = make_rct_tx({0}, 1);
+  tx.rct_signatures.type = rct::RCTTypeNull;
+  ASSERT_FALSE(cryptonote::Blockchain::check_tx_amounts(tx));
+}
+
+TEST(check_tx_amounts, empty_ring)
+{
+  cryptonote::transaction tx = make_rct_tx({0}, 1);
+  boost::get<cryptonote::txin_to_key>(tx.vin[0]).key_offsets.clear();
+  ASSERT_FALSE(cryptonote::Blockchain::check_tx_amounts(tx));
+}
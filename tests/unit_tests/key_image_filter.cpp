@@ -0,0 +1,128 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include <random>
+#include <vector>
+
+#include "blockchain_db/key_image_filter.h"
+
+namespace
+{
+  std::vector<crypto::key_image> random_key_images(size_t n, uint64_t seed)
+  {
+    std::mt19937_64 rng(seed);
+    std::vector<crypto::key_image> key_images(n);
+    for (auto &ki: key_images)
+      for (size_t i = 0; i < sizeof(ki); ++i)
+        reinterpret_cast<unsigned char*>(&ki)[i] = rng();
+    return key_images;
+  }
+}
+
+TEST(key_image_filter, empty)
+{
+  cryptonote::key_image_filter filter;
+  ASSERT_TRUE(filter.empty());
+  // an unset filter must never give a false negative
+  for (const auto &ki: random_key_images(100, 1))
+    ASSERT_TRUE(filter.may_contain(ki));
+}
+
+TEST(key_image_filter, no_false_negatives)
+{
+  const auto key_images = random_key_images(100000, 2);
+  cryptonote::key_image_filter filter;
+  filter.reset(cryptonote::key_image_filter::capacity_for(key_images.size()));
+  for (const auto &ki: key_images)
+    filter.insert(ki);
+  ASSERT_EQ(filter.count(), key_images.size());
+  for (const auto &ki: key_images)
+    ASSERT_TRUE(filter.may_contain(ki));
+}
+
+TEST(key_image_filter, clear)
+{
+  const auto key_images = random_key_images(1000, 5);
+  cryptonote::key_image_filter filter;
+  filter.reset(key_images.size());
+  for (const auto &ki: key_images)
+    filter.insert(ki);
+  const uint64_t capacity = filter.capacity();
+
+  filter.clear();
+  ASSERT_EQ(filter.count(), 0);
+  ASSERT_EQ(filter.capacity(), capacity);
+  ASSERT_FALSE(filter.empty());
+  size_t hits = 0;
+  for (const auto &ki: key_images)
+    hits += filter.may_contain(ki);
+  ASSERT_EQ(hits, 0);
+
+  filter.insert(key_images[0]);
+  ASSERT_TRUE(filter.may_contain(key_images[0]));
+}
+
+TEST(key_image_filter, false_positive_rate)
+{
+  const size_t n = 200000;
+  cryptonote::key_image_filter filter;
+  filter.reset(n);
+  for (const auto &ki: random_key_images(n, 3))
+    filter.insert(ki);
+  size_t false_positives = 0;
+  for (const auto &ki: random_key_images(n, 4))
+    false_positives += filter.may_contain(ki);
+  ASSERT_LT(false_positives, n / 100);
+}
+
+TEST(key_image_filter, save_load)
+{
+  const auto key_images = random_key_images(1000, 5);
+  cryptonote::key_image_filter filter;
+  filter.reset(cryptonote::key_image_filter::capacity_for(key_images.size()));
+  for (const auto &ki: key_images)
+    filter.insert(ki);
+  const std::string data = filter.save();
+
+  cryptonote::key_image_filter loaded;
+  ASSERT_TRUE(loaded.load(data));
+  ASSERT_EQ(loaded.count(), filter.count());
+  ASSERT_EQ(loaded.capacity(), filter.capacity());
+  ASSERT_EQ(loaded.save(), data);
+  for (const auto &ki: key_images)
+    ASSERT_TRUE(loaded.may_contain(ki));
+
+  ASSERT_FALSE(loaded.load(""));
+  ASSERT_TRUE(loaded.empty());
+  ASSERT_FALSE(loaded.load(data.substr(0, data.size() - 1)));
+  std::string bad_version = data;
+  bad_version[0] ^= 1;
+  ASSERT_FALSE(loaded.load(bad_version));
+}
@@ -0,0 +1,126 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include <ctime>
+#include "cryptonote_core/mevacoin_specials.h"
+
+namespace
+{
+  bool reference_special_date(time_t timestamp, int &bonus_pct, const char* &name)
+  {
+    struct tm t;
+    if (!gmtime_r(&timestamp, &t))
+      return false;
+    for (int i = 0; i < meva::NUM_SPECIAL_DATES; ++i)
+    {
+      if (meva::SPECIAL_DATES[i].month == t.tm_mon + 1 && meva::SPECIAL_DATES[i].day == t.tm_mday)
+      {
+        bonus_pct = meva::SPECIAL_DATES[i].bonus_pct;
+        name = meva::SPECIAL_DATES[i].name;
+        return true;
+      }
+    }
+    return false;
+  }
+}
+
+TEST(mevacoin_specials, civil_from_days)
+{
+  for (int64_t days = -800000; days < 800000; days += 7)
+  {
+    const time_t ts = days * 86400 + 43200;
+    struct tm t;
+    ASSERT_TRUE(gmtime_r(&ts, &t) != NULL);
+    const meva::CivilDate date = meva::civil_from_days(meva::days_from_timestamp(ts));
+    ASSERT_EQ(date.year, t.tm_year + 1900);
+    ASSERT_EQ(date.month, (unsigned)t.tm_mon + 1);
+    ASSERT_EQ(date.day, (unsigned)t.tm_mday);
+  }
+  ASSERT_EQ(meva::days_from_timestamp(0), 0);
+  ASSERT_EQ(meva::days_from_timestamp(86399), 0);
+  ASSERT_EQ(meva::days_from_timestamp(-1), -1);
+  ASSERT_EQ(meva::days_from_timestamp(-86400), -1);
+  ASSERT_EQ(meva::days_from_timestamp(-86401), -2);
+}
+
+TEST(mevacoin_specials, matches_gmtime)
+{
+  // every day over a few years, at several times of day, plus the edges of each day
+  for (int64_t days = 0; days < 366 * 8; ++days)
+  {
+    for (int64_t seconds: {0, 1, 3600, 43200, 86399})
+    {
+      const time_t ts = 1735689600 + days * 86400 + seconds; // 2025-01-01
+      int bonus_pct = -1, ref_bonus_pct = -1;
+      const char *name = nullptr, *msg = nullptr, *ref_name = nullptr;
+      const bool found = meva::find_special_date(ts, bonus_pct, name, msg);
+      ASSERT_EQ(found, reference_special_date(ts, ref_bonus_pct, ref_name));
+      if (found)
+      {
+        ASSERT_EQ(bonus_pct, ref_bonus_pct);
+        ASSERT_EQ(name, ref_name);
+      }
+    }
+  }
+}
+
+TEST(mevacoin_specials, final_reward)
+{
+  const uint64_t base = 1000000000000;
+  for (int64_t days = 0; days < 366; ++days)
+  {
+    const time_t ts = 1735689600 + days * 86400 + 600;
+    int ref_bonus_pct = 0;
+    const char *ref_name = nullptr;
+    uint64_t expected = base;
+    if (reference_special_date(ts, ref_bonus_pct, ref_name) && ref_bonus_pct > 0)
+      expected += base * ref_bonus_pct / 100;
+    ASSERT_EQ(meva::calculate_final_reward(base, meva::MAX_SPECIAL_BLOCK_HEIGHT + 1, ts), expected);
+    for (int i = 0; i < meva::NUM_SPECIAL_BLOCKS; ++i)
+    {
+      const uint64_t multiplier = meva::SPECIAL_BLOCKS[i].multiplier > 1 ? meva::SPECIAL_BLOCKS[i].multiplier : 1;
+      ASSERT_EQ(meva::calculate_final_reward(base, meva::SPECIAL_BLOCKS[i].height, ts), expected * multiplier);
+    }
+  }
+}
+
+TEST(mevacoin_specials, commemorative_message)
+{
+  const time_t day = 1735689600;
+  // first block of the day
+  ASSERT_TRUE(meva::should_show_commemorative_message(1001, day + 10, day - 10));
+  // then only every 10 blocks, and the same answer however many times it is asked
+  for (int i = 0; i < 3; ++i)
+  {
+    ASSERT_FALSE(meva::should_show_commemorative_message(1001, day + 130, day + 10));
+    ASSERT_FALSE(meva::should_show_commemorative_message(1009, day + 1090, day + 970));
+    ASSERT_TRUE(meva::should_show_commemorative_message(1010, day + 1210, day + 1090));
+  }
+}
@@ -0,0 +1,122 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include "blockchain_db/rct_output_column.h"
+
+#ifndef _WIN32
+
+namespace
+{
+  cryptonote::output_data_t make_record(uint64_t n)
+  {
+    cryptonote::output_data_t data;
+    memset(&data, 0, sizeof(data));
+    memcpy(&data.pubkey, &n, sizeof(n));
+    data.unlock_time = n;
+    data.height = n / 10;
+    return data;
+  }
+
+  struct rct_output_column_test: public ::testing::Test
+  {
+    rct_output_column_test(): filename((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string()) {}
+    ~rct_output_column_test() { boost::system::error_code ec; boost::filesystem::remove(filename, ec); }
+    const std::string filename;
+  };
+}
+
+TEST_F(rct_output_column_test, unpublished_records_are_hidden)
+{
+  cryptonote::rct_output_column column;
+  ASSERT_TRUE(column.open(filename));
+  ASSERT_EQ(column.size(), 0);
+  for (uint64_t n = 0; n < 100; ++n)
+    column.write(n, make_record(n));
+  cryptonote::output_data_t data;
+  ASSERT_FALSE(column.get(0, data));
+  column.publish(50);
+  ASSERT_TRUE(column.get(49, data));
+  ASSERT_EQ(data.unlock_time, 49);
+  ASSERT_FALSE(column.get(50, data));
+  ASSERT_THROW(column.write(10, make_record(10)), std::exception);
+}
+
+TEST_F(rct_output_column_test, grow_and_truncate)
+{
+  cryptonote::rct_output_column column;
+  ASSERT_TRUE(column.open(filename));
+  const uint64_t count = (1 << 20) + 5;
+  for (uint64_t n = 0; n < count; ++n)
+    column.write(n, make_record(n));
+  column.publish(count);
+  ASSERT_GE(column.capacity(), count);
+  cryptonote::output_data_t data;
+  ASSERT_TRUE(column.get(count - 1, data));
+  ASSERT_EQ(data.height, (count - 1) / 10);
+  column.truncate(1000);
+  ASSERT_EQ(column.size(), 1000);
+  ASSERT_FALSE(column.get(1000, data));
+  column.write(1000, make_record(7));
+  column.publish(1001);
+  ASSERT_TRUE(column.get(1000, data));
+  ASSERT_EQ(data.unlock_time, 7);
+  const uint64_t sum = column.with_records([](const cryptonote::output_data_t *records, uint64_t size) {
+    uint64_t sum = 0;
+    for (uint64_t n = 0; n < size; ++n)
+      sum += records[n].height;
+    return sum;
+  });
+  ASSERT_EQ(sum, 7 / 10 + [](){ uint64_t s = 0; for (uint64_t n = 0; n < 1000; ++n) s += n / 10; return s; }());
+}
+
+TEST_F(rct_output_column_test, reopen)
+{
+  {
+    cryptonote::rct_output_column column;
+    ASSERT_TRUE(column.open(filename));
+    for (uint64_t n = 0; n < 10; ++n)
+      column.write(n, make_record(n));
+    column.publish(10);
+    ASSERT_TRUE(column.flush());
+  }
+  cryptonote::rct_output_column column;
+  ASSERT_TRUE(column.open(filename));
+  // the owner decides how many records are still valid
+  ASSERT_EQ(column.size(), 0);
+  column.publish(10);
+  cryptonote::output_data_t data;
+  ASSERT_TRUE(column.get(9, data));
+  ASSERT_EQ(data.unlock_time, 9);
+}
+
+#endif
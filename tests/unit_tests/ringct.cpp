@@ -299,6 +299,58 @@ TEST(ringct, CLSAG)
   ASSERT_TRUE(rct::verRctCLSAGSimple(message,clsag,pubs,Cout));
 }
 
+TEST(ringct, CLSAG_ring_member_cache)
+{
+  const size_t N = 11;
+  const size_t idx = 3;
+  ctkeyV pubs;
+  key p, t, t2, u;
+  const key message = identity();
+
+  for (size_t i = 0; i < N; ++i)
+  {
+    key sk;
+    ctkey tmp;
+    skpkGen(sk, tmp.dest);
+    skpkGen(sk, tmp.mask);
+    pubs.push_back(tmp);
+  }
+  skpkGen(p, pubs[idx].dest);
+  t = skGen();
+  u = skGen();
+  addKeys2(pubs[idx].mask,t,u,H);
+  key Cout;
+  t2 = skGen();
+  addKeys2(Cout,t2,u,H);
+  ctkey insk;
+  insk.dest = p;
+  insk.mask = t;
+  const clsag sig = rct::proveRctCLSAGSimple(message,pubs,insk,t2,Cout,idx,hw::get_device("default"));
+
+  // first verification fills the cache, the second one hits it for every ring member
+  const rct::ring_member_cache_stats stats0 = rct::get_ring_member_cache_stats();
+  ASSERT_TRUE(rct::verRctCLSAGSimple(message,sig,pubs,Cout));
+  const rct::ring_member_cache_stats stats1 = rct::get_ring_member_cache_stats();
+  ASSERT_TRUE(rct::verRctCLSAGSimple(message,sig,pubs,Cout));
+  const rct::ring_member_cache_stats stats2 = rct::get_ring_member_cache_stats();
+  ASSERT_GE(stats1.misses - stats0.misses, 1);
+  ASSERT_EQ(stats2.hits - stats1.hits, N);
+  ASSERT_EQ(stats2.misses, stats1.misses);
+
+  // a changed ring member is a different cache entry, and still fails
+  ctkeyV bad_pubs = pubs;
+  bad_pubs[0].mask = pkGen();
+  ASSERT_FALSE(rct::verRctCLSAGSimple(message,sig,bad_pubs,Cout));
+  ASSERT_TRUE(rct::verRctCLSAGSimple(message,sig,pubs,Cout));
+
+  // the cache stays within its capacity
+  rct::set_ring_member_cache_capacity(16);
+  ASSERT_LE(rct::get_ring_member_cache_stats().size, 16);
+  ASSERT_TRUE(rct::verRctCLSAGSimple(message,sig,pubs,Cout));
+  ASSERT_LE(rct::get_ring_member_cache_stats().size, 16);
+  rct::set_ring_member_cache_capacity(stats0.capacity);
+}
+
 TEST(ringct, range_proofs)
 {
         //Ring CT Stuff
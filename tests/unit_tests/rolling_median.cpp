@@ -229,3 +229,61 @@ TEST(rolling_median, copy)
     ASSERT_EQ(m.median(), copy.median());
   }
 }
+
+TEST(rolling_median, state)
+{
+  epee::misc_utils::rolling_median_t<uint64_t> m(100);
+  for (int i = 0; i < 150; ++i)
+    m.insert(rand());
+
+  const std::string state = m.get_state();
+
+  epee::misc_utils::rolling_median_t<uint64_t> restored(100);
+  ASSERT_TRUE(restored.set_state(state));
+  ASSERT_EQ(m.size(), restored.size());
+  ASSERT_EQ(m.median(), restored.median());
+  for (int i = 0; i < 5000; ++i)
+  {
+    uint64_t v = rand();
+    m.insert(v);
+    restored.insert(v);
+    ASSERT_EQ(m.median(), restored.median());
+  }
+
+  // partially filled
+  epee::misc_utils::rolling_median_t<uint64_t> partial(100);
+  for (int i = 0; i < 37; ++i)
+    partial.insert(rand());
+  ASSERT_TRUE(restored.set_state(partial.get_state()));
+  ASSERT_EQ(37, restored.size());
+  ASSERT_EQ(partial.median(), restored.median());
+
+  // wrong window size
+  epee::misc_utils::rolling_median_t<uint64_t> other(99);
+  ASSERT_FALSE(other.set_state(state));
+
+  // truncated
+  ASSERT_FALSE(restored.set_state(state.substr(0, state.size() - 1)));
+  ASSERT_EQ(partial.median(), restored.median());
+
+  // corrupted heap
+  std::string bad = state;
+  memset(&bad[5 * sizeof(int) + 100 * sizeof(uint64_t)], 0xff, 2 * sizeof(int));
+  ASSERT_FALSE(restored.set_state(bad));
+}
+
+TEST(rolling_median, state_deterministic)
+{
+  // unused slots must not carry stale values into the state
+  epee::misc_utils::rolling_median_t<uint64_t> used(10);
+  for (int i = 0; i < 25; ++i)
+    used.insert(1000 + i);
+  used.clear();
+  used.insert(7);
+  used.insert(3);
+
+  epee::misc_utils::rolling_median_t<uint64_t> fresh(10);
+  fresh.insert(7);
+  fresh.insert(3);
+  ASSERT_EQ(used.get_state(), fresh.get_state());
+}
@@ -0,0 +1,218 @@
+// Copyright (c) 2026, The Mevacoin Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "misc_language.h"
+#include "cryptonote_core/tx_pool_stats.h"
+
+namespace
+{
+  cryptonote::tx_stats_entry make_entry(uint64_t weight, uint64_t fee, uint64_t receive_time)
+  {
+    return {weight, fee, receive_time, true, false, false, false};
+  }
+
+  uint64_t histo_txs(const cryptonote::txpool_stats &stats)
+  {
+    uint64_t txs = 0;
+    for (const auto &h: stats.histo)
+      txs += h.txs;
+    return txs;
+  }
+}
+
+TEST(tx_pool_stats, empty)
+{
+  cryptonote::tx_stats_totals totals;
+  cryptonote::txpool_stats stats;
+  totals.get_stats(stats, 1000000);
+  ASSERT_EQ(stats.txs_total, 0);
+  ASSERT_EQ(stats.bytes_total, 0);
+  ASSERT_EQ(stats.bytes_med, 0);
+  ASSERT_EQ(stats.oldest, 0);
+  ASSERT_TRUE(stats.histo.empty());
+  std::vector<cryptonote::tx_backlog_entry> backlog;
+  totals.get_fee_buckets(backlog, 1000000);
+  ASSERT_TRUE(backlog.empty());
+}
+
+TEST(tx_pool_stats, add_remove)
+{
+  const uint64_t now = 1000000;
+  cryptonote::tx_stats_totals totals;
+  cryptonote::tx_stats_entry unrelayed = make_entry(3000, 30000, now - 10);
+  unrelayed.relayed = false;
+  cryptonote::tx_stats_entry failing = make_entry(2000, 20000, now - 20);
+  failing.failing = true;
+  failing.double_spend_seen = true;
+  const cryptonote::tx_stats_entry plain = make_entry(1000, 10000, now - 30);
+  totals.add(unrelayed);
+  totals.add(failing);
+  totals.add(plain);
+
+  cryptonote::txpool_stats stats;
+  totals.get_stats(stats, now);
+  ASSERT_EQ(totals.txs(), 3);
+  ASSERT_EQ(stats.txs_total, 3);
+  ASSERT_EQ(stats.bytes_total, 6000);
+  ASSERT_EQ(stats.fee_total, 60000);
+  ASSERT_EQ(stats.num_not_relayed, 1);
+  ASSERT_EQ(stats.num_failing, 1);
+  ASSERT_EQ(stats.num_double_spends, 1);
+  ASSERT_EQ(stats.bytes_min, 1000);
+  ASSERT_EQ(stats.bytes_max, 3000);
+  ASSERT_EQ(stats.bytes_med, 2000);
+  ASSERT_EQ(stats.oldest, now - 30);
+
+  totals.remove(failing);
+  stats = cryptonote::txpool_stats();
+  totals.get_stats(stats, now);
+  ASSERT_EQ(stats.txs_total, 2);
+  ASSERT_EQ(stats.bytes_total, 4000);
+  ASSERT_EQ(stats.fee_total, 40000);
+  ASSERT_EQ(stats.num_not_relayed, 1);
+  ASSERT_EQ(stats.num_failing, 0);
+  ASSERT_EQ(stats.num_double_spends, 0);
+  ASSERT_EQ(stats.bytes_med, 2000);
+
+  totals.remove(plain);
+  totals.remove(unrelayed);
+  stats = cryptonote::txpool_stats();
+  totals.get_stats(stats, now);
+  ASSERT_EQ(stats.txs_total, 0);
+  ASSERT_EQ(stats.bytes_total, 0);
+  ASSERT_EQ(stats.fee_total, 0);
+  ASSERT_EQ(stats.num_not_relayed, 0);
+  ASSERT_EQ(stats.oldest, 0);
+  std::vector<cryptonote::tx_backlog_entry> backlog;
+  totals.get_fee_buckets(backlog, now);
+  ASSERT_TRUE(backlog.empty());
+}
+
+TEST(tx_pool_stats, median)
+{
+  std::mt19937_64 rng(1);
+  cryptonote::tx_stats_totals totals;
+  std::vector<cryptonote::tx_stats_entry> entries;
+  for (int step = 0; step < 2000; ++step)
+  {
+    // mostly add, with duplicate weights, and remove random entries
+    if (entries.empty() || rng() % 3)
+    {
+      entries.push_back(make_entry(1000 + rng() % 200, 1000, 1000000 - rng() % 1000));
+      totals.add(entries.back());
+    }
+    else
+    {
+      const size_t idx = rng() % entries.size();
+      totals.remove(entries[idx]);
+      entries.erase(entries.begin() + idx);
+    }
+
+    cryptonote::txpool_stats stats;
+    totals.get_stats(stats, 1000000);
+    std::vector<uint64_t> weights;
+    for (const auto &e: entries)
+      weights.push_back(e.weight);
+    ASSERT_EQ(stats.txs_total, entries.size());
+    ASSERT_EQ(stats.bytes_med, epee::misc_utils::median(weights));
+    if (!weights.empty())
+    {
+      ASSERT_EQ(stats.bytes_min, weights.front());
+      ASSERT_EQ(stats.bytes_max, weights.back());
+    }
+  }
+}
+
+TEST(tx_pool_stats, age_buckets)
+{
+  const uint64_t now = 1000000;
+  cryptonote::tx_stats_totals totals;
+  totals.add(make_entry(1000, 1000, now - 3600));
+  totals.add(make_entry(1000, 1000, now - 700));
+  for (uint64_t i = 0; i < 10; ++i)
+    totals.add(make_entry(1000, 1000, now - 10 - i));
+
+  cryptonote::txpool_stats stats;
+  totals.get_stats(stats, now);
+  ASSERT_EQ(stats.oldest, now - 3600);
+  ASSERT_EQ(stats.num_10m, 2);
+  ASSERT_EQ(stats.histo.size(), 10);
+  ASSERT_EQ(histo_txs(stats), 12);
+  // the oldest tx is exact, so it ends in the last bin
+  ASSERT_EQ(stats.histo.back().txs, 1);
+  ASSERT_EQ(stats.histo.front().txs, 10);
+
+  // txes received in the same minute share a bucket, and leave it one by one
+  totals.remove(make_entry(1000, 1000, now - 10));
+  stats = cryptonote::txpool_stats();
+  totals.get_stats(stats, now);
+  ASSERT_EQ(histo_txs(stats), 11);
+  ASSERT_EQ(stats.histo.front().txs, 9);
+}
+
+TEST(tx_pool_stats, fee_buckets)
+{
+  const uint64_t now = 1000000;
+  cryptonote::tx_stats_totals totals;
+  totals.add(make_entry(1000, 20000, now - 10));
+  totals.add(make_entry(3000, 60000, now - 30));
+  totals.add(make_entry(2000, 2000000, now - 20));
+
+  // the first two pay the same fee per byte and share a bucket
+  std::vector<cryptonote::tx_backlog_entry> backlog;
+  totals.get_fee_buckets(backlog, now);
+  ASSERT_EQ(backlog.size(), 2);
+  ASSERT_EQ(backlog[0].weight, 4000);
+  ASSERT_EQ(backlog[0].fee, 80000);
+  ASSERT_EQ(backlog[0].time_in_pool, (uint64_t)-20);
+  ASSERT_EQ(backlog[1].weight, 2000);
+  ASSERT_EQ(backlog[1].fee, 2000000);
+
+  totals.remove(make_entry(1000, 20000, now - 10));
+  backlog.clear();
+  totals.get_fee_buckets(backlog, now);
+  ASSERT_EQ(backlog.size(), 2);
+  ASSERT_EQ(backlog[0].weight, 3000);
+  ASSERT_EQ(backlog[0].fee, 60000);
+  ASSERT_EQ(backlog[0].time_in_pool, (uint64_t)-30);
+}
+
+TEST(tx_pool_stats, fee_bucket_width)
+{
+  // a bucket never holds fees per byte more than one bucket width apart
+  const double width = std::exp2(1.0 / cryptonote::tx_stats_totals::FEE_BUCKETS_PER_DOUBLING);
+  ASSERT_EQ(cryptonote::tx_stats_totals::fee_bucket(20000, 1000), cryptonote::tx_stats_totals::fee_bucket(60000, 3000));
+  ASSERT_LT(cryptonote::tx_stats_totals::fee_bucket(20000, 1000), cryptonote::tx_stats_totals::fee_bucket(20000 * width + 1, 1000));
+  ASSERT_LT(cryptonote::tx_stats_totals::fee_bucket(0, 1000), cryptonote::tx_stats_totals::fee_bucket(1, 1000000));
+}
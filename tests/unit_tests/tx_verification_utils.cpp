@@ -266,4 +266,18 @@ TEST(tx_verification_utils, ver_input_proofs_rings)
         mixring0.erase(mixring0.begin() + 1);
         EXPECT_FALSE(cryptonote::ver_input_proofs_rings(deserialized_tx, modified_mixrings));
     }
+
+    // test verify input rings of a group of txs [positive]
+    cryptonote::transaction deserialized_tx_2 = deserialized_tx;
+    std::vector<std::pair<cryptonote::transaction*, const rct::ctkeyM*>> txs_and_mix_rings{
+        {&deserialized_tx, &mixrings}, {&deserialized_tx_2, &mixrings}};
+    size_t failed_tx_index = 0;
+    EXPECT_TRUE(cryptonote::ver_input_proofs_rings(txs_and_mix_rings, failed_tx_index));
+
+    // test verify input rings of a group of txs with one bad dereferenced mixring [negative]
+    modified_mixrings = mixrings;
+    modified_mixrings.at(N_INPUTS - 1).at(0) = {rct::pkGen(), rct::pkGen()};
+    txs_and_mix_rings.back().second = &modified_mixrings;
+    EXPECT_FALSE(cryptonote::ver_input_proofs_rings(txs_and_mix_rings, failed_tx_index));
+    EXPECT_EQ(1, failed_tx_index);
 }
@@ -558,10 +558,11 @@ class Daemon(object):
         }
         return self.rpc.send_json_rpc_request(sync_info)
 
-    def get_txpool_backlog(self, client = ""):
+    def get_txpool_backlog(self, fee_buckets = False, client = ""):
         get_txpool_backlog = {
             'method': 'get_txpool_backlog',
             'params': {
+                'fee_buckets': fee_buckets,
                 'client': client,
             },
             'jsonrpc': '2.0', 